@@ -9,9 +9,32 @@
   ******************************************************************************
   */
 
-#include "cli.h" /* Command line interface task */
+#include "cli.h"      /* Command line interface task */
+#include "cli_args.h" /* Typed command arguments */
+#include "cli_fmt.h"  /* Formatted output */
+#include "cli_jobs.h" /* Asynchronous commands */
 #include "ansi.h"
-#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* clang-format off */
+/* Arguments of 'add': two integers. */
+static const CLI_ArgTypeDef gCliAddArgList[] =
+{
+    { .name = "num1", .type = CLI_ARG_INT },
+    { .name = "num2", .type = CLI_ARG_INT },
+};
+
+/* Arguments of 'diag': duration and depth, both optional. */
+static const CLI_ArgTypeDef gCliDiagArgList[] =
+{
+    { .name = "seconds", .type = CLI_ARG_INT,  .optional = true, .min = 1, .max = 60, .def = "3" },
+    { .name = "mode",    .type = CLI_ARG_ENUM, .optional = true, .choices = "quick|full", .def = "quick" },
+};
+/* clang-format on */
+
+const CLI_ArgsSchemaTypeDef gCliAddArgs  = { gCliAddArgList, SIZEOF_ITEM(gCliAddArgList) };
+const CLI_ArgsSchemaTypeDef gCliDiagArgs = { gCliDiagArgList, SIZEOF_ITEM(gCliDiagArgList) };
 
 /**
  * @brief Shutdown the MCU.
@@ -25,7 +48,16 @@ int cli_exit(int argc, char **argv)
     /* Dump help and exit */
     CLI_SHOW_HELP("Terminate CLI.");
 
-    printf("Shutting down..\n");
+    /* Remote sessions just hang up, the console shuts the process down */
+    if ( CLI_GetCurrentContext() != CLI_GetDefaultContext() )
+    {
+        CLI_Printf("Bye.\n");
+        CLI_ContextEnd(NULL);
+        return EXIT_SUCCESS;
+    }
+
+    CLI_Printf("Shutting down..\n");
+    CLI_Flush();
 
     /* Gracefully terminate the CLI task */
     CLI_TaskTerminate();
@@ -46,7 +78,7 @@ int cli_mcuReset(int argc, char **argv)
     /* Dump help and exit */
     CLI_SHOW_HELP("Core reset.");
 
-    printf("Restarting..\n");
+    CLI_Printf("Restarting..\n");
 
     return EXIT_SUCCESS;
 }
@@ -63,7 +95,7 @@ int cli_ver(int argc, char **argv)
     /* Dump help and exit */
     CLI_SHOW_HELP("Show the product's version.");
 
-    printf("Version 1.1\n");
+    CLI_Printf("Version 1.1\n");
 
     return EXIT_SUCCESS;
 }
@@ -81,57 +113,152 @@ int cli_add(int argc, char **argv)
     /* Dump help and exit */
     CLI_SHOW_HELP("Add 2 numbers.");
 
-    if ( argc != 3 )
-    {
-        printf("Usage: %s <num1> <num2>\n", argv[0]);
-        return EXIT_FAILURE;
-    }
+    /* Both numbers were validated against gCliAddArgs by the engine. */
+    const CLI_ArgsTypeDef *args = CLI_GetArgs();
+    long long              num1 = args->values[0].num;
+    long long              num2 = args->values[1].num;
+
+    long long result = num1 + num2;
+    CLI_Printf("The sum of %lld and %lld is %lld\n", num1, num2, result);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Simulated long running diagnostics, runs on the jobs worker pool.
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return EXIT_SUCCESS on success
+ */
+
+int cli_diag(int argc, char **argv)
+{
+    const CLI_ArgsTypeDef *args;
+    long                   seconds;
+    long                   tick;
+    bool                   full;
+
+    /* Dump help and exit */
+    CLI_SHOW_HELP("Run diagnostics, Ctrl-C to cancel.");
 
-    char *endptr1, *endptr2;
-    long  num1 = strtol(argv[1], &endptr1, 10);
-    long  num2 = strtol(argv[2], &endptr2, 10);
+    /* Defaults are filled in, see gCliDiagArgs. */
+    args    = CLI_GetArgs();
+    seconds = (long) args->values[0].num;
+    full    = args->values[1].num == 1;
 
-    if ( *endptr1 != '\0' || *endptr2 != '\0' )
+    for ( tick = 1; tick <= seconds * 10; tick++ )
     {
-        printf("Invalid number format.\n");
-        return EXIT_FAILURE;
+        if ( CLI_JobIsCancelled() )
+        {
+            CLI_Printf("Diagnostics cancelled.\n");
+            return EXIT_FAILURE;
+        }
+
+        usleep(100000);
+        if ( full )
+            CLI_Printf("Check %ld/%ld OK\n", tick, seconds * 10);
+        else if ( tick % 10 == 0 )
+            CLI_Printf("Pass %ld/%ld OK\n", tick / 10, seconds);
     }
 
-    long result = num1 + num2;
-    printf("The sum of %ld and %ld is %ld\n", num1, num2, result);
+    CLI_Printf("Diagnostics passed.\n");
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Session output counters, a 'stats' subcommand.
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return EXIT_SUCCESS on success
+ */
+
+int cli_statsOutput(int argc, char **argv)
+{
+    CLI_OutStatsTypeDef stats;
+
+    /* Dump help and exit */
+    CLI_SHOW_HELP("Output write calls and bytes.");
+
+    CLI_ContextGetOutStats(CLI_GetCurrentContext(), &stats);
+    CLI_Printf("Write calls: %u, bytes: %u, last command write calls: %u\n", stats.writeCalls, stats.bytesWritten, stats.lastCmdWriteCalls);
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Dumps out the commands list along with each command's help string.
+ * @brief Session typeahead queue counters, a 'stats' subcommand.
  * @param argc Argument count
  * @param argv Argument vector
  * @return EXIT_SUCCESS on success
  */
 
-static int cli_help(int argc, char **argv)
+int cli_statsTypeahead(int argc, char **argv)
 {
-    int             i         = 0;
-    static char    *p_arg     = "@";
-    CLI_CmdTypeDef *p_command = CLI_GetCommandsPtr();
+    CLI_TypeaheadStatsTypeDef stats;
 
     /* Dump help and exit */
-    CLI_SHOW_HELP("List commands.");
+    CLI_SHOW_HELP("Typeahead queue usage.");
+
+    CLI_ContextGetTypeaheadStats(CLI_GetCurrentContext(), &stats);
+    CLI_Printf("Size: %u, pending: %u, high water: %u, overflows: %u\n", stats.size, stats.pending, stats.highWater, stats.overflows);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Dumps out a level of the commands tree, subcommands by their path.
+ * @param cmnds Commands of the level
+ * @param count Count of commands
+ * @param prefix Path of the level
+ */
+
+static void cli_helpLevel(const CLI_CmdTypeDef *cmnds, uint32_t count, const char *prefix)
+{
+    static char *p_arg = "@";
+    char         path[CLI_MAX_LINE_LENGTH];
+    char         usage[CLI_MAX_LINE_LENGTH];
+    uint32_t     i;
 
-    printf("\r\n");
-    while ( p_command && i < CLI_GetCommandCnt() )
+    for ( i = 0; i < count; i++ )
     {
-        printf(ANSI_CYAN "%-20s " ANSI_MODE, p_command->Name);
+        CLI_FmtString(path, sizeof(path), "%s%s", prefix, cmnds[i].Name);
 
         /* Invoke the command with the fixed predefined symbol "@" that should instruct the
-         * command to dump its help string and exit. */
-        p_command->pHandler(2, &p_arg);
-        printf("\r\n");
-
-        p_command++;
-        i++;
+         * command to dump its help string and exit. Groups only list their subcommands. */
+        if ( cmnds[i].pHandler != NULL )
+        {
+            CLI_Printf(ANSI_CYAN "%-20s " ANSI_MODE, path);
+            cmnds[i].pHandler(2, &p_arg);
+            if ( cmnds[i].args != NULL && CLI_ArgsUsage(cmnds[i].args, usage, sizeof(usage)) > 0 )
+                CLI_Printf(" Usage: %s %s", path, usage);
+            CLI_Printf("\r\n");
+        }
+
+        if ( cmnds[i].subCmnds != NULL )
+        {
+            strncat(path, " ", sizeof(path) - strlen(path) - 1);
+            cli_helpLevel(cmnds[i].subCmnds->cmnds, cmnds[i].subCmnds->count, path);
+        }
     }
+}
+
+/**
+ * @brief Dumps out the commands list along with each command's help string.
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return EXIT_SUCCESS on success
+ */
+
+int cli_help(int argc, char **argv)
+{
+    const CLI_CmdTypeDef *p_command = CLI_GetCommandsPtr();
+
+    /* Dump help and exit */
+    CLI_SHOW_HELP("List commands.");
+
+    CLI_Printf("\r\n");
+    if ( p_command )
+        cli_helpLevel(p_command, (uint32_t) CLI_GetCommandCnt(), "");
 
     return EXIT_SUCCESS;
 }
@@ -142,18 +269,15 @@ static int cli_help(int argc, char **argv)
 
 void cli_addCommands(void)
 {
-    /* clang-format off */
-    /* Keep all those CLI tables in a fixed global context (aka 'static const') */
+    /* Keep all those CLI tables in a fixed global context (aka 'static const'),
+     * the commands themselves are listed in clicmds.def. */
     static const CLI_CmdTypeDef gCliBaseCommands[] =
     {
-        // Handler                    Name
-        //-----------------------------------------------
-        { cli_help,                  "?"                },
-        { cli_help,                  "help"             },
-        { cli_exit,                  "exit"             },
-        { cli_mcuReset,              "reset"            },
-        { cli_ver,                   "version"          },
-        { cli_add,                   "add"              },
+#define CLI_COMMAND(handler, name, flags)              { handler, name, flags },
+#define CLI_COMMAND_ARGS(handler, name, flags, schema) { handler, name, flags, &schema },
+#include "clicmds.def"
+#undef CLI_COMMAND
+#undef CLI_COMMAND_ARGS
     };
 
     /* Inject all of the commands found in this module.
@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  *
+  * @file    clicmds_cpp.cpp
+  * @brief   Commands written in C++ through the typed commands layer
+  *          (cli.hpp): the engine validates and completes their arguments,
+  *          the handlers get them typed. Linked into the demo by 'make cpp'.
+  *
+  ******************************************************************************
+  */
+
+#include "cli.hpp" /* Typed C++ commands */
+#include <cinttypes>
+#include <optional>
+#include <string_view>
+
+extern "C" {
+#include "main.h"
+}
+
+namespace
+{
+
+/**
+ * @brief Multiply 2 numbers.
+ * @param a First factor
+ * @param b Second factor
+ * @return EXIT_SUCCESS on success
+ */
+
+int cli_mul(long a, long b)
+{
+    long product;
+
+    if ( __builtin_mul_overflow(a, b, &product) )
+    {
+        CLI_Printf("The product of %ld and %ld overflows\n", a, b);
+        return EXIT_FAILURE;
+    }
+
+    CLI_Printf("The product of %ld and %ld is %ld\n", a, b, product);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Show a 32 bits value bit fields.
+ * @param value Value, typed in hexadecimal
+ * @param width Field width in bits, 8 by default
+ * @return EXIT_SUCCESS on success
+ */
+
+int cli_bits(cli::hex<uint32_t> value, std::optional<uint8_t> width)
+{
+    const uint32_t bits = width.value_or(8);
+    uint32_t       shift;
+
+    if ( bits == 0 || bits > 32 || 32 % bits != 0 )
+    {
+        CLI_Printf("Field width must divide 32\n");
+        return EXIT_FAILURE;
+    }
+
+    for ( shift = 32; shift > 0; shift -= bits )
+        CLI_Printf("[%2" PRIu32 ":%2" PRIu32 "] 0x%" PRIx32 "\n", shift - 1, shift - bits,
+                   (uint32_t) ((uint64_t) value.value >> (shift - bits)) & (uint32_t) ((1ull << bits) - 1));
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Set the terminal output style, shows the command path and a choice.
+ * @param path Command path, as typed
+ * @param color One of the listed colors
+ * @param bold Bold text, off by default
+ * @return EXIT_SUCCESS on success
+ */
+
+int cli_style(std::string_view path, cli::choice<"red|green|blue"> color, std::optional<bool> bold)
+{
+    CLI_Printf("%.*s: %.*s (choice %zu)%s\n", (int) path.size(), path.data(), (int) color.text.size(), color.text.data(),
+               color.index, bold.value_or(false) ? ", bold" : "");
+
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+/**
+ * @brief Registers the CLI commands in this module with the CLI engine.
+ */
+
+void cli_addCppCommands(void)
+{
+    /* The table is built and sorted at compile time, it lives as long as the program. */
+    cli::inject(cli::command<"mul", long, long>(cli_mul, "Multiply 2 numbers."),
+                cli::command<"bits", cli::hex<uint32_t>, std::optional<uint8_t>>(cli_bits, "Split a value into bit fields."),
+                cli::command<"term style", cli::choice<"red|green|blue">, std::optional<bool>>(cli_style, "Show the typed style."));
+}
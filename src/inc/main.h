@@ -14,3 +14,4 @@
 #include <stdlib.h>
 
 void cli_addCommands(void);
+void cli_addCppCommands(void); /* clicmds_cpp.cpp, linked by 'make cpp' only */
@@ -14,8 +14,26 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <ctype.h>
-#include "llist.h" /* Basic lists manipulation */
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <strings.h>
+#include <sys/uio.h>
+#include "cli_args.h"   /* Typed command arguments */
+#include "cli_fmt.h"    /* Formatted output */
+#include "cli_hash.h"   /* Commands perfect hash */
+#include "cli_jobs.h"   /* Asynchronous commands */
+#include "cli_num.h"    /* Integers formatting and parsing */
+#include "cli_plugin.h" /* Commands loaded on first use */
+#include "cli_token.h"  /* Command line tokenizer */
+#include "cli_trie.h"   /* Completion index */
+#include "llist.h"      /* Basic lists manipulation */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /** @defgroup CLI CLI
   * @brief CLI module
@@ -38,13 +56,14 @@
 #define CLI_TAB              202
 #define CLI_ARROW_RIGHT      203
 #define CLI_ARROW_LEFT       204
+#define CLI_CTRL_C           0x03
 #define CLI_MAX_ESCAPE       10
 #define CLI_MIN(a, b)        (((a) < (b)) ? (a) : (b))
-#define CLI_DELIMIT          " "
 #define CLI_MAX_PASSWORD_LEN 12
+#define CLI_TAB_MAX_CHOICES  32 /* Enum choices listed on completion */
 
 /* Send carriage return line feed sequence */
-#define CLI_SEND_CRLF(val) CLI_Print("\r\n", 2)
+#define CLI_SEND_CRLF(ctx) CLI_Print(ctx, "\r\n", 2)
 
 /* ASCII control characters */
 #define ASCII_STX (0x02)
@@ -79,6 +98,7 @@ typedef enum __CLI_EexecTypeDef
     CLI_Exec_AutoComplete,
     CLI_Exec_SearchAndExec,
     CLI_Exec_RetrieveHistory,
+    CLI_Exec_WaitJob,
 
 } CLI_ExecTypeDef;
 
@@ -93,40 +113,113 @@ typedef struct __CLI_TableNode_TypeDef
 
 } CLI_TableNode_TypeDef;
 
+/**
+  * @brief  Output ring, collects echo, prompt and redraw bytes between flushes.
+  */
+typedef struct __CLI_OutRingTypeDef
+{
+    char    *buf;   /* Ring storage */
+    uint32_t size;  /* Ring capacity in bytes */
+    uint32_t head;  /* Next byte is written here */
+    uint32_t count; /* Bytes pending output */
+
+} CLI_OutRingTypeDef;
+
+/**
+  * @brief  Typeahead queue, single producer / single consumer ring holding
+  *         input bytes received while a state is pending. Indices run free
+  *         and are masked on access, only the producer moves 'head' and only
+  *         the consumer moves 'tail'.
+  */
+typedef struct __CLI_InRingTypeDef
+{
+    unsigned char *buf;       /* Ring storage */
+    uint32_t       mask;      /* Ring capacity minus one, capacity is a power of two */
+    uint32_t       head;      /* Producer index */
+    uint32_t       tail;      /* Consumer index */
+    uint32_t       highWater; /* Most bytes ever queued (producer owned) */
+    uint32_t       overflows; /* Bytes refused for lack of room (producer owned) */
+
+} CLI_InRingTypeDef;
+
+/**
+ * @brief
+ *   A merged commands table along with its indexes. Immutable once published,
+ *   replaced as a whole when commands are added or removed.
+ */
+
+typedef struct __CLI_CmdTableTypeDef
+{
+    const CLI_CmdNodeTypeDef     *root;      /* Top level commands, each level with its own indexes. */
+    char                         *names;     /* Words of all levels. */
+    bool                          allocated; /* Levels were allocated (not the build time table). */
+    struct __CLI_CmdTableTypeDef *next;      /* Retired tables list. */
+
+} CLI_CmdTableTypeDef;
+
 /**
  * @brief
- *   The CLI module locals.
+ *   Shared commands tables. Readers never lock: a context publishes the table
+ *   it uses as its hazard pointer, writers swap 'current' atomically and free
+ *   a replaced table once no context refers to it any more.
  */
 
-typedef struct __CLI_DataTypeDef
+typedef struct __CLI_TableTypeDef
 {
+    CLI_CmdTableTypeDef   *current;        /* Published table, NULL until built. */
+    CLI_CmdTableTypeDef   *retired;        /* Replaced tables, waiting for their last reader. */
+    CLI_Context           *readers;        /* Contexts, each holding a hazard pointer. */
+    pthread_mutex_t        lock;           /* Serializes writers and the readers list. */
+    CLI_TableNode_TypeDef *cmndsTableHead; /* Multiple linked CLI tables */
+    CLI_ExtHandlersTypDef  handlers;       /* Handlers of the first initialized context, used to build the table. */
+    bool                   initialized;    /* Handlers were provided. */
+    bool                   commandsSorted; /* Built, from now on tables changes are published right away. */
+
+} CLI_TableTypeDef;
+
+/**
+ * @brief
+ *   A CLI context (console session) locals.
+ */
 
-    char                   line[CLI_MAX_HISTORY_LINES][CLI_MAX_LINE_LENGTH + 16]; /* Command buffer. */
-    char                   argvBuf[CLI_MAX_LINE_LENGTH + 16];                     /* Command line is copied here before execution; then it will be tokenized. */
-    char                   prompt[CLI_MAX_PROMPT + 2];                            /* Prompt textual buffer. */
-    CLI_CmdTypeDef        *cmnds;                                                 /* Commands array. */
-    CLI_TableNode_TypeDef *cmndsTableHead;                                        /* Multiple linked CLI tables */
-    char                  *completion[CLI_MAX_COMPLETIONS];                       /* Command completion */
-    CLI_InitTypeDef        cliInitData;                                           /* CLI configuration provided when initialized. */
-    CLI_ExecTypeDef        execType;                                              /* What to do when we're being triggered from a task context. */
-    uint16_t               cmndsCount;                                            /* Count of loaded commands. */
-    uint8_t                lineIdx;                                               /* Index in the history array. */
-    uint8_t                lineCurrent;                                           /* Where current command is stored. */
-    uint8_t                LineCount;                                             /* How many command stored at all */
-    uint8_t                LineBack;                                              /* Index of command when walking through history */
-    uint32_t               cmndEvent;                                             /* Event to raise  when a command is pending execution. */
-    uint8_t                prmpSize;                                              /* Prompt length. */
-    CLI_EscTypeDef         escapeSequence[CLI_MAX_ESCAPE];                        /* Escape sequence container for arrow up and arrow down. */
-    bool                   receivingEscapeSequence;                               /* Escape sequence. */
-    char                   CurrentEscapeSequence[CLI_MAX_ESCAPE];                 /* Escape sequence. */
-    uint8_t                CurrentEscapeSequenceCount;                            /* Escape sequence. */
-    bool                   initialized;                                           /* Module initialization flag. */
-    bool                   echo;                                                  /* Do we have to echo back to the terminal? */
-    bool                   locked;                                                /* Locks the CLI. */
-    bool                   autoLowerCase;                                         /* Force lower case input. */
-    bool                   commandsSorted;                                        /* Use binary searching. */
+struct __CLI_ContextTypeDef
+{
 
-} CLI_DataTypeDef;
+    char                       line[CLI_MAX_HISTORY_LINES][CLI_MAX_LINE_LENGTH + 16]; /* Command buffer. */
+    char                       argvBuf[CLI_MAX_LINE_LENGTH + 16];                     /* Arguments of the command being executed, NULL terminated words back to back. */
+    char                       prompt[CLI_MAX_PROMPT + 2];                            /* Prompt textual buffer. */
+    CLI_InitTypeDef            cliInitData;                                           /* CLI configuration provided when initialized. */
+    CLI_ExecTypeDef            execType;                                              /* What to do when we're being triggered from a task context. */
+    uint8_t                    lineIdx;                                               /* Index in the history array. */
+    uint8_t                    lineCurrent;                                           /* Where current command is stored. */
+    uint8_t                    LineCount;                                             /* How many command stored at all */
+    uint8_t                    LineBack;                                              /* Index of command when walking through history */
+    uint32_t                   cmndEvent;                                             /* Event to raise  when a command is pending execution. */
+    uint8_t                    prmpSize;                                              /* Prompt length. */
+    CLI_OutRingTypeDef         out;                                                   /* Output ring. */
+    CLI_OutStatsTypeDef        outStats;                                              /* Output counters. */
+    CLI_InRingTypeDef          typeahead;                                             /* Input received while a state is pending. */
+    uint32_t                   outCmdWriteCalls;                                      /* Write syscalls issued for the command in progress. */
+    CLI_EscTypeDef             escapeSequence[CLI_MAX_ESCAPE];                        /* Escape sequence container for arrow up and arrow down. */
+    bool                       receivingEscapeSequence;                               /* Escape sequence. */
+    char                       CurrentEscapeSequence[CLI_MAX_ESCAPE];                 /* Escape sequence. */
+    uint8_t                    CurrentEscapeSequenceCount;                            /* Escape sequence. */
+    bool                       initialized;                                           /* Module initialization flag. */
+    bool                       allocated;                                             /* Context memory was allocated by CLI_ContextCreate(). */
+    bool                       ended;                                                 /* Session end was requested by CLI_ContextEnd(). */
+    bool                       waiting;                                               /* Waiting for 'waitJob' (CLI_Exec_WaitJob). */
+    bool                       interrupted;                                           /* Ctrl-C received while waiting. */
+    uint32_t                   waitJob;                                               /* Job waited for, 0 for all jobs. */
+    bool                       echo;                                                  /* Do we have to echo back to the terminal? */
+    bool                       locked;                                                /* Locks the CLI. */
+    bool                       autoLowerCase;                                         /* Force lower case input. */
+    const CLI_CmdTableTypeDef *table;                                                 /* Commands table held while processing a state. */
+    const CLI_CmdTableTypeDef *hazard;                                                /* Hazard pointer: table this context may be reading. */
+    uint32_t                   tableRefs;                                             /* Nested CLI_TableAcquire() calls. */
+    CLI_Context               *readerPrev;                                            /* Readers list. */
+    CLI_Context               *readerNext;                                            /* Readers list. */
+
+};
 
 /**
   * @}
@@ -137,8 +230,22 @@ typedef struct __CLI_DataTypeDef
   * @{
   */
 
-/*! Global instance of the CLI data structure, some elements must be initialized at compile stage. */
-static CLI_DataTypeDef gCliData = {0};
+/*! The shared commands table. */
+static CLI_TableTypeDef gCliTable = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+#ifdef CLI_STATIC_TABLE
+/*! The build time table, published as is. */
+static CLI_CmdTableTypeDef gCliStaticCmdTable = {0};
+
+/*! The build time table as the first injected one, so that runtime changes merge with it. */
+static CLI_TableNode_TypeDef gCliStaticNode = {0};
+#endif
+
+/*! The default context, the one driven by the CLI task. */
+static CLI_Context gCliData = {0};
+
+/*! Context whose command handler is running on this thread. */
+static __thread CLI_Context *gCliCurrent = NULL;
 
 /**
   * @}
@@ -151,230 +258,577 @@ static CLI_DataTypeDef gCliData = {0};
 
 /**
  * @brief
- *   STD C: Simple byte by byte terminal printer. */
+ *  Tell whoever drives the context that a state is pending execution.
+ */
+
+static void CLI_Alert(CLI_Context *ctx)
+{
+    if ( ctx->cliInitData.alert != NULL )
+        ctx->cliInitData.alert(ctx, ctx->cliInitData.alertArg);
+    else if ( ctx == &gCliData )
+        CLI_TaskAlert();
+}
+
+/**
+ * @brief
+ *  Contexts nobody can be alerted for process their pending states inline.
+ */
+
+static bool CLI_IsInline(CLI_Context *ctx)
+{
+    return ctx->cliInitData.alert == NULL && ctx != &gCliData;
+}
+
+/**
+ * @brief
+ *   Hand output to the I/O backend, or byte by byte to the putc handler when
+ *   no backend was configured. Waits for room when the backend would block and
+ *   has a descriptor to wait on, otherwise fails with EAGAIN: its owner resumes
+ *   the output (a server thread must never block on one of its sessions).
+ * @retval Count of bytes written or -1 when the output is gone or stalled. */
 
-static void CLI_PutByte(char c)
+static ssize_t CLI_OutWritev(CLI_Context *ctx, const struct iovec *iov, int iovcnt)
 {
-    if ( gCliData.cliInitData.handlers.putc )
+    CLI_IoTypeDef *io = ctx->cliInitData.io;
+    struct pollfd  pfd;
+    ssize_t        n = 0;
+    size_t         j;
+    int            i;
+
+    if ( io == NULL )
     {
-        putchar(c);
+        for ( i = 0; i < iovcnt; i++ )
+        {
+            for ( j = 0; j < iov[i].iov_len; j++ )
+                ctx->cliInitData.handlers.putc(((unsigned char *) iov[i].iov_base)[j], stdout);
+            n += (ssize_t) iov[i].iov_len;
+        }
+
         fflush(stdout);
     }
+    else
+    {
+        for ( ;; )
+        {
+            n = CLI_IoWritev(io, iov, iovcnt);
+            if ( n >= 0 )
+                break;
+
+            if ( errno == EINTR )
+                continue;
+
+            if ( errno != EAGAIN || io->outFd < 0 )
+                break; /* Output is gone, or stalled until its owner resumes it. */
+
+            /* Backend would block (e.g. a terminal sharing the non-blocking
+             * input file description), wait for room. */
+            pfd.fd     = io->outFd;
+            pfd.events = POLLOUT;
+            if ( poll(&pfd, 1, -1) < 0 && errno != EINTR )
+                break;
+        }
+    }
+
+    ctx->outStats.writeCalls++;
+    ctx->outCmdWriteCalls++;
+
+    if ( n > 0 )
+        ctx->outStats.bytesWritten += (uint32_t) n;
+
+    return n;
 }
 
 /**
  * @brief
- *   STD C: Simple byte by byte terminal printer. */
+ *   Write out everything pending in the output ring, the ring may wrap so up to
+ *   two segments are handed to a single writev(). Output a stalled backend did
+ *   not take stays in the ring, see CLI_ContextFlush(). */
 
-static void CLI_Print(char *s, int len)
+static void CLI_OutFlush(CLI_Context *ctx)
 {
-    if ( s )
+    CLI_OutRingTypeDef *ring = &ctx->out;
+    struct iovec        iov[2];
+    uint32_t            tail;
+    int                 iovcnt;
+    ssize_t             n;
+
+    if ( ring->count == 0 )
+        return;
+
+    while ( ring->count > 0 )
     {
-        if ( len )
-        {
-            /* GCC pedantic: array subscript 1 is outside array bounds of 1 */
-            if ( len == 1 )
-            {
-                CLI_PutByte(*s);
-                return;
-            }
+        tail            = (ring->head + ring->size - ring->count) % ring->size;
+        iov[0].iov_base = ring->buf + tail;
+        iov[0].iov_len  = CLI_MIN(ring->count, ring->size - tail);
+        iovcnt          = 1;
 
-            /* Print while not NULL and length is not 0 */
-            while ( *s && len )
-            {
-                CLI_PutByte(*s);
-                s++;
-                len--;
-            }
-        }
-        else
+        if ( iov[0].iov_len < ring->count )
         {
-            /* No length, print up to the first NUL occurrence  */
-            while ( *s )
-            {
-                CLI_PutByte(*s);
-                s++;
-            }
+            iov[1].iov_base = ring->buf;
+            iov[1].iov_len  = ring->count - iov[0].iov_len;
+            iovcnt          = 2;
         }
+
+        n = CLI_OutWritev(ctx, iov, iovcnt);
+        if ( n < 0 && errno == EAGAIN )
+            return; /* Stalled, kept until the backend has room. */
+        if ( n < 0 )
+            break; /* Output is gone, drop what we have. */
+
+        ring->count -= (uint32_t) n;
     }
+
+    ring->count = 0;
+    ring->head  = 0;
 }
 
 /**
  * @brief
- * Simple iterative binary search.
- *  Return -1 or the index at which we found the byte in question.
-*/
+ *   Queue bytes in the output ring, flushing whenever it fills up. Without a
+ *   ring (allocation failed) every call results in a direct write. */
 
-static int32_t CLI_SearchChar(CLI_CmdTypeDef *pCommand, int32_t startIndex, int32_t count, char *searched, bool matchAll, bool sorted)
+static void CLI_OutAppend(CLI_Context *ctx, const char *s, size_t len)
 {
-    int32_t middle = -1, i = 0, found = 0;
+    CLI_OutRingTypeDef *ring = &ctx->out;
+    struct iovec        iov;
+    size_t              chunk;
+    ssize_t             n;
 
-    if ( ! searched || ! count || startIndex > count || ! pCommand || *searched == 0 )
-        return -1;
+    if ( (ctx->cliInitData.io == NULL && ctx->cliInitData.handlers.putc == NULL) || len == 0 )
+        return;
+
+    if ( ring->buf == NULL )
+    {
+        while ( len > 0 )
+        {
+            iov.iov_base = (void *) s;
+            iov.iov_len  = len;
 
-    if ( sorted == true )
+            n = CLI_OutWritev(ctx, &iov, 1);
+            if ( n < 0 )
+                break;
+
+            s += n;
+            len -= (size_t) n;
+        }
+        return;
+    }
+
+    while ( len > 0 )
     {
-        while ( startIndex <= count )
+        if ( ring->count == ring->size )
         {
-            middle = startIndex + (count - startIndex) / 2;
-            if ( pCommand[middle].Name[0] == *searched )
+            CLI_OutFlush(ctx);
+
+            /* Still full, the peer does not read its output: end the session
+             * rather than wait for it. */
+            if ( ring->count == ring->size )
             {
-                if ( matchAll == false )
-                    return middle;
-                else
-                    break;
+                ctx->ended = true;
+                return;
             }
-            if ( pCommand[middle].Name[0] < *searched )
-                startIndex = middle + 1;
-            else
-                count = middle - 1;
         }
+
+        /* Largest contiguous free segment. */
+        chunk = CLI_MIN(len, ring->size - ring->count);
+        chunk = CLI_MIN(chunk, ring->size - ring->head);
+
+        memcpy(ring->buf + ring->head, s, chunk);
+        ring->head = (ring->head + (uint32_t) chunk) % ring->size;
+        ring->count += (uint32_t) chunk;
+        s += chunk;
+        len -= chunk;
     }
+}
+
+/**
+ * @brief
+ *   Queue a string for output, up to 'len' bytes or up to the first NUL
+ *   occurrence, whichever comes first. A zero length prints up to the NUL. */
+
+static void CLI_Print(CLI_Context *ctx, const char *s, int len)
+{
+    if ( s )
+        CLI_OutAppend(ctx, s, (len > 0) ? strnlen(s, (size_t) len) : strlen(s));
+}
+
+/**
+ * @brief
+ *   Formatter sinks: the output ring of a context, or the captured output of
+ *   the job running on the calling thread. */
+
+static void CLI_OutSink(void *arg, const char *buf, size_t len)
+{
+    CLI_OutAppend((CLI_Context *) arg, buf, len);
+}
+
+static void CLI_JobSink(void *arg, const char *buf, size_t len)
+{
+    (void) arg;
+    CLI_JobsWrite(buf, len);
+}
+
+/**
+ * @brief
+ *   Queue formatted text for output, see cli_fmt.h. */
+
+static void CLI_ContextPrintf(CLI_Context *ctx, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void CLI_ContextPrintf(CLI_Context *ctx, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    CLI_FmtVPrint(CLI_OutSink, ctx, format, args);
+    va_end(args);
+}
+
+/**
+ * @brief
+ *  Length of the leading run of printable ASCII bytes (0x20..0x7E) in a buffer.
+ *  Scans 16 bytes at a time with SSE2, 8 bytes at a time (SWAR) elsewhere.
+ */
+
+static size_t CLI_PrintableSpan(const unsigned char *buf, size_t len)
+{
+    size_t i = 0;
 
-    /* The array was sorted and we've used the binary search, in this case we
-     * ignore 'matchAll' and return. */
-    if ( sorted == true )
-        return middle;
+#if defined(__SSE2__)
+    const __m128i low = _mm_set1_epi8(0x1F);
+    const __m128i del = _mm_set1_epi8(0x7F);
 
-    if ( matchAll == true )
+    for ( ; i + 16 <= len; i += 16 )
     {
-        found = -1;
+        __m128i  v = _mm_loadu_si128((const __m128i *) (buf + i));
+        uint32_t mask;
 
-        /* Iterate through the command structure looking for a match on the first
-         * parameter (the command).
-         * Check that argument count is OK then call the function. */
+        /* Signed compare: bytes >= 0x80 are negative and fail the '> 0x1F' test. */
+        mask = (uint32_t) _mm_movemask_epi8(_mm_andnot_si128(_mm_cmpeq_epi8(v, del), _mm_cmpgt_epi8(v, low)));
+        if ( mask != 0xFFFF )
+            return i + (size_t) __builtin_ctz(~mask);
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t high = 0x8080808080808080ULL;
 
-        while ( i < gCliData.cmndsCount )
-        {
-            if ( gCliData.cliInitData.handlers.stristr((const char *) searched, (const char *) pCommand[i].Name) != 0 )
-            {
-                found = i;
-                break;
-            }
+    for ( ; i + 8 <= len; i += 8 )
+    {
+        uint64_t w;
 
-            i++;
-        }
+        memcpy(&w, buf + i, sizeof(w));
+
+        /* Any byte < 0x20, or any byte > 0x7E. */
+        if ( (((w - ones * 0x20) & ~w) | ((w + ones * (127 - 0x7E)) | w)) & high )
+            break;
     }
+#endif
+
+    while ( i < len && buf[i] >= 0x20 && buf[i] < 0x7F ) i++;
 
-    return found;
+    return i;
 }
 
 /**
  * @brief
- * Find the number of consecutive matching characters in two strings.
- *  return Number of common character
-*/
+ *  Find a command by name in a level of the table held by the context: one
+ *  hash plus one compare when the perfect hash was built, a linear scan
+ *  otherwise. Only the hot arrays are read, never the commands.
+ *  Return -1 or the command index.
+ */
 
-static uint8_t CLI_MatchChars(char *a, char *b)
+static int32_t CLI_LookupCommand(CLI_Context *ctx, const CLI_CmdNodeTypeDef *node, const char *name)
 {
-    uint8_t al = (uint8_t) strlen(a);
-    uint8_t bl = (uint8_t) strlen(b);
-    uint8_t i;
+    const CLI_HashSlotTypeDef *slot;
+    uint32_t                   i;
 
-    int32_t ml = CLI_MIN(al, bl);
+    if ( node == NULL || node->count == 0 )
+        return -1;
+
+    if ( node->hashDisp != NULL )
+    {
+        slot = CLI_HashLookup(node->hashDisp, node->hashSlots, node->count, name);
+
+        if ( slot != NULL && ctx->cliInitData.handlers.stricmp((const unsigned char *) name, (const unsigned char *) (node->names + slot->nameOff)) == 0 )
+            return (int32_t) slot->index;
 
-    for ( i = 0; i < ml; i++ )
-        if ( a[i] != b[i] )
-            return i;
+        return -1;
+    }
+
+    for ( i = 0; i < node->count; i++ )
+    {
+        if ( ctx->cliInitData.handlers.stricmp((const unsigned char *) name, (const unsigned char *) (node->names + node->nameOffs[i])) == 0 )
+            return (int32_t) i;
+    }
 
-    return 0;
+    return -1;
 }
 
 /**
  * @brief
- *  Implements a simple tab completer that matches on
- *  commands available.
-*/
+ *  List the subcommands of a group, invoked without one of them.
+ */
 
-static uint8_t CLI_TabCompleter(char *cmpLine, uint8_t cmpLen)
+static void CLI_ListGroup(CLI_Context *ctx, const char *path, const CLI_CmdNodeTypeDef *node)
 {
-    uint8_t i               = 0;
-    uint8_t completionCount = 0;
-    char    formatted[64]   = {0};
-    int     flen            = 0;
+    uint32_t i;
 
-    if ( ! gCliData.cmnds ) /* No commands loaded. */
-        return 0;
+    CLI_Print(ctx, "'", 1);
+    CLI_Print(ctx, path, 0);
+    CLI_Print(ctx, "' expects a subcommand:", 0);
 
-    if ( gCliData.commandsSorted == true )
+    for ( i = 0; i < node->count; i++ )
     {
-        /* Sorted array can optimize and search for the first letter in O(log N)
-         * instead of the hideous linear O(N), there are duplicates so this is
-         * as far as we go.
-         */
+        CLI_SEND_CRLF(ctx);
+        CLI_Print(ctx, "  ", 2);
+        CLI_Print(ctx, node->cmnds[i].Name, 0);
+    }
+
+    if ( ctx->echo == true )
+        CLI_SEND_CRLF(ctx);
+}
+
+/**
+ * @brief
+ *  List a completion candidate, three per row.
+ */
+
+static void CLI_TabListItem(CLI_Context *ctx, const char *name, size_t len, uint32_t i, uint32_t matches, uint8_t *display)
+{
+    CLI_ContextPrintf(ctx, "%-19.*s", (int) len, name);
+
+    (*display)++;
+    if ( *display == 3 && i != (matches - 1) )
+    {
+        if ( ctx->echo == true )
+            CLI_SEND_CRLF(ctx);
+        *display = 0;
+    }
+    else
+        CLI_Print(ctx, " ", 1);
+}
+
+/**
+ * @brief
+ *  Complete an argument of a command declaring them: enums against their
+ *  choices, anything else shows the command usage.
+ */
 
-        if ( CLI_SearchChar(gCliData.cmnds, 0, gCliData.cmndsCount, cmpLine, false, gCliData.commandsSorted) == -1 )
-            return completionCount;
+static uint32_t CLI_TabCompleteArg(CLI_Context *ctx, const CLI_CmdTypeDef *cmd, const char *path, uint32_t argIdx, uint32_t start,
+                                   uint32_t cmpLen)
+{
+    const char *choices[CLI_TAB_MAX_CHOICES];
+    size_t      lengths[CLI_TAB_MAX_CHOICES];
+    char        usage[CLI_MAX_LINE_LENGTH];
+    char       *line    = ctx->line[ctx->lineCurrent];
+    uint32_t    matches = 0;
+    uint32_t    common;
+    uint32_t    i;
+    uint8_t     display = 0;
+
+    if ( argIdx < cmd->args->count )
+        matches = CLI_ArgsComplete(&cmd->args->args[argIdx], line + start, cmpLen - start, choices, lengths, CLI_TAB_MAX_CHOICES);
+
+    if ( matches == 0 )
+    {
+        CLI_ArgsUsage(cmd->args, usage, sizeof(usage));
+        CLI_SEND_CRLF(ctx);
+        CLI_Print(ctx, "Usage: ", 0);
+        CLI_Print(ctx, path, 0);
+        CLI_Print(ctx, usage, 0);
+        CLI_SEND_CRLF(ctx);
+        CLI_ContextPrintPrompt(ctx, 1);
+        CLI_Print(ctx, line, 0);
+        return 0;
     }
 
-    while ( i < gCliData.cmndsCount && completionCount < CLI_MAX_COMPLETIONS )
+    /* Longest prefix shared by the matching choices, written as declared. */
+    common = (uint32_t) lengths[0];
+    for ( i = 1; i < matches; i++ )
     {
-        /* Parasoft : The size_t argument passed to any function in string.h shall have an appropriate value [BD-API-STRSIZE] */
-        if ( (cmpLen > 0) && (strncmp(gCliData.cmnds[i].Name, cmpLine, cmpLen) == 0) )
-        {
-            gCliData.completion[completionCount] = (char *) gCliData.cmnds[i].Name;
-            completionCount++;
-        }
+        common = (uint32_t) CLI_MIN(common, lengths[i]);
+        while ( common > 0 && strncasecmp(choices[0], choices[i], common) != 0 )
+            common--;
+    }
+
+    if ( start + common > CLI_MAX_LINE_LENGTH - 2 )
+        common = CLI_MAX_LINE_LENGTH - 2 - start;
+
+    /* What was typed stays as typed, it is already on the terminal. */
+    if ( start + common > cmpLen )
+        memcpy(line + cmpLen, choices[0] + (cmpLen - start), start + common - cmpLen);
+    ctx->lineIdx       = (uint8_t) (start + common);
+    line[ctx->lineIdx] = '\0';
+
+    if ( matches == 1 )
+    {
+        line[ctx->lineIdx++] = ' ';
+        line[ctx->lineIdx]   = '\0';
+    }
 
-        i++;
+    if ( start + common > cmpLen || matches == 1 )
+        CLI_Print(ctx, line + cmpLen, 0);
+    else
+    {
+        if ( ctx->echo == true )
+            CLI_SEND_CRLF(ctx);
+        for ( i = 0; i < matches; i++ )
+            CLI_TabListItem(ctx, choices[i], lengths[i], i, matches, &display);
+
+        if ( ctx->echo == true )
+            CLI_SEND_CRLF(ctx);
+        CLI_ContextPrintPrompt(ctx, 1);
+        CLI_Print(ctx, line, 0);
     }
 
-    if ( completionCount > 0 )
+    return matches;
+}
+
+static const CLI_CmdTableTypeDef *CLI_TableAcquire(CLI_Context *ctx);
+static void                       CLI_TableRelease(CLI_Context *ctx);
+
+/**
+ * @brief
+ *  Implements a tab completer over the commands available. The complete words
+ *  of the line walk down the subcommands levels, the last word is completed
+ *  against its level: the trie yields the candidates and their longest common
+ *  prefix in O(prefix length), the word is extended to that prefix, or the
+ *  candidates are listed when it can't be extended. Past a command declaring
+ *  its arguments, the last word is completed against that argument, a plugin
+ *  command is loaded first.
+*/
+
+static uint32_t CLI_TabCompleter(CLI_Context *ctx, char *cmpLine, uint8_t cmpLen)
+{
+    uint32_t                  i                         = 0;
+    uint32_t                  first                     = 0;
+    uint32_t                  matches                   = 0;
+    uint32_t                  common                    = 0;
+    uint32_t                  plen                      = 0;
+    uint32_t                  start                     = 0; /* Offset of the word to complete */
+    uint32_t                  end                       = 0;
+    uint32_t                  pathLen                   = 0;
+    uint32_t                  argIdx                    = 0; /* Arguments typed past 'cmd' */
+    int32_t                   index                     = 0;
+    uint8_t                   display                   = 0;
+    char                      word[CLI_MAX_LINE_LENGTH] = {0};
+    char                      path[CLI_MAX_LINE_LENGTH] = {0}; /* Walked commands path */
+    char                     *line                      = ctx->line[ctx->lineCurrent];
+    const CLI_CmdNodeTypeDef *node                      = (ctx->table != NULL) ? ctx->table->root : NULL;
+    const CLI_CmdTypeDef     *last                      = NULL; /* Last command walked */
+    const CLI_CmdTypeDef     *cmd                       = NULL; /* Command whose arguments are typed */
+
+    if ( node == NULL || cmpLen == 0 ) /* No commands loaded or nothing to complete. */
+        return 0;
+
+    /* Walk the complete words down the levels, stop on the last one. */
+    while ( 1 )
     {
-        char   *lcd  = gCliData.completion[0] + cmpLen;
-        uint8_t plen = (uint8_t) strlen(lcd);
-        uint8_t nlen = 0;
-        char   *line = gCliData.line[gCliData.lineCurrent];
+        for ( start = end; start < cmpLen && cmpLine[start] == ' '; start++ )
+            ;
+        for ( end = start; end < cmpLen && cmpLine[end] != ' '; end++ )
+            ;
+
+        if ( end == cmpLen )
+            break;
 
-        for ( i = 1; i < completionCount; i++ )
+        if ( cmd != NULL )
         {
-            nlen = CLI_MatchChars(lcd, gCliData.completion[i] + cmpLen);
-            if ( nlen < plen )
-                plen = nlen;
+            argIdx++;
+            continue;
         }
 
-        gCliData.lineIdx = cmpLen + plen;
-        memcpy(line, gCliData.completion[0], gCliData.lineIdx);
-        line[gCliData.lineIdx] = '\0';
+        memcpy(word, cmpLine + start, end - start);
+        word[end - start] = '\0';
 
-        if ( completionCount == 1 )
+        index = (last == NULL || last->subCmnds != NULL) ? CLI_LookupCommand(ctx, node, word) : -1;
+        if ( index < 0 )
         {
-            line[gCliData.lineIdx++] = ' ';
-            line[gCliData.lineIdx]   = '\0';
+            /* Not a command, the first argument of the last one if it declared them. */
+            if ( last == NULL || (last->args == NULL && ! (last->flags & CLI_CMD_FLAG_LAZY)) )
+                return 0;
+
+            cmd    = last;
+            argIdx = 1;
+            continue;
         }
 
-        if ( plen != 0 )
-            CLI_Print(line + cmpLen, 0);
-        else
-        {
-            uint8_t display = 0;
-            if ( gCliData.echo == true )
-                CLI_SEND_CRLF();
-            for ( i = 0; i < completionCount; i++ )
-            {
-                flen = snprintf(formatted, (sizeof(formatted) - 1), "%-19s", gCliData.completion[i]);
-                if ( flen > 0 )
-                    CLI_Print(formatted, flen);
+        last     = &node->cmnds[index];
+        pathLen += (uint32_t) CLI_FmtString(path + pathLen, sizeof(path) - pathLen, "%s ", last->Name);
+        if ( last->subCmnds != NULL )
+            node = last->subCmnds;
+    }
 
-                display++;
-                if ( display == 3 && i != (completionCount - 1) )
-                {
-                    if ( gCliData.echo == true )
-                        CLI_SEND_CRLF();
-                    display = 0;
-                }
-                else
-                    printf(" ");
-            }
+    /* The last command takes arguments rather than subcommands. */
+    if ( cmd == NULL && last != NULL && last->subCmnds == NULL )
+    {
+        if ( last->args == NULL && ! (last->flags & CLI_CMD_FLAG_LAZY) )
+            return 0;
+        cmd = last;
+    }
+
+    /* Arguments of a plugin command, whose schema is only known once loaded:
+     * load it and complete against the table it published. */
+    if ( cmd != NULL && (cmd->flags & CLI_CMD_FLAG_LAZY) )
+    {
+        path[pathLen - 1] = '\0';
+        if ( ctx->tableRefs != 1 || ! CLI_PluginLoad(path) )
+            return 0;
+
+        CLI_TableRelease(ctx);
+        CLI_TableAcquire(ctx);
+        return CLI_TabCompleter(ctx, cmpLine, cmpLen);
+    }
+
+    if ( cmd != NULL )
+        return CLI_TabCompleteArg(ctx, cmd, path, argIdx, start, cmpLen);
+
+    /* Only subcommands are listed out of nothing. */
+    if ( start == cmpLen && node == ctx->table->root )
+        return 0;
+
+    if ( ! CLI_TrieFind(node->trie, node->names, node->nameOffs, node->count, cmpLine + start, cmpLen - start, &first, &matches, &common) )
+        return 0;
+
+    /* Never grow the line past its buffer. */
+    if ( start + common > CLI_MAX_LINE_LENGTH - 2 )
+        common = CLI_MAX_LINE_LENGTH - 2 - start;
+    plen   = start + common - cmpLen;
+
+    /* Only the completed bytes are added: the prefix stays as typed, the
+     * lookup ignoring case, so that the line matches the screen. */
+    ctx->lineIdx = (uint8_t) (start + common);
+    memcpy(line + cmpLen, node->names + node->nameOffs[first] + (cmpLen - start), plen);
+    line[ctx->lineIdx] = '\0';
 
-            if ( gCliData.echo == true )
-                CLI_SEND_CRLF();
-            CLI_PrintPrompt(1);
-            CLI_Print(line, 0);
+    if ( matches == 1 )
+    {
+        line[ctx->lineIdx++] = ' ';
+        line[ctx->lineIdx]   = '\0';
+
+        /* Completed to a plugin command, have it ready by the time it is invoked. */
+        if ( node->cmnds[first].flags & CLI_CMD_FLAG_LAZY )
+        {
+            CLI_FmtString(path + pathLen, sizeof(path) - pathLen, "%s", node->names + node->nameOffs[first]);
+            CLI_PluginLoad(path);
         }
     }
 
-    return completionCount;
+    /* Extended, if only by the space ending a complete word. */
+    if ( plen != 0 || matches == 1 )
+        CLI_Print(ctx, line + cmpLen, 0);
+    else
+    {
+        if ( ctx->echo == true )
+            CLI_SEND_CRLF(ctx);
+        for ( i = 0; i < matches; i++ )
+            CLI_TabListItem(ctx, node->names + node->nameOffs[first + i], strlen(node->names + node->nameOffs[first + i]), i, matches, &display);
+
+        if ( ctx->echo == true )
+            CLI_SEND_CRLF(ctx);
+        CLI_ContextPrintPrompt(ctx, 1);
+        CLI_Print(ctx, line, 0);
+    }
+
+    return matches;
 }
 
 /**
@@ -386,19 +840,19 @@ static uint8_t CLI_TabCompleter(char *cmpLine, uint8_t cmpLen)
  * another valid escape sequence.
  */
 
-static uint8_t CLI_ProcessEscapeSequnceChar(char c)
+static uint8_t CLI_ProcessEscapeSequnceChar(CLI_Context *ctx, char c)
 {
     uint8_t idx        = 0;
     uint8_t matchCount = 0;
     uint8_t matchIdx   = 0;
 
-    gCliData.CurrentEscapeSequence[gCliData.CurrentEscapeSequenceCount++] = c;
+    ctx->CurrentEscapeSequence[ctx->CurrentEscapeSequenceCount++] = c;
 
     /* Look for matching escape sequences. */
-    for ( idx = 0; gCliData.escapeSequence[idx].string; idx++ )
+    for ( idx = 0; ctx->escapeSequence[idx].string; idx++ )
     {
 
-        if ( strncmp(gCliData.CurrentEscapeSequence, gCliData.escapeSequence[idx].string, gCliData.CurrentEscapeSequenceCount) == 0 )
+        if ( strncmp(ctx->CurrentEscapeSequence, ctx->escapeSequence[idx].string, ctx->CurrentEscapeSequenceCount) == 0 )
         {
             matchCount++;
             matchIdx = idx;
@@ -410,13 +864,13 @@ static uint8_t CLI_ProcessEscapeSequnceChar(char c)
     {
         case 0:
             /* No match, discard escape sequence, finish escape mode. */
-            gCliData.receivingEscapeSequence = false;
+            ctx->receivingEscapeSequence = false;
             return 0;
 
         case 1:
             /* Unique match, process the sequence, finish escape mode. */
-            gCliData.receivingEscapeSequence = false;
-            return gCliData.escapeSequence[matchIdx].value;
+            ctx->receivingEscapeSequence = false;
+            return ctx->escapeSequence[matchIdx].value;
 
         default:
             /* Multiple matches, continue reading. */
@@ -426,7 +880,7 @@ static uint8_t CLI_ProcessEscapeSequnceChar(char c)
 
 /**
  * @brief
- *  STDC qsort required comparator, used only when dynamic memory is available.
+ *  Table building comparator, used only when dynamic memory is available.
  *  Compare command a and b alphabetically according to it's name property.
  */
 
@@ -437,169 +891,956 @@ static int CLI_Compare(const void *a, const void *b)
 
 /**
  * @brief
- *  Use ANSI codes to erase a single char.
+ *  Stable bottom-up merge sort of one injected table (run), so that when a
+ *  module lists a name twice its first entry still comes first. 'scratch'
+ *  must hold 'count' entries.
  */
 
-static void CLI_EraseChar(void)
+static void CLI_SortRun(CLI_CmdTypeDef *run, CLI_CmdTypeDef *scratch, uint32_t count)
 {
-    if ( gCliData.lineIdx != 0 )
+    CLI_CmdTypeDef *src = run;
+    CLI_CmdTypeDef *dst = scratch;
+    CLI_CmdTypeDef *tmp;
+    uint32_t        width, lo, mid, hi;
+    uint32_t        a, b, k;
+
+    /* Modules usually list their commands in order already. */
+    for ( k = 1; k < count && CLI_Compare(&run[k - 1], &run[k]) <= 0; k++ )
+        ;
+    if ( k >= count )
+        return;
+
+    for ( width = 1; width < count; width *= 2 )
     {
-        gCliData.line[gCliData.lineCurrent][--gCliData.lineIdx] = '\0';
-        CLI_Print("\b \b", 3);
+        for ( lo = 0; lo < count; lo += 2 * width )
+        {
+            mid = CLI_MIN(lo + width, count);
+            hi  = CLI_MIN(lo + 2 * width, count);
+
+            for ( a = lo, b = mid, k = lo; a < mid && b < hi; )
+                dst[k++] = (CLI_Compare(&src[b], &src[a]) < 0) ? src[b++] : src[a++];
+            while ( a < mid )
+                dst[k++] = src[a++];
+            while ( b < hi )
+                dst[k++] = src[b++];
+        }
+
+        tmp = src;
+        src = dst;
+        dst = tmp;
     }
+
+    if ( src != run )
+        memcpy(run, src, count * sizeof(CLI_CmdTypeDef));
 }
 
 /**
  * @brief
- *  Use ANSI codes to erase current line.
+ *  Merge heap order: smallest head name first, on equal names the run
+ *  injected first.
  */
 
-static void CLI_EraseLine(void)
+static bool CLI_RunLess(const CLI_CmdTypeDef *cmnds, const uint32_t *runPos, uint32_t a, uint32_t b)
 {
+    int cmp = CLI_Compare(&cmnds[runPos[a]], &cmnds[runPos[b]]);
 
-    /* Clear all characters from the cursor position to the end of the line
-     * using ANSI codes. */
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+static void CLI_HeapDown(const CLI_CmdTypeDef *cmnds, const uint32_t *runPos, uint32_t *heap, uint32_t size, uint32_t i)
+{
+    uint32_t top = heap[i];
+    uint32_t child;
 
-    char cmd[]     = {"\033["};
-    char lenVal[8] = {0};
+    while ( (child = 2 * i + 1) < size )
+    {
+        if ( child + 1 < size && CLI_RunLess(cmnds, runPos, heap[child + 1], heap[child]) )
+            child++;
+
+        if ( ! CLI_RunLess(cmnds, runPos, heap[child], top) )
+            break;
 
-    int len = gCliData.prmpSize + gCliData.lineIdx;
-    gCliData.cliInitData.handlers.itoa(len, lenVal, 10);
-    len = (int) strlen(lenVal);
+        heap[i] = heap[child];
+        i       = child;
+    }
 
-    CLI_Print(cmd, sizeof(cmd));
-    CLI_Print(lenVal, len);
-    CLI_Print("D\033[K", 4);
+    heap[i] = top;
 }
 
 /**
  * @brief
- *  Goes LineBack command back, retrieves command from history and puts
- *  it in current slot.
+ *  K-way merge of the sorted runs into 'out', dropping duplicated names: the
+ *  first one popped, hence the first injected, wins.
+ *  Return the count of merged commands.
  */
 
-static bool cliRetrieveHistory(void)
+static uint32_t CLI_MergeRuns(CLI_CmdTypeDef *out, const CLI_CmdTypeDef *cmnds, const uint32_t *runStart, uint32_t runs, uint32_t *runPos,
+                              uint32_t *heap)
 {
-    uint8_t history_idx = 0;
-    char   *src_line    = NULL; /* Copy command line from here. */
-    char   *dst_line    = NULL; /* Copy command line there. */
-    int     len;
+    uint32_t size  = 0;
+    uint32_t count = 0;
+    uint32_t r;
 
-    CLI_EraseLine();
+    for ( r = 0; r < runs; r++ )
+    {
+        runPos[r] = runStart[r];
+        if ( runPos[r] < runStart[r + 1] )
+            heap[size++] = r;
+    }
 
-    history_idx = (gCliData.lineCurrent + CLI_MAX_HISTORY_LINES - gCliData.LineBack);
-    history_idx %= CLI_MAX_HISTORY_LINES;
-    src_line = gCliData.line[history_idx];
-    dst_line = gCliData.line[gCliData.lineCurrent];
+    for ( r = size / 2; r-- > 0; )
+        CLI_HeapDown(cmnds, runPos, heap, size, r);
 
-    /* Copy from history to current command line. */
-    for ( gCliData.lineIdx = 0; src_line[gCliData.lineIdx]; gCliData.lineIdx++ )
+    while ( size > 0 )
     {
-        dst_line[gCliData.lineIdx] = src_line[gCliData.lineIdx];
-    }
+        r = heap[0];
 
-    dst_line[gCliData.lineIdx] = '\0';
+        if ( count == 0 || CLI_Compare(&out[count - 1], &cmnds[runPos[r]]) != 0 )
+            out[count++] = cmnds[runPos[r]];
 
-    /* Print new command line. */
-    CLI_PrintPrompt(0);
-    len = strlen(gCliData.line[gCliData.lineCurrent]);
+        if ( ++runPos[r] == runStart[r + 1] )
+            heap[0] = heap[--size];
 
-    CLI_Print(gCliData.line[gCliData.lineCurrent], len);
-    return true;
+        if ( size > 0 )
+            CLI_HeapDown(cmnds, runPos, heap, size, 0);
+    }
+
+    return count;
 }
 
 /**
  * @brief
- *  Parse the input buffer.  This will tokenize the input line buffer
+ *  Build the perfect hash over a sorted level. On failure the hash is left
+ *  unset and lookups fall back to scanning the level.
+ */
+
+static bool CLI_BuildHash(CLI_CmdNodeTypeDef *node)
+{
+    int32_t             *disp  = gCliTable.handlers.malloc(node->count * sizeof(int32_t));
+    CLI_HashSlotTypeDef *slots = gCliTable.handlers.malloc(node->count * sizeof(CLI_HashSlotTypeDef));
+
+    if ( disp && slots &&
+         CLI_HashBuild(node->names, node->nameOffs, node->count, disp, slots, gCliTable.handlers.malloc, gCliTable.handlers.free) )
+    {
+        node->hashDisp  = disp;
+        node->hashSlots = slots;
+        return true;
+    }
+
+    if ( disp )
+        gCliTable.handlers.free(disp);
+    if ( slots )
+        gCliTable.handlers.free(slots);
+
+    return false;
+}
+
+/**
+ * @brief
+ *  Build the completion trie over a sorted level.
+ */
+
+static bool CLI_BuildTrie(CLI_CmdNodeTypeDef *node)
+{
+    CLI_TrieNodeTypeDef *nodes = gCliTable.handlers.malloc(CLI_TrieMaxNodes(node->count) * sizeof(CLI_TrieNodeTypeDef));
+
+    if ( nodes == NULL )
+        return false;
+
+    CLI_TrieBuild(node->names, node->nameOffs, node->count, nodes);
+    node->trie = nodes;
+
+    return true;
+}
+
+/**
+ * @brief
+ *  Normalize a command path in place: trimmed, lower cased and its words
+ *  separated by single spaces. Return its length.
+ */
+
+static uint32_t CLI_PathNormalize(char *path)
+{
+    const char *src = path;
+    uint32_t    len = 0;
+
+    while ( *src )
+    {
+        while ( isspace((unsigned char) *src) )
+            src++;
+
+        if ( *src == 0 )
+            break;
+
+        if ( len > 0 )
+            path[len++] = ' ';
+
+        while ( *src && ! isspace((unsigned char) *src) )
+            path[len++] = *src++;
+    }
+
+    path[len] = 0;
+    gCliTable.handlers.strlwr(path);
+
+    return len;
+}
+
+/**
+ * @brief
+ *  Count the commands of an injected table, nested ones included, and the
+ *  bytes their full paths take.
+ */
+
+static void CLI_PathsCount(const CLI_CmdTypeDef *cmnds, uint32_t count, uint32_t prefixLen, uint32_t *items, uint32_t *bytes)
+{
+    uint32_t i;
+    uint32_t len;
+
+    for ( i = 0; i < count; i++ )
+    {
+        if ( cmnds[i].Name == NULL )
+            continue;
+
+        len = prefixLen + (uint32_t) strlen(cmnds[i].Name) + 1;
+        (*items)++;
+        *bytes += len + 1;
+
+        if ( cmnds[i].subCmnds != NULL )
+            CLI_PathsCount(cmnds[i].subCmnds->cmnds, cmnds[i].subCmnds->count, len, items, bytes);
+    }
+}
+
+/**
+ * @brief
+ *  Copy the commands of an injected table as full paths to 'out', nested
+ *  ones included, the paths are written to '*pool'.
+ *  Return the count of copied commands.
+ */
+
+static uint32_t CLI_PathsCopy(const CLI_CmdTypeDef *cmnds, uint32_t count, const char *prefix, CLI_CmdTypeDef *out, char **pool)
+{
+    uint32_t copied = 0;
+    uint32_t i;
+    char    *path;
+
+    for ( i = 0; i < count; i++ )
+    {
+        if ( cmnds[i].Name == NULL )
+            continue;
+
+        path    = *pool;
+        *pool  += CLI_FmtString(path, SIZE_MAX, "%s%s%s", prefix, (*prefix != 0) ? " " : "", cmnds[i].Name) + 1;
+        if ( CLI_PathNormalize(path) == 0 )
+            continue;
+
+        out[copied]          = cmnds[i];
+        out[copied].Name     = path;
+        out[copied].subCmnds = NULL;
+        copied++;
+
+        if ( cmnds[i].subCmnds != NULL )
+            copied += CLI_PathsCopy(cmnds[i].subCmnds->cmnds, cmnds[i].subCmnds->count, path, out + copied, pool);
+    }
+
+    return copied;
+}
+
+/**
+ * @brief
+ *  Release a level and the levels below it.
+ */
+
+static void CLI_NodeFree(CLI_CmdNodeTypeDef *node)
+{
+    uint32_t i;
+
+    for ( i = 0; node->cmnds != NULL && i < node->count; i++ )
+    {
+        if ( node->cmnds[i].subCmnds != NULL )
+            CLI_NodeFree((CLI_CmdNodeTypeDef *) node->cmnds[i].subCmnds);
+    }
+
+    if ( node->cmnds )
+        gCliTable.handlers.free((void *) node->cmnds);
+    if ( node->nameOffs )
+        gCliTable.handlers.free((void *) node->nameOffs);
+    if ( node->hashDisp )
+        gCliTable.handlers.free((void *) node->hashDisp);
+    if ( node->hashSlots )
+        gCliTable.handlers.free((void *) node->hashSlots);
+    if ( node->trie )
+        gCliTable.handlers.free((void *) node->trie);
+    gCliTable.handlers.free(node);
+}
+
+/**
+ * @brief
+ *  Build the level of the sorted, unique 'paths[lo, hi)' whose words start at
+ *  'offset': one command per distinct word, holding the paths going on past
+ *  it as its subcommands. Such paths are contiguous as ' ' sorts before any
+ *  other name character. The level words are copied to '*pool' back to back,
+ *  ahead of the levels below it, so that searching the level reads them
+ *  sequentially.
+ *  Return the level, NULL on error.
+ */
+
+static CLI_CmdNodeTypeDef *CLI_NodeBuild(const CLI_CmdTypeDef *paths, uint32_t lo, uint32_t hi, uint32_t offset, char **pool)
+{
+    CLI_CmdNodeTypeDef *node;
+    CLI_CmdTypeDef     *cmnds;
+    uint32_t           *nameOffs;
+    char               *names = *pool;
+    const char         *word;
+    uint32_t            count = 0;
+    uint32_t            len;
+    uint32_t            i, j, k;
+
+    for ( i = lo; i < hi; i = j, count++ )
+    {
+        word = paths[i].Name + offset;
+        len  = (uint32_t) strcspn(word, " ");
+        for ( j = i + 1; j < hi && strncmp(paths[j].Name + offset, word, len) == 0 && paths[j].Name[offset + len] == ' '; j++ )
+            ;
+    }
+
+    node     = gCliTable.handlers.malloc(sizeof(CLI_CmdNodeTypeDef));
+    cmnds    = gCliTable.handlers.malloc((count + 1) * sizeof(CLI_CmdTypeDef));
+    nameOffs = gCliTable.handlers.malloc(count * sizeof(uint32_t));
+    if ( node == NULL || cmnds == NULL || nameOffs == NULL )
+    {
+        if ( node )
+            gCliTable.handlers.free(node);
+        if ( cmnds )
+            gCliTable.handlers.free(cmnds);
+        if ( nameOffs )
+            gCliTable.handlers.free(nameOffs);
+        return NULL;
+    }
+
+    memset(node, 0, sizeof(CLI_CmdNodeTypeDef));
+    memset(cmnds, 0, (count + 1) * sizeof(CLI_CmdTypeDef)); /* Terminating entry included */
+    node->cmnds    = cmnds;
+    node->names    = names;
+    node->nameOffs = nameOffs;
+
+    /* The level words first, interned once whatever their length. */
+    for ( i = lo, k = 0; i < hi; i = j, k++ )
+    {
+        word = paths[i].Name + offset;
+        len  = (uint32_t) strcspn(word, " ");
+        for ( j = i + 1; j < hi && strncmp(paths[j].Name + offset, word, len) == 0 && paths[j].Name[offset + len] == ' '; j++ )
+            ;
+
+        nameOffs[k]   = (uint32_t) (*pool - names);
+        cmnds[k].Name = memcpy(*pool, word, len);
+        (*pool)[len]  = 0;
+        *pool        += len + 1;
+    }
+
+    for ( i = lo, k = 0; i < hi; i = j, k++ )
+    {
+        word = paths[i].Name + offset;
+        len  = (uint32_t) strcspn(word, " ");
+        for ( j = i + 1; j < hi && strncmp(paths[j].Name + offset, word, len) == 0 && paths[j].Name[offset + len] == ' '; j++ )
+            ;
+
+        /* The path ending with this word, if any, sorts first. Otherwise a group. */
+        if ( word[len] == 0 )
+        {
+            cmnds[k].pHandler = paths[i].pHandler;
+            cmnds[k].flags    = paths[i].flags;
+            cmnds[k].args     = paths[i].args;
+            i++;
+        }
+
+        if ( i < j )
+        {
+            cmnds[k].subCmnds = CLI_NodeBuild(paths, i, j, offset + len + 1, pool);
+            if ( cmnds[k].subCmnds == NULL )
+            {
+                node->count = k;
+                CLI_NodeFree(node);
+                return NULL;
+            }
+        }
+    }
+
+    /* Dispatch and completion indexes, both scan the level if they could not be built. */
+    node->count = count;
+    CLI_BuildHash(node);
+    CLI_BuildTrie(node);
+
+    return node;
+}
+
+/**
+ * @brief
+ *  Release a table that is no longer published nor read.
+ */
+
+static void CLI_TableFree(CLI_CmdTableTypeDef *table)
+{
+    if ( table->allocated == false )
+        return; /* The build time table */
+
+    CLI_NodeFree((CLI_CmdNodeTypeDef *) table->root);
+    gCliTable.handlers.free(table->names);
+    gCliTable.handlers.free(table);
+}
+
+/**
+ * @brief
+ *  Aggregate all injected tables but 'skip' into a new table: sort each one,
+ *  then k-way merge them while dropping duplicated commands (the first
+ *  injected wins), then split the commands paths into the levels of the
+ *  tree, each with its dispatch and completion indexes.
+ *  Writers lock held. Return the new table, NULL on error or when no
+ *  commands are left ('*empty' tells which).
+ */
+
+static CLI_CmdTableTypeDef *CLI_TableBuild(const CLI_TableNode_TypeDef *skip, bool *empty)
+{
+    uint32_t               total_items = 0;
+    uint32_t               total_bytes = 0;
+    uint32_t               total_mem   = 0;
+    uint32_t               runs        = 0;
+    uint32_t               i           = 0;
+    uint32_t               r           = 0;
+    uint32_t               count       = 0;
+    CLI_CmdTableTypeDef   *table       = NULL;
+    CLI_TableNode_TypeDef *instance    = NULL;
+    CLI_CmdTypeDef        *cmnds       = NULL; /* Injected tables, one sorted run each */
+    CLI_CmdTypeDef        *merged      = NULL; /* The merged paths, sort scratch before that */
+    uint32_t              *runStart    = NULL; /* Runs bounds in 'cmnds' */
+    uint32_t              *runPos      = NULL; /* Merge cursors */
+    uint32_t              *heap        = NULL; /* Merge heap of runs */
+    char                  *paths       = NULL; /* Normalized full paths */
+    char                  *names       = NULL; /* Words of all levels, kept by the table */
+    char                  *pool;
+
+    *empty = false;
+
+    do
+    {
+        /* Count all entries thought all instances so we could calculate
+         * the total required memory for all of them.
+         */
+
+        LL_FOREACH(gCliTable.cmndsTableHead, instance)
+        {
+            if ( instance == skip )
+                continue;
+            CLI_PathsCount(instance->table, instance->items, 0, &total_items, &total_bytes);
+            runs++;
+        }
+
+        if ( total_items == 0 )
+        {
+            *empty = true;
+            break;
+        }
+
+        total_mem = ((total_items + 1) * sizeof(CLI_CmdTypeDef));
+
+        /* Attempt to allocate */
+        table    = gCliTable.handlers.malloc(sizeof(CLI_CmdTableTypeDef));
+        cmnds    = gCliTable.handlers.malloc(total_mem);
+        merged   = gCliTable.handlers.malloc(total_mem);
+        runStart = gCliTable.handlers.malloc((runs + 1) * sizeof(uint32_t));
+        runPos   = gCliTable.handlers.malloc(runs * sizeof(uint32_t));
+        heap     = gCliTable.handlers.malloc(runs * sizeof(uint32_t));
+        paths    = gCliTable.handlers.malloc(total_bytes);
+        names    = gCliTable.handlers.malloc(total_bytes);
+
+        /* No root until it is built, the table is dropped on every early exit. */
+        if ( table != NULL )
+            memset(table, 0, sizeof(CLI_CmdTableTypeDef));
+
+        if ( table == NULL || cmnds == NULL || merged == NULL || runStart == NULL || runPos == NULL || heap == NULL || paths == NULL || names == NULL )
+            break;
+
+        /* Copy every injected table as a run of full paths, lower cased and trimmed. */
+        pool = paths;
+        LL_FOREACH(gCliTable.cmndsTableHead, instance)
+        {
+            if ( instance == skip )
+                continue;
+
+            runStart[r++] = i;
+            i += CLI_PathsCopy(instance->table, instance->items, "", &cmnds[i], &pool);
+        }
+        runStart[r] = i;
+
+        /* Sort each run, then merge them while dropping duplicates, O(N log N) overall. */
+        for ( r = 0; r < runs; r++ )
+            CLI_SortRun(&cmnds[runStart[r]], merged, runStart[r + 1] - runStart[r]);
+
+        count = CLI_MergeRuns(merged, cmnds, runStart, runs, runPos, heap);
+        if ( count == 0 )
+        {
+            *empty = true;
+            break;
+        }
+
+        pool             = names;
+        table->root      = CLI_NodeBuild(merged, 0, count, 0, &pool);
+        table->names     = names;
+        table->allocated = true;
+
+    } while ( 0 );
+
+    if ( table == NULL || table->root == NULL )
+    {
+        if ( table )
+            gCliTable.handlers.free(table);
+        table = NULL;
+        if ( names )
+            gCliTable.handlers.free(names);
+    }
+
+    if ( cmnds )
+        gCliTable.handlers.free(cmnds);
+    if ( merged )
+        gCliTable.handlers.free(merged);
+    if ( runStart )
+        gCliTable.handlers.free(runStart);
+    if ( runPos )
+        gCliTable.handlers.free(runPos);
+    if ( heap )
+        gCliTable.handlers.free(heap);
+    if ( paths )
+        gCliTable.handlers.free(paths);
+
+    return table;
+}
+
+/**
+ * @brief
+ *  Free the retired tables no context holds a hazard pointer to.
+ *  Writers lock held.
+ */
+
+static void CLI_TableReclaim(void)
+{
+    CLI_CmdTableTypeDef  *table;
+    CLI_CmdTableTypeDef **link = &gCliTable.retired;
+    CLI_Context          *reader;
+    bool                  inUse;
+
+    /* Pairs with the fence in CLI_TableAcquire(): a reader either sees the
+     * new table or has its hazard pointer visible here. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    while ( (table = *link) != NULL )
+    {
+        inUse = false;
+        DL_FOREACH2(gCliTable.readers, reader, readerNext)
+        {
+            if ( __atomic_load_n(&reader->hazard, __ATOMIC_ACQUIRE) == table )
+            {
+                inUse = true;
+                break;
+            }
+        }
+
+        if ( inUse )
+        {
+            link = &table->next;
+            continue;
+        }
+
+        __atomic_store_n(link, table->next, __ATOMIC_RELAXED);
+        CLI_TableFree(table);
+    }
+}
+
+/**
+ * @brief
+ *  Publish a new table, the replaced one is freed once unused.
+ *  Writers lock held.
+ */
+
+static void CLI_TablePublish(CLI_CmdTableTypeDef *table)
+{
+    CLI_CmdTableTypeDef *old = __atomic_exchange_n(&gCliTable.current, table, __ATOMIC_SEQ_CST);
+
+    if ( old != NULL )
+    {
+        old->next = gCliTable.retired;
+        __atomic_store_n(&gCliTable.retired, old, __ATOMIC_RELAXED);
+    }
+
+    CLI_TableReclaim();
+}
+
+/**
+ * @brief
+ *  Pin the published table for the context, lock free: the table is
+ *  announced as the context hazard pointer and re-checked, so that a writer
+ *  can't free it while in use. Calls nest.
+ */
+
+static const CLI_CmdTableTypeDef *CLI_TableAcquire(CLI_Context *ctx)
+{
+    const CLI_CmdTableTypeDef *table;
+
+    if ( ctx->tableRefs++ > 0 )
+        return ctx->table;
+
+    do
+    {
+        table = __atomic_load_n(&gCliTable.current, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&ctx->hazard, table, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    } while ( table != __atomic_load_n(&gCliTable.current, __ATOMIC_ACQUIRE) );
+
+    ctx->table = table;
+    return table;
+}
+
+/**
+ * @brief
+ *  Drop the table pinned by CLI_TableAcquire(). When a replaced table may be
+ *  waiting for us it is reclaimed here, unless a writer is busy anyway.
+ */
+
+static void CLI_TableRelease(CLI_Context *ctx)
+{
+    if ( ctx->tableRefs == 0 || --ctx->tableRefs > 0 )
+        return;
+
+    ctx->table = NULL;
+    __atomic_store_n(&ctx->hazard, NULL, __ATOMIC_RELEASE);
+
+    if ( __atomic_load_n(&gCliTable.retired, __ATOMIC_RELAXED) != NULL && pthread_mutex_trylock(&gCliTable.lock) == 0 )
+    {
+        CLI_TableReclaim();
+        pthread_mutex_unlock(&gCliTable.lock);
+    }
+}
+
+/**
+ * @brief
+ *  The table a command handler running on this thread should use: the one its
+ *  context holds, otherwise the published one (valid until the next change).
+ */
+
+static const CLI_CmdTableTypeDef *CLI_TableCurrent(void)
+{
+    if ( gCliCurrent != NULL && gCliCurrent->table != NULL )
+        return gCliCurrent->table;
+
+    return __atomic_load_n(&gCliTable.current, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief
+ *  Rebuild the table from the injected tables but 'skip' and publish it.
+ *  Writers lock held.
+ * @retval boolean, false if the table could not be built, the published one
+ *         is left as is.
+ */
+
+static bool CLI_TableUpdate(const CLI_TableNode_TypeDef *skip)
+{
+    CLI_CmdTableTypeDef *table;
+    bool                 empty;
+
+    table = CLI_TableBuild(skip, &empty);
+    if ( table == NULL && empty == false )
+        return false;
+
+    CLI_TablePublish(table);
+    return true;
+}
+
+/**
+ * @brief
+ *  Use ANSI codes to erase a single char.
+ */
+
+static void CLI_EraseChar(CLI_Context *ctx)
+{
+    if ( ctx->lineIdx != 0 )
+    {
+        ctx->line[ctx->lineCurrent][--ctx->lineIdx] = '\0';
+        CLI_Print(ctx, "\b \b", 3);
+    }
+}
+
+/**
+ * @brief
+ *  Use ANSI codes to erase current line.
+ */
+
+static void CLI_EraseLine(CLI_Context *ctx)
+{
+
+    /* Clear all characters from the cursor position to the end of the line
+     * using ANSI codes. */
+
+    char   lenVal[CLI_NUM_DEC_SIZE];
+    size_t len = CLI_NumFormatU64(ctx->prmpSize + ctx->lineIdx, lenVal);
+
+    CLI_Print(ctx, "\033[", 2);
+    CLI_Print(ctx, lenVal, (int) len);
+    CLI_Print(ctx, "D\033[K", 4);
+}
+
+/**
+ * @brief
+ *  Goes LineBack command back, retrieves command from history and puts
+ *  it in current slot.
+ */
+
+static bool cliRetrieveHistory(CLI_Context *ctx)
+{
+    uint8_t history_idx = 0;
+    char   *src_line    = NULL; /* Copy command line from here. */
+    char   *dst_line    = NULL; /* Copy command line there. */
+    int     len;
+
+    CLI_EraseLine(ctx);
+
+    history_idx = (ctx->lineCurrent + CLI_MAX_HISTORY_LINES - ctx->LineBack);
+    history_idx %= CLI_MAX_HISTORY_LINES;
+    src_line = ctx->line[history_idx];
+    dst_line = ctx->line[ctx->lineCurrent];
+
+    /* Copy from history to current command line. */
+    for ( ctx->lineIdx = 0; src_line[ctx->lineIdx]; ctx->lineIdx++ )
+    {
+        dst_line[ctx->lineIdx] = src_line[ctx->lineIdx];
+    }
+
+    dst_line[ctx->lineIdx] = '\0';
+
+    /* Print new command line. */
+    CLI_ContextPrintPrompt(ctx, 0);
+    len = strlen(ctx->line[ctx->lineCurrent]);
+
+    CLI_Print(ctx, ctx->line[ctx->lineCurrent], len);
+    return true;
+}
+
+/**
+ * @brief
+ *  Parse the input buffer.  This will tokenize the input line buffer
  *  (destructively) and check the number of parameters.  It finds the matching
- *  command based on the first parameter and executes its associated function if
- *  Sufficient arguments are provided.
+ *  command based on the leading parameters, walking down the subcommands as
+ *  long as they match, and executes its associated function if Sufficient
+ *  arguments are provided.
  */
 
-static int CLI_ParseEndExec(CLI_CmdTypeDef *pCommand, char line[])
+static int CLI_ParseEndExec(CLI_Context *ctx, const CLI_CmdNodeTypeDef *node, const char *line)
 {
-    /* Parameter token pointers. */
-    char   *param[CLI_MAX_NUM_PARAMS];
-    uint8_t paramCount = 0;
-    uint8_t i          = 0;
-    uint8_t handled    = 0;
-    int     cmdRet     = 0;
+    CLI_Context *prevCtx;
+
+    /* Parameter token views and pointers. */
+    CLI_TokenTypeDef       tokens[CLI_MAX_NUM_PARAMS];
+    char                  *param[CLI_MAX_NUM_PARAMS];
+    char                 **argv;
+    char                  *out        = ctx->argvBuf;
+    char                  *pathEnd;
+    uint32_t               paramCount = 0;
+    uint8_t                depth      = 0;
+    uint8_t                k;
+    size_t                 len;
+    int32_t                index;
+    int32_t                sub;
+    const CLI_CmdTypeDef  *pCommand   = NULL;
+    CLI_ArgsTypeDef        args;                            /* Typed arguments, when the command declared them */
+    const CLI_ArgsTypeDef *prevArgs;
+    char                   error[CLI_MAX_LINE_LENGTH + 32]; /* Arguments refusal, then usage text */
+    uint8_t                handled    = 0;
+    int                    cmdRet     = 0;
+    bool                   background = false;
+    uint32_t               jobId;
+    char                   jobTag[CLI_NUM_DEC_SIZE + 2];
 
     /* Should not ever happen but better safe than sorry. */
-    if ( ! pCommand )
+    if ( ! node )
         return 0;
 
     /* '#' Comments will return immediately */
-    i = 0;
     if ( '#' == line[0] )
         return -1;
 
-    /* First call to strtok. */
-    // parasoft-begin-suppress BD-PB-CHECKRETGEN "begin suppress BD-PB-CHECKRETGEN"
-    param[paramCount++] = strtok(line, CLI_DELIMIT);
-    if ( ! param[0] )
+    /* Views over the line, which is left as is for the history. */
+    switch ( CLI_Tokenize(line, strlen(line), tokens, CLI_MAX_NUM_PARAMS - 1, &paramCount) )
+    {
+        case CLI_TOKEN_TOO_MANY:
+            CLI_Print(ctx, "Too many arguments", 0);
+            if ( ctx->echo == true )
+                CLI_SEND_CRLF(ctx);
+            return -1;
+
+        case CLI_TOKEN_UNTERMINATED:
+            CLI_Print(ctx, "Unterminated quote", 0);
+            if ( ctx->echo == true )
+                CLI_SEND_CRLF(ctx);
+            return -1;
+
+        default:
+            break;
+    }
+
+    /* Handle empty command line. */
+    if ( paramCount == 0 )
         return -1;
-    // parasoft-end-suppress BD-PB-CHECKRETGEN "end suppress BD-PB-CHECKRETGEN"
 
-    while ( 1 )
+    /* A trailing '&' (not quoted) runs an asynchronous command in the background. */
+    if ( paramCount > 1 && tokens[paramCount - 1].plain && tokens[paramCount - 1].length == 1 && line[tokens[paramCount - 1].offset] == '&' )
+    {
+        paramCount--;
+        background = true;
+    }
+
+    /* Handlers take NULL terminated strings: lay the words out back to back,
+     * they never take more room than the line did. */
+    for ( k = 0; k < paramCount; k++ )
     {
-        param[paramCount] = strtok(NULL, CLI_DELIMIT);
-        if ( ! param[paramCount] )
+        param[k] = out;
+        out     += CLI_TokenCopy(line, &tokens[k], out) + 1;
+    }
+    param[paramCount] = NULL;
+
+    /* Look up the command (the first parameter) and its subcommands (the
+     * following ones, while they match), then check that argument count is
+     * OK and call the function. */
+
+    index = CLI_LookupCommand(ctx, node, param[0]);
+    while ( index >= 0 && node->cmnds[index].subCmnds != NULL && depth + 1 < paramCount )
+    {
+        sub = CLI_LookupCommand(ctx, node->cmnds[index].subCmnds, param[depth + 1]);
+        if ( sub < 0 )
             break;
 
-        paramCount++;
-        if ( paramCount > (CLI_MAX_NUM_PARAMS - 1) )
-        {
-            printf("Too many arguments");
-            if ( gCliData.echo == true )
-                CLI_SEND_CRLF();
-            {
-                return -1;
-            }
-        }
+        node  = node->cmnds[index].subCmnds;
+        index = sub;
+        depth++;
     }
 
-    /* Handle empty command line. */
-    if ( (paramCount == 1) && (param[0] == NULL) )
-        return -1;
+    /* The handler gets the command path as its argv[0], join its words. */
+    pathEnd = param[0] + strlen(param[0]);
+    for ( k = 1; k <= depth; k++ )
+    {
+        len        = strlen(param[k]);
+        *pathEnd++ = ' ';
+        memmove(pathEnd, param[k], len + 1);
+        pathEnd += len;
+    }
 
-    /* Iterate through the command structure looking for a match on the first parameter (the command).
-     * Check that argument count is OK then call the function. */
+    argv    = param + depth;
+    argv[0] = param[0];
 
-    while ( i < gCliData.cmndsCount )
+    do
     {
-        if ( gCliData.cliInitData.handlers.stricmp((const unsigned char *) param[0], (const unsigned char *) pCommand[i].Name) == 0 )
+        if ( index >= 0 )
         {
-            handled = 1;
-            if ( (paramCount - 1) >= 0 )
+            handled  = 1;
+            pCommand = &node->cmnds[index];
+
+            /* A group invoked without one of its subcommands. */
+            if ( pCommand->pHandler == NULL )
+            {
+                CLI_ListGroup(ctx, argv[0], pCommand->subCmnds);
+                cmdRet = EXIT_FAILURE;
+                break;
+            }
+
+            /* A plugin command not loaded yet: load it and dispatch the line
+             * again, through the table the load published. */
+            if ( (pCommand->flags & CLI_CMD_FLAG_LAZY) && ctx->tableRefs == 1 && CLI_PluginLoad(argv[0]) )
+            {
+                CLI_TableRelease(ctx);
+                CLI_TableAcquire(ctx);
+                return CLI_ParseEndExec(ctx, ctx->table->root, line);
+            }
+
+            /* Arguments the command declared are validated once, right here. */
+            if ( pCommand->args == NULL || CLI_ArgsParse(pCommand->args, (int) (paramCount - depth), argv, &args, error, sizeof(error)) )
             {
-                if ( gCliData.echo == false )
-                    CLI_SEND_CRLF();
+                if ( ctx->echo == false )
+                    CLI_SEND_CRLF(ctx);
+
+                /* Asynchronous commands go to the worker pool when somebody can
+                 * be alerted once they are done, otherwise they run right here. */
+                if ( (pCommand->flags & CLI_CMD_FLAG_ASYNC) && CLI_IsInline(ctx) == false )
+                {
+                    jobId = CLI_JobSubmit(ctx, pCommand->pHandler, pCommand->args, paramCount - depth, argv, background);
+                    if ( jobId != 0 )
+                    {
+                        if ( background == false )
+                        {
+                            CLI_ContextWait(ctx, jobId);
+                            return CLI_RESET_CMD;
+                        }
+
+                        jobTag[0]       = '[';
+                        len             = CLI_NumFormatU64(jobId, jobTag + 1);
+                        jobTag[len + 1] = ']';
+                        CLI_Print(ctx, jobTag, (int) len + 2);
+                        if ( ctx->echo == true )
+                            CLI_SEND_CRLF(ctx);
+                        break;
+                    }
+                }
+                else if ( background )
+                {
+                    CLI_Print(ctx, "Can't run in the background", 0);
+                    cmdRet = EXIT_FAILURE;
+                    if ( ctx->echo == true )
+                        CLI_SEND_CRLF(ctx);
+                    break;
+                }
 
-                /* Call the function pointer in the command record. */
-                cmdRet = pCommand[i].pHandler(paramCount, param);
-                if ( gCliData.echo == true )
-                    CLI_SEND_CRLF();
+                /* No flush here: the handler output joins the echoed line in
+                 * the ring and the whole command goes out in one write. Long
+                 * running handlers push progress out with CLI_Flush(). */
+                /* Call the function pointer in the command record, the handler
+                 * can find its context through CLI_GetCurrentContext() and its
+                 * typed arguments through CLI_GetArgs(). */
+                prevCtx     = gCliCurrent;
+                prevArgs    = CLI_ArgsSwap((pCommand->args != NULL) ? &args : NULL);
+                gCliCurrent = ctx;
+                cmdRet      = pCommand->pHandler(paramCount - depth, argv);
+                gCliCurrent = prevCtx;
+                CLI_ArgsSwap(prevArgs);
+
+                /* A handler leaving the context waiting ('fg') ends the line once done. */
+                if ( ctx->echo == true && ctx->waiting == false )
+                    CLI_SEND_CRLF(ctx);
                 break;
             }
             else
             {
-                printf("Not enough arguments");
-                if ( gCliData.echo == true )
-                    CLI_SEND_CRLF();
+                CLI_Print(ctx, argv[0], 0);
+                CLI_Print(ctx, ": ", 2);
+                CLI_Print(ctx, error, 0);
+                CLI_SEND_CRLF(ctx);
+                CLI_ArgsUsage(pCommand->args, error, sizeof(error));
+                CLI_Print(ctx, "Usage: ", 0);
+                CLI_Print(ctx, argv[0], 0);
+                CLI_Print(ctx, " ", 1);
+                CLI_Print(ctx, error, 0);
+                cmdRet = EXIT_FAILURE;
+                if ( ctx->echo == true )
+                    CLI_SEND_CRLF(ctx);
                 break;
             }
         }
 
-        i++;
-    }
+    } while ( 0 );
 
     if ( ! handled )
     {
-        printf("'%s' is not recognized as an internal command.\r\n", line);
+        CLI_Print(ctx, "'", 1);
+        CLI_Print(ctx, param[0], 0);
+        CLI_Print(ctx, "' is not recognized as an internal command.\r\n", 0);
         cmdRet = EXIT_FAILURE;
-        if ( gCliData.echo == true )
-            CLI_SEND_CRLF();
+        if ( ctx->echo == true )
+            CLI_SEND_CRLF(ctx);
     }
 
     return cmdRet;
@@ -610,58 +1851,54 @@ static int CLI_ParseEndExec(CLI_CmdTypeDef *pCommand, char line[])
  *  Execute a command (once it was found).
  */
 
-static void CLI_ExecuteCommand(void)
+static void CLI_ExecuteCommand(CLI_Context *ctx)
 {
 
     int cmdRet = 0;
 
     /* No commands in memory or pending for execution. */
-    if ( gCliData.cmnds != NULL )
+    if ( ctx->table != NULL )
     {
 
-        if ( gCliData.echo == true )
-            CLI_SEND_CRLF();
+        if ( ctx->echo == true )
+            CLI_SEND_CRLF(ctx);
 
         /* Process command if it is not empty. */
-        if ( '\0' != *gCliData.line[gCliData.lineCurrent] )
+        if ( '\0' != *ctx->line[ctx->lineCurrent] )
         {
             uint8_t prev_line_idx = 0;
 
-            /* Parse and execute. */
-            memset(gCliData.argvBuf, 0, sizeof(gCliData.argvBuf));
-            strncpy(gCliData.argvBuf, gCliData.line[gCliData.lineCurrent], sizeof(gCliData.argvBuf) - 1);
-
             /* Optional non-ascii indication that a command is starting execution. */
 
-            /* Execute! */
-            cmdRet = CLI_ParseEndExec(gCliData.cmnds, gCliData.argvBuf);
+            /* Parse and execute! */
+            cmdRet = CLI_ParseEndExec(ctx, ctx->table->root, ctx->line[ctx->lineCurrent]);
 
             /* Check is save the command in history. */
-            prev_line_idx = (gCliData.lineCurrent + CLI_MAX_HISTORY_LINES - 1);
+            prev_line_idx = (ctx->lineCurrent + CLI_MAX_HISTORY_LINES - 1);
             prev_line_idx %= CLI_MAX_HISTORY_LINES;
 
-            if ( strcmp(gCliData.line[gCliData.lineCurrent], gCliData.line[prev_line_idx]) )
+            if ( strcmp(ctx->line[ctx->lineCurrent], ctx->line[prev_line_idx]) )
             {
                 /* Last command differs from previous one, move to next
                  * slot. so the last command remain in history. */
 
-                gCliData.lineCurrent = (gCliData.lineCurrent + CLI_MAX_HISTORY_LINES + 1);
-                gCliData.lineCurrent %= CLI_MAX_HISTORY_LINES;
+                ctx->lineCurrent = (ctx->lineCurrent + CLI_MAX_HISTORY_LINES + 1);
+                ctx->lineCurrent %= CLI_MAX_HISTORY_LINES;
 
-                if ( gCliData.LineCount < CLI_MAX_HISTORY_LINES - 1 )
-                    gCliData.LineCount++;
+                if ( ctx->LineCount < CLI_MAX_HISTORY_LINES - 1 )
+                    ctx->LineCount++;
             }
 
-            gCliData.lineIdx                       = 0;
-            gCliData.line[gCliData.lineCurrent][0] = '\0';
+            ctx->lineIdx                       = 0;
+            ctx->line[ctx->lineCurrent][0] = '\0';
         }
 
         if ( cmdRet != CLI_RESET_CMD ) /* Reserved for reset command. */
         {
-            if ( gCliData.echo == true )
-                CLI_PrintPrompt(0);
+            if ( ctx->echo == true )
+                CLI_ContextPrintPrompt(ctx, 0);
             else
-                CLI_PrintPrompt(1);
+                CLI_ContextPrintPrompt(ctx, 1);
         }
     }
 }
@@ -673,42 +1910,149 @@ static void CLI_ExecuteCommand(void)
  * @retval boolean: true if a command was executed.
  */
 
-static bool CLI_SearchAndExecute(void)
+static bool CLI_SearchAndExecute(CLI_Context *ctx)
 {
-    if ( gCliData.initialized == false )
+    if ( ctx->initialized == false )
         return false;
 
-    bool commandTriggered = true;
+    bool                       commandTriggered = true;
+    const CLI_CmdTableTypeDef *table            = ctx->table;
+    uint32_t                   first, matches, common;
 
     /* Fast verification that we have something to execute. */
-    if ( *gCliData.line[gCliData.lineCurrent] )
+    if ( *ctx->line[ctx->lineCurrent] )
     {
 
-        /* Make sure that there something worthwhile to alert the supper loop. */
-        if ( CLI_SearchChar(gCliData.cmnds, 0, gCliData.cmndsCount, gCliData.line[gCliData.lineCurrent], true, gCliData.commandsSorted) == -1 )
+        /* Make sure that there something worthwhile to alert the supper loop:
+         * some command starts with the line first character. */
+        if ( table == NULL ||
+             ! CLI_TrieFind(table->root->trie, table->root->names, table->root->nameOffs, table->root->count, ctx->line[ctx->lineCurrent], 1,
+                            &first, &matches, &common) )
             commandTriggered = false;
     }
 
     /* Execute.. */
     if ( commandTriggered == true )
-        CLI_ExecuteCommand();
+        CLI_ExecuteCommand(ctx);
     else
     {
         /* Nothing to execute, simply dump the prompt and we're done. */
-        if ( *gCliData.line[gCliData.lineCurrent] )
+        if ( *ctx->line[ctx->lineCurrent] )
         {
-            printf("\r\n'%s' is not recognized as an internal command.\r\n", gCliData.line[gCliData.lineCurrent]);
-            gCliData.lineIdx                       = 0;
-            gCliData.line[gCliData.lineCurrent][0] = '\0';
+            CLI_Print(ctx, "\r\n'", 0);
+            CLI_Print(ctx, ctx->line[ctx->lineCurrent], 0);
+            CLI_Print(ctx, "' is not recognized as an internal command.\r\n", 0);
+            ctx->lineIdx                       = 0;
+            ctx->line[ctx->lineCurrent][0] = '\0';
         }
 
         /* Print the prompt. */
-        CLI_PrintPrompt(1);
+        CLI_ContextPrintPrompt(ctx, 1);
     }
 
     return commandTriggered;
 }
 
+/**
+ * @brief
+ *  Check on the job(s) the context is waiting for, once the wait is over the
+ *  prompt is back.
+ * @retval boolean: true if the wait is over.
+ */
+
+static bool CLI_WaitJobs(CLI_Context *ctx)
+{
+    bool interrupted = __atomic_exchange_n(&ctx->interrupted, false, __ATOMIC_ACQUIRE);
+
+    if ( CLI_JobsWait(ctx, ctx->waitJob, interrupted) == false )
+        return false;
+
+    ctx->waiting = false;
+
+    if ( ctx->echo == true )
+    {
+        CLI_SEND_CRLF(ctx);
+        CLI_ContextPrintPrompt(ctx, 0);
+    }
+    else
+        CLI_ContextPrintPrompt(ctx, 1);
+
+    return true;
+}
+
+/**
+ * @brief
+ *  Queue input bytes in the typeahead ring. Lock free and async-signal-safe
+ *  (no locks, no allocations), the caller must be the single producer of the
+ *  context.
+ * @retval Count of bytes queued, the rest did not fit.
+ */
+
+static size_t CLI_TypeaheadPush(CLI_Context *ctx, const unsigned char *buf, size_t len)
+{
+    CLI_InRingTypeDef *ring = &ctx->typeahead;
+    uint32_t           head;
+    uint32_t           tail;
+    uint32_t           count;
+    uint32_t           i;
+
+    head  = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    tail  = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    count = (ring->buf != NULL) ? (uint32_t) CLI_MIN(len, (ring->mask + 1) - (head - tail)) : 0;
+
+    for ( i = 0; i < count; i++ )
+        ring->buf[(head + i) & ring->mask] = buf[i];
+
+    /* Publish the bytes before the new head. */
+    __atomic_store_n(&ring->head, head + count, __ATOMIC_RELEASE);
+
+    if ( head + count - tail > ring->highWater )
+        __atomic_store_n(&ring->highWater, head + count - tail, __ATOMIC_RELAXED);
+
+    if ( count < len )
+        __atomic_store_n(&ring->overflows, ring->overflows + (uint32_t) (len - count), __ATOMIC_RELAXED);
+
+    return count;
+}
+
+/**
+ * @brief
+ *  Checks whether bytes are waiting in the typeahead ring.
+ */
+
+static bool CLI_TypeaheadPending(CLI_Context *ctx)
+{
+    return __atomic_load_n(&ctx->typeahead.head, __ATOMIC_ACQUIRE) != __atomic_load_n(&ctx->typeahead.tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief
+ *  Queue input received while a state is pending. Ctrl-C is not queued when
+ *  waiting for a job, it ends the wait instead.
+ * @retval Count of bytes consumed.
+ */
+
+static size_t CLI_QueueInput(CLI_Context *ctx, const unsigned char *buf, size_t len)
+{
+    const unsigned char *brk = NULL;
+    size_t               count;
+
+    if ( ctx->execType == CLI_Exec_WaitJob )
+        brk = memchr(buf, CLI_CTRL_C, len);
+
+    if ( brk == NULL )
+        return CLI_TypeaheadPush(ctx, buf, len);
+
+    count = CLI_TypeaheadPush(ctx, buf, (size_t) (brk - buf));
+    if ( count < (size_t) (brk - buf) )
+        return count;
+
+    __atomic_store_n(&ctx->interrupted, true, __ATOMIC_RELEASE);
+    CLI_Alert(ctx);
+
+    return count + 1 + CLI_TypeaheadPush(ctx, brk + 1, len - count - 1);
+}
+
 /**
   * @}
   */
@@ -720,54 +2064,337 @@ static bool CLI_SearchAndExecute(void)
 
 /**
  * @brief
- *   Get's a pointer to the internal stored commands table.
+ *   Get's a pointer to the internal stored commands table, its top level
+ *   commands, groups refer to their subcommands levels.
  *   Caller must validate the returned pointer prior to using it.
+ *   From a command handler this is the table the command was dispatched
+ *   from, kept alive until the handler returns. Anywhere else it is the
+ *   published table, valid until commands are next injected or removed.
  * @retval Pointer to the stored commands or NULL on error.
  */
 
-CLI_CmdTypeDef *CLI_GetCommandsPtr(void)
+const CLI_CmdTypeDef *CLI_GetCommandsPtr(void)
 {
-    if ( gCliData.initialized == true )
-        return gCliData.cmnds;
+    const CLI_CmdTableTypeDef *table = CLI_TableCurrent();
+
+    if ( gCliTable.initialized == true && table != NULL )
+        return table->root->cmnds;
 
     return NULL;
 }
 
 /**
  * @brief
- *    Gets the sorted commands count.
+ *    Gets the sorted commands count, of the table CLI_GetCommandsPtr() returns.
  * @retval Count of commands.
  */
 
 int CLI_GetCommandCnt(void)
 {
+    const CLI_CmdTableTypeDef *table = CLI_TableCurrent();
+
+    if ( gCliTable.initialized == false || table == NULL )
+        return 0;
+
+    return (int) table->root->count;
+}
+
+/**
+ * @brief
+ *    Gets the default context, the one set up by CLI_Init() and driven by the
+ *    CLI task.
+ * @retval Pointer to the default context.
+ */
+
+CLI_Context *CLI_GetDefaultContext(void)
+{
+    return &gCliData;
+}
+
+/**
+ * @brief
+ *    Gets the context whose command handler is running on the calling thread.
+ * @retval Pointer to the running context, the default context when called
+ *         from outside of a command handler.
+ */
+
+CLI_Context *CLI_GetCurrentContext(void)
+{
+    return (gCliCurrent != NULL) ? gCliCurrent : &gCliData;
+}
+
+/**
+ * @brief
+ *    Formatted output for command handlers, formatted straight to the output
+ *    ring of the context the handler runs on so it reaches the right console.
+ *    No stdio nor allocation involved, see cli_fmt.h for the conversions.
+ * @param format: printf() like format string.
+ * @retval Count of characters queued.
+ */
+
+int CLI_Printf(const char *format, ...)
+{
+    va_list args;
+    int     len;
+
+    va_start(args, format);
+    len = CLI_VPrintf(format, args);
+    va_end(args);
+
+    return len;
+}
+
+/**
+ * @brief
+ *    CLI_Printf() taking a va_list, for handlers wrapping it.
+ * @param format: printf() like format string.
+ * @param args: Arguments of the format.
+ * @retval Count of characters queued.
+ */
+
+int CLI_VPrintf(const char *format, va_list args)
+{
+    /* Handlers running as jobs have their output captured. */
+    if ( CLI_JobsWrite(NULL, 0) )
+        return (int) CLI_FmtVPrint(CLI_JobSink, NULL, format, args);
+
+    return (int) CLI_FmtVPrint(CLI_OutSink, CLI_GetCurrentContext(), format, args);
+}
+
+/**
+ * @brief
+ *    Raw output for command handlers, see CLI_Printf().
+ * @param buf: Bytes to output.
+ * @param len: Count of bytes in 'buf'.
+ */
+
+void CLI_Write(const char *buf, size_t len)
+{
+    if ( buf != NULL && CLI_JobsWrite(buf, len) == false )
+        CLI_OutAppend(CLI_GetCurrentContext(), buf, len);
+}
+
+/**
+ * @brief
+ *    Push out whatever is pending for the current context, handlers running
+ *    for a long time may use it to show progress.
+ */
+
+void CLI_Flush(void)
+{
+    /* Job output is reported once the job is done. */
+    if ( CLI_JobsWrite(NULL, 0) == false )
+        CLI_OutFlush(CLI_GetCurrentContext());
+}
+
+/**
+ * @brief
+ *    Resume the output of a context whose backend stalled (a socket that was
+ *    full), once the backend has room again.
+ * @param ctx: Context handle.
+ */
+
+void CLI_ContextFlush(CLI_Context *ctx)
+{
+    if ( ctx != NULL && ctx->initialized )
+        CLI_OutFlush(ctx);
+}
+
+/**
+ * @brief
+ *    Checks whether a context holds output its backend did not take yet, the
+ *    owner then waits for room and calls CLI_ContextFlush().
+ * @param ctx: Context handle.
+ * @retval boolean, true when output is pending.
+ */
+
+bool CLI_ContextOutPending(CLI_Context *ctx)
+{
+    return ctx != NULL && ctx->out.count > 0;
+}
+
+/**
+ * @brief
+ *    Gets the output counters of a context.
+ * @param ctx: Context handle.
+ * @param stats: Filled with a snapshot of the counters.
+ */
+
+void CLI_ContextGetOutStats(CLI_Context *ctx, CLI_OutStatsTypeDef *stats)
+{
+    if ( ctx != NULL && stats != NULL )
+        *stats = ctx->outStats;
+}
+
+/**
+ * @brief
+ *    Gets the output counters of the default context.
+ * @param stats: Filled with a snapshot of the counters.
+ */
+
+void CLI_GetOutStats(CLI_OutStatsTypeDef *stats)
+{
+    CLI_ContextGetOutStats(&gCliData, stats);
+}
+
+/**
+ * @brief
+ *    Queue input bytes for a context without running the state machine, they
+ *    are fed once the context is served next. Lock free and async-signal-safe
+ *    so it may be called from a signal handler (ISR), provided it is the only
+ *    producer of the context and the context alert handler, if any, is
+ *    async-signal-safe as well.
+ * @param ctx: Context handle.
+ * @param buf: Rx bytes.
+ * @param len: Count of bytes in 'buf'.
+ * @retval Count of bytes queued, the rest did not fit and was dropped.
+ */
+
+size_t CLI_ContextTypeahead(CLI_Context *ctx, const unsigned char *buf, size_t len)
+{
+    size_t count;
 
-    if ( gCliData.initialized == false )
+    if ( ctx == NULL || ctx->initialized == false || buf == NULL )
         return 0;
 
-    return gCliData.cmndsCount;
+    count = CLI_TypeaheadPush(ctx, buf, len);
+
+    /* Have the context served so the queue gets drained. */
+    if ( count > 0 && CLI_IsInline(ctx) == false )
+        CLI_Alert(ctx);
+
+    return count;
+}
+
+/**
+ * @brief
+ *    Queue input bytes for the default context, see CLI_ContextTypeahead().
+ * @param buf: Rx bytes.
+ * @param len: Count of bytes in 'buf'.
+ * @retval Count of bytes queued.
+ */
+
+size_t CLI_Typeahead(const unsigned char *buf, size_t len)
+{
+    return CLI_ContextTypeahead(&gCliData, buf, len);
+}
+
+/**
+ * @brief
+ *    Gets the typeahead queue counters of a context.
+ * @param ctx: Context handle.
+ * @param stats: Filled with a snapshot of the counters.
+ */
+
+void CLI_ContextGetTypeaheadStats(CLI_Context *ctx, CLI_TypeaheadStatsTypeDef *stats)
+{
+    CLI_InRingTypeDef *ring;
+
+    if ( ctx == NULL || stats == NULL )
+        return;
+
+    ring = &ctx->typeahead;
+
+    stats->size      = (ring->buf != NULL) ? ring->mask + 1 : 0;
+    stats->pending   = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    stats->highWater = __atomic_load_n(&ring->highWater, __ATOMIC_RELAXED);
+    stats->overflows = __atomic_load_n(&ring->overflows, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief
+ *    Gets the typeahead queue counters of the default context.
+ * @param stats: Filled with a snapshot of the counters.
+ */
+
+void CLI_GetTypeaheadStats(CLI_TypeaheadStatsTypeDef *stats)
+{
+    CLI_ContextGetTypeaheadStats(&gCliData, stats);
+}
+
+/**
+ * @brief
+ *    Have a context served, used by jobs that are done.
+ * @param ctx: Context handle.
+ */
+
+void CLI_ContextAlert(CLI_Context *ctx)
+{
+    if ( ctx != NULL )
+        CLI_Alert(ctx);
+}
+
+/**
+ * @brief
+ *    Raw output to a context, from the thread driving it.
+ * @param ctx: Context handle.
+ * @param buf: Bytes to output.
+ * @param len: Count of bytes in 'buf'.
+ */
+
+void CLI_ContextWrite(CLI_Context *ctx, const char *buf, size_t len)
+{
+    if ( ctx != NULL && buf != NULL )
+        CLI_OutAppend(ctx, buf, len);
+}
+
+/**
+ * @brief
+ *    Leave a context waiting for a job once the running command returns,
+ *    input is queued meanwhile and Ctrl-C ends the wait.
+ * @param ctx: Context handle.
+ * @param jobId: Job to wait for, 0 for all the jobs of the context.
+ */
+
+void CLI_ContextWait(CLI_Context *ctx, uint32_t jobId)
+{
+    if ( ctx == NULL )
+        return;
+
+    ctx->waitJob     = jobId;
+    ctx->waiting     = true;
+    ctx->interrupted = false;
 }
 
 /**
  * @brief
- *   Print the command prompt.
+ *   Print the command prompt of a context.
+ * @param ctx: Context handle.
  * @param addCrLfCnt: Count of "\r\n" to add before.
  */
 
-void CLI_PrintPrompt(int addCrLfCnt)
+void CLI_ContextPrintPrompt(CLI_Context *ctx, int addCrLfCnt)
 {
-    if ( gCliData.locked == false )
+    if ( ctx->locked == false && ctx->ended == false )
     {
-        while ( addCrLfCnt-- > 0 ) CLI_SEND_CRLF(); /* Dump '\r\n' */
-        CLI_Print(gCliData.prompt, gCliData.prmpSize);
+        while ( addCrLfCnt-- > 0 ) CLI_SEND_CRLF(ctx); /* Dump '\r\n' */
+        CLI_Print(ctx, ctx->prompt, ctx->prmpSize);
     }
 }
 
 /**
-  * @brief Injects a table instance to be later merged with all other instances.
+ * @brief
+ *   Print the command prompt of the default context.
+ * @param addCrLfCnt: Count of "\r\n" to add before.
+ */
+
+void CLI_PrintPrompt(int addCrLfCnt)
+{
+    CLI_ContextPrintPrompt(&gCliData, addCrLfCnt);
+    CLI_OutFlush(&gCliData);
+}
+
+/**
+  * @brief Injects a table instance to be merged with all other instances.
+  *        Once the table was built the commands are added on the fly: a new
+  *        table is built and published, sessions pick it up with their next
+  *        command.
   * @param table: Instance to commands table, must be static so its pointer will remain
   *               valid when its host function is exited.
   * @param items: Count of elements within the table.
+  * @note  With CLI_STATIC_TABLE the tables injected before CLI_BuildTable()
+  *        are the ones the '.def' files list, they are already in the build
+  *        time table and are refused.
   *
   * @retval number of injected commands.
   */
@@ -777,10 +2404,15 @@ int CLI_InjectCommands(const CLI_CmdTypeDef *table, int items)
     CLI_TableNode_TypeDef *instance = NULL;
 
     /* Sanity */
-    if ( table == NULL || items == 0 || gCliData.commandsSorted == true )
+    if ( table == NULL || items == 0 || gCliTable.initialized == false )
+        return 0;
+
+#ifdef CLI_STATIC_TABLE
+    if ( gCliTable.commandsSorted == false )
         return 0;
+#endif
 
-    instance = gCliData.cliInitData.handlers.malloc(sizeof(CLI_TableNode_TypeDef)); /* Allocate node pointer */
+    instance = gCliTable.handlers.malloc(sizeof(CLI_TableNode_TypeDef)); /* Allocate node pointer */
     if ( instance == NULL )
         return 0; /* No memory */
 
@@ -788,98 +2420,139 @@ int CLI_InjectCommands(const CLI_CmdTypeDef *table, int items)
     instance->table = table;
     instance->next  = NULL;
 
+    pthread_mutex_lock(&gCliTable.lock);
+
     /* Attach to the table head */
-    LL_APPEND(gCliData.cmndsTableHead, instance);
+    LL_APPEND(gCliTable.cmndsTableHead, instance);
+
+    if ( gCliTable.commandsSorted == true && CLI_TableUpdate(NULL) == false )
+    {
+        LL_DELETE(gCliTable.cmndsTableHead, instance);
+        gCliTable.handlers.free(instance);
+        items = 0;
+    }
 
-    return instance->items;
+    pthread_mutex_unlock(&gCliTable.lock);
+
+    return items;
 }
 
 /**
-  * @brief Aggregate all commands tables, merge them to one while dropping
-  *        duplicated commands. When done, sort the table to allow for fast
-  *        binary searches.
-  * @note  Must be called before attempting to execute any CLI command.
-  * @retval boolean, true if went as expected.
+  * @brief Removes a table instance previously injected. Once the table was
+  *        built a new one, without these commands, is published. Sessions
+  *        running one of the removed commands are not affected, the old
+  *        table is released once they are done with it.
+  * @param table: Instance to commands table, as passed to CLI_InjectCommands().
+  * @retval number of removed commands.
   */
 
-bool CLI_BuildTable(void)
+int CLI_RemoveCommands(const CLI_CmdTypeDef *table)
 {
+    CLI_TableNode_TypeDef *instance = NULL;
+    int                    items    = 0;
 
-    uint32_t               total_items = 0;
-    uint32_t               total_mem   = 0;
-    uint16_t               i           = 0;
-    uint16_t               position    = 0;
-    bool                   retVal      = false;
-    CLI_TableNode_TypeDef *instance    = NULL;
-    bool                   duplicate   = false;
+    if ( table == NULL || gCliTable.initialized == false )
+        return 0;
 
-    do
-    {
-        /* Make sure we ware not already aggregated and sorted */
-        if ( gCliData.commandsSorted || gCliData.cmndsTableHead == NULL )
-            break; /* Must call ProtoTable_SetMemory() first */
+    pthread_mutex_lock(&gCliTable.lock);
 
-        /* Count all entries thought all instances so we could calculate
-       * the total required memory for all of them.
-       */
+    LL_SEARCH_SCALAR(gCliTable.cmndsTableHead, instance, table, table);
+    if ( instance != NULL && (gCliTable.commandsSorted == false || CLI_TableUpdate(instance) == true) )
+    {
+        items = instance->items;
+        LL_DELETE(gCliTable.cmndsTableHead, instance);
+#ifdef CLI_STATIC_TABLE
+        if ( instance == &gCliStaticNode )
+            instance = NULL; /* Not allocated */
+#endif
+        if ( instance != NULL )
+            gCliTable.handlers.free(instance);
+    }
 
-        LL_FOREACH(gCliData.cmndsTableHead, instance)
-        total_items += instance->items;
+    pthread_mutex_unlock(&gCliTable.lock);
 
-        if ( total_items == 0 )
-            break;
+    return items;
+}
 
-        total_mem = ((total_items + 1) * sizeof(CLI_CmdTypeDef));
+/**
+  * @brief Replaces a table instance previously injected with another one, in
+  *        place: the new table keeps the precedence of the replaced one and
+  *        both changes are published at once, sessions never see the
+  *        commands missing.
+  * @param table: Instance to commands table, as passed to CLI_InjectCommands().
+  * @param with: Replacing instance, must be static as well.
+  * @param items: Count of elements within 'with'.
+  * @retval number of injected commands.
+  */
 
-        /* Attempt to allocate */
-        gCliData.cmnds = gCliData.cliInitData.handlers.malloc(total_mem);
-        if ( gCliData.cmnds == NULL )
-            break;
+int CLI_ReplaceCommands(const CLI_CmdTypeDef *table, const CLI_CmdTypeDef *with, int items)
+{
+    CLI_TableNode_TypeDef *instance = NULL;
+    const CLI_CmdTypeDef  *oldTable;
+    int                    oldItems;
 
-        /* Start fresh */
-        memset(gCliData.cmnds, 0, total_mem);
+    if ( table == NULL || with == NULL || items == 0 || gCliTable.initialized == false )
+        return 0;
 
-        /* Aggregate - merge into a single table */
-        LL_FOREACH(gCliData.cmndsTableHead, instance)
-        {
-            for ( position = 0; position < instance->items; position++ )
-            {
+    pthread_mutex_lock(&gCliTable.lock);
 
-                duplicate = false;
+    LL_SEARCH_SCALAR(gCliTable.cmndsTableHead, instance, table, table);
+    if ( instance != NULL )
+    {
+        oldTable        = instance->table;
+        oldItems        = instance->items;
+        instance->table = with;
+        instance->items = items;
 
-                /* Search for existing duplicated item */
-                for ( i = 0; i < gCliData.cmndsCount; i++ )
-                {
-                    if ( gCliData.cliInitData.handlers.stricmp((unsigned char *) gCliData.cmnds[i].Name, (unsigned char *) instance->table[position].Name) ==
-                         0 )
-                    {
-                        duplicate = true;
-                        break;
-                    }
-                }
+        if ( gCliTable.commandsSorted == true && CLI_TableUpdate(NULL) == false )
+        {
+            instance->table = oldTable;
+            instance->items = oldItems;
+            instance        = NULL;
+        }
+    }
 
-                /* Add to the main table if the OP code was unique */
-                if ( duplicate == false )
-                {
-                    memcpy(&gCliData.cmnds[gCliData.cmndsCount], &instance->table[position], sizeof(CLI_CmdTypeDef));
+    pthread_mutex_unlock(&gCliTable.lock);
 
-                    /* Force commands to lower case, trim and NULL terminate */
-                    gCliData.cmnds[gCliData.cmndsCount].Name[CLI_MAX_COMMAND_NAME_LEN - 1] = 0; /* Force NULL termination */
-                    gCliData.cliInitData.handlers.strtrim(gCliData.cmnds[gCliData.cmndsCount].Name);
-                    gCliData.cliInitData.handlers.strlwr(gCliData.cmnds[gCliData.cmndsCount].Name);
+    return (instance != NULL) ? items : 0;
+}
 
-                    gCliData.cmndsCount++;
-                }
-            }
-        }
+/**
+  * @brief Aggregate all commands tables: sort each one, then k-way merge them
+  *        to one sorted table while dropping duplicated commands (the first
+  *        injected wins), then build the perfect hash used for dispatching
+  *        and the completion trie. The table is published with an atomic
+  *        pointer swap, commands readers never lock.
+  * @note  Must be called before attempting to execute any CLI command.
+  *        With CLI_STATIC_TABLE the table is already built, this only checks
+  *        that it was loaded.
+  * @retval boolean, true if went as expected.
+  */
 
-        /* Sort */
-        qsort(gCliData.cmnds, gCliData.cmndsCount, sizeof(CLI_CmdTypeDef), CLI_Compare);
-        gCliData.commandsSorted = true; /* Mark as sorted and effectively disable injections from now no */
+bool CLI_BuildTable(void)
+{
+    bool retVal = false;
 
-        retVal = true;
+    pthread_mutex_lock(&gCliTable.lock);
 
-    } while ( 0 );
+    /* Make sure we ware not already aggregated and sorted */
+    if ( gCliTable.commandsSorted == false )
+    {
+#ifdef CLI_STATIC_TABLE
+        /* Merged, sorted and hashed at build time, published by CLI_ContextSetup(). */
+        retVal = (gCliTable.current != NULL);
+#else
+        retVal = (gCliTable.cmndsTableHead != NULL && CLI_TableUpdate(NULL) == true && gCliTable.current != NULL);
+#endif
+        /* Mark as sorted, injections are applied on the fly from now on */
+        __atomic_store_n(&gCliTable.commandsSorted, retVal, __ATOMIC_SEQ_CST);
+    }
+
+    pthread_mutex_unlock(&gCliTable.lock);
+
+    /* Input is held back until now, let the task resume it. */
+    if ( retVal == true )
+        CLI_TaskAlert();
 
     return retVal;
 }
@@ -888,54 +2561,29 @@ bool CLI_BuildTable(void)
  * @brief
  *  Restore CLI engine state machine to its default state.
  *	Handy when the parser goes bananas after UART errors act.
+ * @param ctx: Context handle.
  */
 
-void CLI_ResetState(void)
+void CLI_ContextResetState(CLI_Context *ctx)
 {
-    if ( gCliData.initialized == false )
+    if ( ctx == NULL || ctx->initialized == false )
         return;
 
-    memset(gCliData.line, 0, sizeof(gCliData.line));
-    gCliData.lineIdx     = 0;
-    gCliData.lineCurrent = 0;
-    gCliData.LineCount   = 0;
-    gCliData.LineBack    = 0;
+    memset(ctx->line, 0, sizeof(ctx->line));
+    ctx->lineIdx     = 0;
+    ctx->lineCurrent = 0;
+    ctx->LineCount   = 0;
+    ctx->LineBack    = 0;
 }
 
 /**
  * @brief
- *  Performs state logic after an event was set from the CLI bytes processor.
- *  We're doing this to execute most of the CLI logic from a task context rather
- *  than from an interrupt.
-  * @retval boolean: true if wen't OK.
-  */
+ *  Restore the default context state machine to its default state.
+ */
 
-bool CLI_ProcessState(void)
+void CLI_ResetState(void)
 {
-
-    bool retVal = false;
-
-    if ( gCliData.initialized == false )
-        return false;
-
-    switch ( gCliData.execType )
-    {
-        case CLI_Exec_SearchAndExec:
-            retVal = CLI_SearchAndExecute();
-            break;
-
-        case CLI_Exec_AutoComplete:
-            retVal = CLI_TabCompleter(gCliData.line[gCliData.lineCurrent], gCliData.lineIdx);
-            break;
-        case CLI_Exec_RetrieveHistory:
-            retVal = cliRetrieveHistory();
-            break;
-        default:
-            break;
-    }
-
-    gCliData.execType = CLI_Exec_Nothing;
-    return retVal;
+    CLI_ContextResetState(&gCliData);
 }
 
 /**
@@ -949,28 +2597,28 @@ bool CLI_ProcessState(void)
  *  - Trigger a polling loop whenever there is a command to execute .
  *
  *  Return true if a full buffer was received and a command execution was triggered.
- *  Else false.
+ *  Else false. Output is left in the ring for the caller to flush.
   * @param c: Rx byte.
   * @retval boolean: true if a command is ready to be executed.
   */
 
-bool CLI_ProcessChar(unsigned char c)
+static bool CLI_HandleChar(CLI_Context *ctx, unsigned char c)
 {
 
     bool commandTriggered = false;
 
     do
     {
-        if ( gCliData.initialized == false || c == 0 || c >= 128 || gCliData.execType != CLI_Exec_Nothing )
+        if ( ctx->initialized == false || c == 0 || c >= 128 || ctx->execType != CLI_Exec_Nothing )
             break;
 
         /* Exit  no registered commands */
-        if ( gCliData.cmnds == NULL )
+        if ( __atomic_load_n(&gCliTable.current, __ATOMIC_ACQUIRE) == NULL )
             break;
 
-        if ( gCliData.receivingEscapeSequence )
+        if ( ctx->receivingEscapeSequence )
         {
-            c = CLI_ProcessEscapeSequnceChar(c);
+            c = CLI_ProcessEscapeSequnceChar(ctx, c);
             if ( ! c )
                 break;
         }
@@ -980,60 +2628,60 @@ bool CLI_ProcessChar(unsigned char c)
         {
             case '\033':
                 // Start of escape sequence
-                gCliData.CurrentEscapeSequenceCount = 0;
-                gCliData.receivingEscapeSequence    = true;
+                ctx->CurrentEscapeSequenceCount = 0;
+                ctx->receivingEscapeSequence    = true;
                 break;
 
             case '\r':
-                if ( gCliData.locked ) /* If we're locked, pass the buffer to the external handler */
+                if ( ctx->locked ) /* If we're locked, pass the buffer to the external handler */
                 {
-                    gCliData.lineIdx                       = 0;
-                    gCliData.line[gCliData.lineCurrent][0] = '\0';
+                    ctx->lineIdx                       = 0;
+                    ctx->line[ctx->lineCurrent][0] = '\0';
                 }
                 else
                 {
                     /* Finally alert the super loop / task if valid command was found. */
-                    gCliData.execType = CLI_Exec_SearchAndExec;
-                    CLI_TaskAlert(); /* Signal an external handler to process the command. */
+                    ctx->execType = CLI_Exec_SearchAndExec;
+                    CLI_Alert(ctx); /* Signal an external handler to process the command. */
                 }
 
-                gCliData.LineBack = 0;
+                ctx->LineBack = 0;
                 break;
 
             case '\t':
-                if ( gCliData.lineIdx > 0 ) /* Make sure index is grater than zero to prevent dumping data on TAB key press event. */
+                if ( ctx->lineIdx > 0 ) /* Make sure index is grater than zero to prevent dumping data on TAB key press event. */
                 {
 
                     /* Alert the super loop / task to execute the auto complete logic. */
-                    gCliData.execType = CLI_Exec_AutoComplete;
-                    CLI_TaskAlert();
-                    gCliData.LineBack = 0;
+                    ctx->execType = CLI_Exec_AutoComplete;
+                    CLI_Alert(ctx);
+                    ctx->LineBack = 0;
                 }
                 break;
 
             case '\b':
-                CLI_EraseChar();
-                gCliData.LineBack = 0;
+                CLI_EraseChar(ctx);
+                ctx->LineBack = 0;
                 break;
 
             case CLI_ARROW_DOWN:
-                if ( gCliData.LineBack )
+                if ( ctx->LineBack )
                 {
-                    gCliData.LineBack--;
+                    ctx->LineBack--;
                     /* Alert the super loop / task to execute history retrieval. */
-                    gCliData.execType = CLI_Exec_RetrieveHistory;
-                    CLI_TaskAlert();
+                    ctx->execType = CLI_Exec_RetrieveHistory;
+                    CLI_Alert(ctx);
                 }
                 break;
 
             case CLI_ARROW_UP:
-                if ( gCliData.LineBack < gCliData.LineCount )
+                if ( ctx->LineBack < ctx->LineCount )
                 {
-                    gCliData.LineBack++;
+                    ctx->LineBack++;
 
                     /* Alert the super loop / task to execute history retrieval. */
-                    gCliData.execType = CLI_Exec_RetrieveHistory;
-                    CLI_TaskAlert();
+                    ctx->execType = CLI_Exec_RetrieveHistory;
+                    CLI_Alert(ctx);
                 }
                 break;
 
@@ -1047,34 +2695,34 @@ bool CLI_ProcessChar(unsigned char c)
             break;
 
             case CLI_TAB:
-                if ( gCliData.lineIdx > 0 ) /* Make sure index is grater than zero to prevent dumping data on TAB key press event. */
+                if ( ctx->lineIdx > 0 ) /* Make sure index is grater than zero to prevent dumping data on TAB key press event. */
                 {
                     /* Alert the super loop / task to execute the auto complete logic. */
-                    gCliData.execType = CLI_Exec_AutoComplete;
-                    CLI_TaskAlert();
-                    gCliData.LineBack = 0;
+                    ctx->execType = CLI_Exec_AutoComplete;
+                    CLI_Alert(ctx);
+                    ctx->LineBack = 0;
                 }
                 break;
 
             default:
                 /* Add the RX character to the command buffer. */
-                if ( gCliData.lineIdx < (CLI_MAX_LINE_LENGTH - 1) )
+                if ( ctx->lineIdx < (CLI_MAX_LINE_LENGTH - 1) )
                 {
                     /* Force input to lower case. */
-                    if ( gCliData.autoLowerCase == true )
+                    if ( ctx->autoLowerCase == true )
                         c = tolower(c);
 
                     /* No echo when locked. */
-                    if ( gCliData.echo && gCliData.locked == false )
-                        CLI_Print((char *) &c, 1);
+                    if ( ctx->echo && ctx->locked == false )
+                        CLI_Print(ctx, (char *) &c, 1);
 
-                    gCliData.line[gCliData.lineCurrent][gCliData.lineIdx++] = c;
-                    gCliData.line[gCliData.lineCurrent][gCliData.lineIdx]   = '\0';
+                    ctx->line[ctx->lineCurrent][ctx->lineIdx++] = c;
+                    ctx->line[ctx->lineCurrent][ctx->lineIdx]   = '\0';
                 }
                 else
-                    gCliData.lineIdx = 0;
+                    ctx->lineIdx = 0;
 
-                gCliData.LineBack = 0;
+                ctx->LineBack = 0;
         }
     } while ( 0 );
 
@@ -1082,42 +2730,364 @@ bool CLI_ProcessChar(unsigned char c)
 }
 
 /**
-  * @brief  initializes CLI internal processor.
-  * @param[in] cliInit a pointer to a module configuration structure.
-  * @retval none.
+ * @brief
+ *  process a single input byte, see CLI_HandleChar().
+  * @param ctx: Context handle.
+  * @param c: Rx byte.
+  * @retval boolean: true if a command is ready to be executed.
   */
 
-bool CLI_Init(CLI_InitTypeDef *cliInit)
+bool CLI_ContextProcessChar(CLI_Context *ctx, unsigned char c)
 {
-    char    Prompt[CLI_MAX_PROMPT + 1] = {0};
-    uint8_t escIndex                   = 0;
+    bool commandTriggered;
 
-    /* Sanity */
-    if ( cliInit == NULL || gCliData.initialized == true )
+    if ( ctx == NULL || ctx->initialized == false )
+        return false;
+
+    /* Keep the input order, wait behind a pending state and earlier typeahead. */
+    if ( ctx->execType != CLI_Exec_Nothing || CLI_TypeaheadPending(ctx) )
+    {
+        if ( CLI_IsInline(ctx) == false )
+        {
+            CLI_QueueInput(ctx, &c, 1);
+            return false;
+        }
+
+        CLI_ContextProcessState(ctx);
+    }
+
+    commandTriggered = CLI_HandleChar(ctx, c);
+
+    /* Nobody to alert, serve the state right away. */
+    if ( ctx->execType != CLI_Exec_Nothing && CLI_IsInline(ctx) )
+        CLI_ContextProcessState(ctx);
+
+    CLI_OutFlush(ctx);
+    return commandTriggered;
+}
+
+/**
+ * @brief
+ *  process a single input byte on the default context.
+  * @param c: Rx byte.
+  * @retval boolean: true if a command is ready to be executed.
+  */
+
+bool CLI_ProcessChar(unsigned char c)
+{
+    return CLI_ContextProcessChar(&gCliData, c);
+}
+
+/**
+ * @brief
+ *  Run a batch of input bytes through the state machine, stops as soon as a
+ *  byte leaves a state pending. Runs of printable characters are appended to
+ *  the command line and echoed with a single write, control and escape bytes
+ *  go through CLI_HandleChar().
+ * @retval Count of bytes consumed.
+ */
+
+static size_t CLI_FeedBytes(CLI_Context *ctx, const unsigned char *buf, size_t len)
+{
+    size_t pos = 0;
+    size_t run;
+    size_t room;
+    char  *dst;
+
+    while ( pos < len && ctx->execType == CLI_Exec_Nothing )
+    {
+        /* Fast path: plain text while not in the middle of an escape sequence. */
+        if ( __atomic_load_n(&gCliTable.current, __ATOMIC_ACQUIRE) != NULL && ctx->receivingEscapeSequence == false )
+        {
+            room = (ctx->lineIdx < (CLI_MAX_LINE_LENGTH - 1)) ? (CLI_MAX_LINE_LENGTH - 1) - ctx->lineIdx : 0;
+            run  = CLI_MIN(CLI_PrintableSpan(buf + pos, len - pos), room);
+
+            if ( run > 0 )
+            {
+                dst = &ctx->line[ctx->lineCurrent][ctx->lineIdx];
+                memcpy(dst, buf + pos, run);
+                dst[run] = '\0';
+
+                /* Force input to lower case. */
+                if ( ctx->autoLowerCase == true )
+                    ctx->cliInitData.handlers.strlwr(dst);
+
+                /* No echo when locked. */
+                if ( ctx->echo && ctx->locked == false )
+                    CLI_Print(ctx, dst, (int) run);
+
+                ctx->lineIdx += run;
+                ctx->LineBack = 0;
+                pos += run;
+                continue;
+            }
+        }
+
+        CLI_HandleChar(ctx, buf[pos++]);
+    }
+
+    return pos;
+}
+
+/**
+ * @brief
+ *  Serve the pending state of a context.
+ * @retval boolean: true if wen't OK.
+ */
+
+static bool CLI_RunState(CLI_Context *ctx)
+{
+    bool retVal = false;
+
+    /* Commands dispatch and completion read the table pinned here, a table
+     * published meanwhile is picked up with the next state. */
+    CLI_TableAcquire(ctx);
+
+    switch ( ctx->execType )
+    {
+        case CLI_Exec_SearchAndExec:
+            ctx->outCmdWriteCalls = 0;
+            retVal                = CLI_SearchAndExecute(ctx);
+            CLI_OutFlush(ctx);
+            ctx->outStats.lastCmdWriteCalls = ctx->outCmdWriteCalls;
+            break;
+
+        case CLI_Exec_AutoComplete:
+            retVal = CLI_TabCompleter(ctx, ctx->line[ctx->lineCurrent], ctx->lineIdx);
+            break;
+        case CLI_Exec_RetrieveHistory:
+            retVal = cliRetrieveHistory(ctx);
+            break;
+        case CLI_Exec_WaitJob:
+            retVal = CLI_WaitJobs(ctx);
+            break;
+        default:
+            break;
+    }
+
+    CLI_TableRelease(ctx);
+
+    /* A command may have left the context waiting for a job. */
+    ctx->execType = ctx->waiting ? CLI_Exec_WaitJob : CLI_Exec_Nothing;
+    CLI_OutFlush(ctx);
+
+    return retVal;
+}
+
+/**
+ * @brief
+ *  Feed the typeahead ring to the state machine until it is empty or a state
+ *  becomes pending. Consumer side of the ring.
+ * @retval boolean: true if a state is pending.
+ */
+
+static bool CLI_TypeaheadDrain(CLI_Context *ctx)
+{
+    CLI_InRingTypeDef *ring = &ctx->typeahead;
+    uint32_t           head;
+    uint32_t           tail;
+    uint32_t           offset;
+    size_t             used;
+
+    while ( ctx->execType == CLI_Exec_Nothing )
+    {
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if ( head == tail )
+            break;
+
+        offset = tail & ring->mask;
+        used   = CLI_FeedBytes(ctx, ring->buf + offset, CLI_MIN(head - tail, (ring->mask + 1) - offset));
+
+        /* Hand the consumed room back to the producer. */
+        __atomic_store_n(&ring->tail, tail + (uint32_t) used, __ATOMIC_RELEASE);
+    }
+
+    return ctx->execType != CLI_Exec_Nothing;
+}
+
+/**
+ * @brief
+ *  Performs state logic after an event was set from the CLI bytes processor.
+ *  We're doing this to execute most of the CLI logic from a task context rather
+ *  than from an interrupt.
+  * @param ctx: Context handle.
+  * @retval boolean: true if wen't OK.
+  */
+
+bool CLI_ContextProcessState(CLI_Context *ctx)
+{
+    bool retVal;
+
+    if ( ctx == NULL || ctx->initialized == false )
         return false;
 
+    retVal = CLI_RunState(ctx);
+
+    /* Report background jobs that are done and redraw the line being typed. */
+    if ( ctx->execType == CLI_Exec_Nothing && CLI_JobsReport(ctx) )
+    {
+        CLI_ContextPrintPrompt(ctx, 0);
+        if ( ctx->lineIdx > 0 )
+            CLI_Print(ctx, ctx->line[ctx->lineCurrent], ctx->lineIdx);
+    }
+
+    /* Serve the keystrokes that arrived meanwhile, they may trigger more states. */
+    while ( CLI_TypeaheadDrain(ctx) && CLI_IsInline(ctx) )
+        CLI_RunState(ctx);
+
+    CLI_OutFlush(ctx);
+
+    return retVal;
+}
+
+/**
+ * @brief
+ *  Performs state logic of the default context.
+  * @retval boolean: true if wen't OK.
+  */
+
+bool CLI_ProcessState(void)
+{
+    return CLI_ContextProcessState(&gCliData);
+}
+
+/**
+ * @brief
+ *  Process a batch of input bytes, typically whatever a single read() returned.
+ *  Bytes arriving while a state (command, completion or history retrieval) is
+ *  pending are kept in the typeahead queue and fed once CLI_ContextProcessState()
+ *  is done with the state. Processing stops early only when the queue is full,
+ *  the caller is then expected to resume with the remaining bytes after
+ *  CLI_ContextProcessState(). Contexts without an alert handler serve states
+ *  inline and consume the whole batch. Nothing is consumed before
+ *  CLI_BuildTable(), which alerts the CLI task once done.
+  * @param ctx: Context handle.
+  * @param buf: Rx bytes.
+  * @param len: Count of bytes in 'buf'.
+  * @retval Count of bytes consumed.
+  */
+
+size_t CLI_ContextProcessBytes(CLI_Context *ctx, const unsigned char *buf, size_t len)
+{
+    size_t pos = 0;
+
+    if ( ctx == NULL || ctx->initialized == false || buf == NULL )
+        return 0;
+
+    /* Nothing to run commands against yet, leave the input to the caller. */
+    if ( __atomic_load_n(&gCliTable.commandsSorted, __ATOMIC_SEQ_CST) == false )
+        return 0;
+
+    while ( pos < len )
+    {
+        if ( ctx->execType != CLI_Exec_Nothing || CLI_TypeaheadPending(ctx) )
+        {
+            if ( CLI_IsInline(ctx) == false )
+            {
+                pos += CLI_QueueInput(ctx, buf + pos, len - pos);
+                break;
+            }
+
+            CLI_ContextProcessState(ctx);
+            continue;
+        }
+
+        pos += CLI_FeedBytes(ctx, buf + pos, len - pos);
+    }
+
+    if ( ctx->execType != CLI_Exec_Nothing && CLI_IsInline(ctx) )
+        CLI_ContextProcessState(ctx);
+
+    /* A single flush for the whole batch. */
+    CLI_OutFlush(ctx);
+
+    return pos;
+}
+
+/**
+ * @brief
+ *  Process a batch of input bytes on the default context.
+  * @param buf: Rx bytes.
+  * @param len: Count of bytes in 'buf'.
+  * @retval Count of bytes consumed.
+  */
+
+size_t CLI_ProcessBytes(const unsigned char *buf, size_t len)
+{
+    return CLI_ContextProcessBytes(&gCliData, buf, len);
+}
+
+/**
+  * @brief  initializes a CLI context.
+  * @param ctx: Context to initialize, zeroed.
+  * @param[in] cliInit a pointer to a module configuration structure.
+  * @retval none.
+  */
+
+static void CLI_ContextSetup(CLI_Context *ctx, const CLI_InitTypeDef *cliInit)
+{
+    char     Prompt[CLI_MAX_PROMPT + 1] = {0};
+    uint8_t  escIndex                   = 0;
+    uint32_t size;
+
     /* Store configuration locally. */
-    memcpy(&gCliData.cliInitData, cliInit, sizeof(CLI_InitTypeDef));
+    memcpy(&ctx->cliInitData, cliInit, sizeof(CLI_InitTypeDef));
 
-    gCliData.autoLowerCase = cliInit->autoLowerCase;
-    gCliData.echo          = cliInit->echo;
+    /* The first context hands its handlers to the shared table. */
+    if ( gCliTable.initialized == false )
+    {
+        gCliTable.handlers    = cliInit->handlers;
+        gCliTable.initialized = true;
+
+#ifdef CLI_STATIC_TABLE
+        /* Merged, sorted and hashed at build time, nothing left to do but publishing it.
+         * Linked first, ahead of any runtime injection, for later changes to build on. */
+        gCliStaticNode.table = gCliStaticTable.cmnds;
+        gCliStaticNode.items = (int) gCliStaticTable.count;
+        LL_PREPEND(gCliTable.cmndsTableHead, &gCliStaticNode);
+
+        gCliStaticCmdTable.root = &gCliStaticTable;
+        __atomic_store_n(&gCliTable.current, &gCliStaticCmdTable, __ATOMIC_RELEASE);
+#endif
+    }
+
+    /* Let table writers know about our hazard pointer. */
+    pthread_mutex_lock(&gCliTable.lock);
+    DL_APPEND2(gCliTable.readers, ctx, readerPrev, readerNext);
+    pthread_mutex_unlock(&gCliTable.lock);
+
+    ctx->autoLowerCase = cliInit->autoLowerCase;
+    ctx->echo          = cliInit->echo;
+
+    /* Output ring, falls back to unbuffered output if we can't get one. */
+    ctx->out.size = (cliInit->outBufferSize != 0) ? cliInit->outBufferSize : CLI_OUT_BUFFER_SIZE;
+    if ( cliInit->handlers.malloc != NULL )
+        ctx->out.buf = cliInit->handlers.malloc(ctx->out.size);
+
+    /* Typeahead queue, without one input arriving while busy is pushed back to the caller. */
+    size = (cliInit->typeaheadSize != 0) ? cliInit->typeaheadSize : CLI_TYPEAHEAD_SIZE;
+    while ( size & (size - 1) ) size += size & -size; /* Round up to a power of two */
+    if ( cliInit->handlers.malloc != NULL )
+        ctx->typeahead.buf = cliInit->handlers.malloc(size);
+    ctx->typeahead.mask = size - 1;
 
     /* StoreS escape sequence values, this could be changed pending on the
      * echoing mode. */
-    if ( gCliData.echo == true )
+    if ( ctx->echo == true )
     {
         /* CLI is echoing back to the client (remote is set to echo OFF).
          * Here we only handle escape codes for UP & DOWN where tab is
          * treated as \t */
 
-        gCliData.escapeSequence[escIndex].value    = CLI_ARROW_UP;
-        gCliData.escapeSequence[escIndex++].string = "[A";
-        gCliData.escapeSequence[escIndex].value    = CLI_ARROW_DOWN;
-        gCliData.escapeSequence[escIndex++].string = "[B";
-        gCliData.escapeSequence[escIndex].value    = CLI_ARROW_RIGHT;
-        gCliData.escapeSequence[escIndex++].string = "[C";
-        gCliData.escapeSequence[escIndex].value    = CLI_ARROW_LEFT;
-        gCliData.escapeSequence[escIndex++].string = "[D";
+        ctx->escapeSequence[escIndex].value    = CLI_ARROW_UP;
+        ctx->escapeSequence[escIndex++].string = "[A";
+        ctx->escapeSequence[escIndex].value    = CLI_ARROW_DOWN;
+        ctx->escapeSequence[escIndex++].string = "[B";
+        ctx->escapeSequence[escIndex].value    = CLI_ARROW_RIGHT;
+        ctx->escapeSequence[escIndex++].string = "[C";
+        ctx->escapeSequence[escIndex].value    = CLI_ARROW_LEFT;
+        ctx->escapeSequence[escIndex++].string = "[D";
     }
     else
     {
@@ -1131,34 +3101,140 @@ bool CLI_Init(CLI_InitTypeDef *cliInit)
          * LEFT : \033[D (Escape followed by 'D')
          */
 
-        gCliData.escapeSequence[escIndex].value    = CLI_TAB;
-        gCliData.escapeSequence[escIndex++].string = "T";
-        gCliData.escapeSequence[escIndex].value    = CLI_ARROW_UP;
-        gCliData.escapeSequence[escIndex++].string = "A";
-        gCliData.escapeSequence[escIndex].value    = CLI_ARROW_DOWN;
-        gCliData.escapeSequence[escIndex++].string = "B";
-        gCliData.escapeSequence[escIndex].value    = CLI_ARROW_RIGHT;
-        gCliData.escapeSequence[escIndex++].string = "C";
-        gCliData.escapeSequence[escIndex].value    = CLI_ARROW_LEFT;
-        gCliData.escapeSequence[escIndex++].string = "D";
+        ctx->escapeSequence[escIndex].value    = CLI_TAB;
+        ctx->escapeSequence[escIndex++].string = "T";
+        ctx->escapeSequence[escIndex].value    = CLI_ARROW_UP;
+        ctx->escapeSequence[escIndex++].string = "A";
+        ctx->escapeSequence[escIndex].value    = CLI_ARROW_DOWN;
+        ctx->escapeSequence[escIndex++].string = "B";
+        ctx->escapeSequence[escIndex].value    = CLI_ARROW_RIGHT;
+        ctx->escapeSequence[escIndex++].string = "C";
+        ctx->escapeSequence[escIndex].value    = CLI_ARROW_LEFT;
+        ctx->escapeSequence[escIndex++].string = "D";
     }
 
-    gCliData.escapeSequence[escIndex].string = NULL;
-    gCliData.escapeSequence[escIndex].value  = 0;
+    ctx->escapeSequence[escIndex].string = NULL;
+    ctx->escapeSequence[escIndex].value  = 0;
 
     /* Set the prompt string. */
-    snprintf(Prompt, CLI_MAX_PROMPT + 1, "%s>", cliInit->prompt);
-    strncpy(gCliData.prompt, Prompt, sizeof(gCliData.prompt) - 1);
-    gCliData.prmpSize = (uint8_t) strlen(gCliData.prompt); /* Adjust for time stamp. */
+    CLI_FmtString(Prompt, CLI_MAX_PROMPT + 1, "%s>", cliInit->prompt);
+    strncpy(ctx->prompt, Prompt, sizeof(ctx->prompt) - 1);
+    ctx->prmpSize = (uint8_t) strlen(ctx->prompt); /* Adjust for time stamp. */
 
     /* Assume highest credentials when initialized as not locked. */
     if ( cliInit->printPrompt == true )
-        CLI_PrintPrompt(1);
+        CLI_ContextPrintPrompt(ctx, 1);
+
+    CLI_OutFlush(ctx);
+
+    ctx->initialized = true;
+}
+
+/**
+  * @brief  Creates an independent CLI context (console session) sharing the
+  *         commands table with all other contexts. Contexts may be driven
+  *         from different threads concurrently.
+  *         Bytes are fed with CLI_ContextProcessBytes(), when 'cliInit->alert'
+  *         is provided it is called whenever the context needs
+  *         CLI_ContextProcessState() to run, otherwise the state is processed
+  *         inline by the feeding call.
+  * @param[in] cliInit a pointer to the context configuration structure.
+  * @retval Context handle or NULL on error.
+  */
+
+CLI_Context *CLI_ContextCreate(CLI_InitTypeDef *cliInit)
+{
+    CLI_Context *ctx;
+
+    if ( cliInit == NULL || cliInit->handlers.malloc == NULL || cliInit->handlers.free == NULL )
+        return NULL;
+
+    ctx = cliInit->handlers.malloc(sizeof(CLI_Context));
+    if ( ctx == NULL )
+        return NULL;
+
+    memset(ctx, 0, sizeof(CLI_Context));
+    ctx->allocated = true;
+    CLI_ContextSetup(ctx, cliInit);
+
+    return ctx;
+}
+
+/**
+  * @brief  Releases a context created by CLI_ContextCreate().
+  * @param ctx: Context handle.
+  */
+
+void CLI_ContextDestroy(CLI_Context *ctx)
+{
+    if ( ctx == NULL || ctx->allocated == false )
+        return;
+
+    CLI_JobsDetach(ctx);
+    CLI_OutFlush(ctx);
+
+    /* Drop the hazard pointer, a table only this context was holding goes with it. */
+    pthread_mutex_lock(&gCliTable.lock);
+    DL_DELETE3(gCliTable.readers, ctx, readerPrev, readerNext);
+    CLI_TableReclaim();
+    pthread_mutex_unlock(&gCliTable.lock);
+
+    if ( ctx->out.buf != NULL )
+        ctx->cliInitData.handlers.free(ctx->out.buf);
+
+    if ( ctx->typeahead.buf != NULL )
+        ctx->cliInitData.handlers.free(ctx->typeahead.buf);
+
+    ctx->initialized = false;
+    ctx->cliInitData.handlers.free(ctx);
+}
+
+/**
+  * @brief  Marks a context's session as ended, the owner of the context is
+  *         expected to tear it down once the feeding call returns.
+  * @param ctx: Context handle, NULL for the current context.
+  */
+
+void CLI_ContextEnd(CLI_Context *ctx)
+{
+    if ( ctx == NULL )
+        ctx = CLI_GetCurrentContext();
+
+    if ( ctx != NULL )
+        ctx->ended = true;
+}
+
+/**
+  * @brief  Checks whether CLI_ContextEnd() was called for a context.
+  * @param ctx: Context handle.
+  * @retval boolean, true when the session has ended.
+  */
+
+bool CLI_ContextIsEnded(CLI_Context *ctx)
+{
+    return ctx != NULL && ctx->ended;
+}
+
+/**
+  * @brief  initializes CLI internal processor, the default context and the
+  *         CLI task driving it.
+  * @param[in] cliInit a pointer to a module configuration structure.
+  * @retval none.
+  */
+
+bool CLI_Init(CLI_InitTypeDef *cliInit)
+{
+    /* Sanity */
+    if ( cliInit == NULL || gCliData.initialized == true )
+        return false;
+
+    CLI_ContextSetup(&gCliData, cliInit);
 
-    gCliData.initialized = true;
+    /* Jobs built in commands */
+    CLI_JobsInit();
 
     /* Lastly - fore the auxiliary thread */
-    CLI_InitTask();
+    CLI_InitTask(cliInit->io);
 
     return true;
 }
@@ -0,0 +1,321 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_args.c
+  * @brief   Typed command arguments, validated against the command schema.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_args.h" /* Module local include */
+#include "cli_fmt.h"
+#include "cli_num.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/** @defgroup CLI_ARGS CLI Args
+  * @brief CLI typed command arguments module
+  * @{
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_ARGS_Private_Variables CLI Args Private Variables
+  * @{
+  */
+
+/* Arguments of the command running on this thread. */
+static __thread const CLI_ArgsTypeDef *gCliArgsCurrent = NULL;
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_ARGS_Private_Functions CLI Args Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Whether a declared argument has bounds to check.
+ */
+
+static inline bool CLI_ArgsBounded(const CLI_ArgTypeDef *arg)
+{
+    return arg->min != 0 || arg->max != 0;
+}
+
+/**
+ * @brief
+ *  Index of a choice among the '|' separated ones (any case), -1 if none.
+ */
+
+static int64_t CLI_ArgsFindChoice(const char *choices, const char *text)
+{
+    const char *end;
+    size_t      len  = strlen(text);
+    int64_t     i    = 0;
+
+    while ( choices != NULL && *choices )
+    {
+        end = strchr(choices, '|');
+        if ( end == NULL )
+            end = choices + strlen(choices);
+
+        if ( (size_t) (end - choices) == len && strncasecmp(choices, text, len) == 0 )
+            return i;
+
+        choices = (*end != 0) ? end + 1 : end;
+        i++;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief
+ *  Convert and check a single argument. Return false and describe why in
+ *  'error' if it does not fit its declaration.
+ */
+
+static bool CLI_ArgsValue(const CLI_ArgTypeDef *arg, const char *text, int64_t *num, char *error, size_t size)
+{
+    CLI_NumStatusTypeDef status;
+    uint64_t             magnitude;
+
+    switch ( arg->type )
+    {
+        case CLI_ARG_INT:
+        case CLI_ARG_HEX:
+            if ( arg->type == CLI_ARG_HEX )
+            {
+                status = CLI_NumParseU64(text, CLI_NUM_HEX_BARE, &magnitude);
+                if ( status == CLI_NUM_OK && magnitude > INT64_MAX )
+                    status = CLI_NUM_OVERFLOW;
+                if ( status == CLI_NUM_OK )
+                    *num = (int64_t) magnitude;
+            }
+            else
+                status = CLI_NumParseI64(text, CLI_NUM_ANY, num);
+
+            if ( status == CLI_NUM_INVALID )
+            {
+                CLI_FmtString(error, size, "<%s>: '%s' is not %s", arg->name, text,
+                              (arg->type == CLI_ARG_HEX) ? "a hexadecimal number" : "an integer");
+                return false;
+            }
+
+            if ( status == CLI_NUM_OVERFLOW && ! CLI_ArgsBounded(arg) )
+            {
+                CLI_FmtString(error, size, "<%s>: %s does not fit in 64 bits", arg->name, text);
+                return false;
+            }
+
+            if ( status == CLI_NUM_OVERFLOW || (CLI_ArgsBounded(arg) && (*num < arg->min || *num > arg->max)) )
+            {
+                if ( arg->type == CLI_ARG_HEX )
+                    CLI_FmtString(error, size, "<%s>: %s is out of range [0x%" PRIx64 ", 0x%" PRIx64 "]", arg->name, text,
+                                  (uint64_t) arg->min, (uint64_t) arg->max);
+                else
+                    CLI_FmtString(error, size, "<%s>: %s is out of range [%" PRId64 ", %" PRId64 "]", arg->name, text, arg->min, arg->max);
+                return false;
+            }
+            break;
+
+        case CLI_ARG_ENUM:
+            *num = CLI_ArgsFindChoice(arg->choices, text);
+            if ( *num < 0 )
+            {
+                CLI_FmtString(error, size, "<%s>: '%s' is not one of %s", arg->name, text, arg->choices);
+                return false;
+            }
+            break;
+
+        case CLI_ARG_STRING:
+        default:
+            *num = (int64_t) strlen(text);
+            if ( CLI_ArgsBounded(arg) && (*num < arg->min || *num > arg->max) )
+            {
+                CLI_FmtString(error, size, "<%s>: length must be within [%" PRId64 ", %" PRId64 "]", arg->name, arg->min, arg->max);
+                return false;
+            }
+            break;
+    }
+
+    return true;
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_ARGS_Exported_Functions CLI Args Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Gets the validated arguments of the running command, from its
+  *         handler (or any function it calls).
+  * @retval Arguments, NULL if the command did not declare a schema.
+  */
+
+const CLI_ArgsTypeDef *CLI_GetArgs(void)
+{
+    return gCliArgsCurrent;
+}
+
+/**
+  * @brief  Validate the arguments of a command against its schema.
+  * @param schema: Arguments the command takes.
+  * @param argc: Arguments count, the command path included.
+  * @param argv: The command path, then its arguments.
+  * @param args: Out, typed arguments, defaults filled in. Strings point to
+  *         'argv' or to the schema.
+  * @param error: Out, why the arguments were refused.
+  * @param size: Room in 'error'.
+  * @retval boolean, true if the arguments are valid.
+  */
+
+bool CLI_ArgsParse(const CLI_ArgsSchemaTypeDef *schema, int argc, char **argv, CLI_ArgsTypeDef *args, char *error, size_t size)
+{
+    const CLI_ArgTypeDef *arg;
+    CLI_ArgValueTypeDef  *value;
+    const char           *text;
+    uint32_t              typed = (argc > 1) ? (uint32_t) argc - 1 : 0;
+    uint32_t              i;
+
+    error[0]    = '\0';
+    args->count = typed;
+
+    if ( typed > schema->count )
+    {
+        CLI_FmtString(error, size, "expects at most %u argument%s", schema->count, (schema->count == 1) ? "" : "s");
+        return false;
+    }
+
+    for ( i = 0; i < schema->count && i < CLI_MAX_NUM_PARAMS; i++ )
+    {
+        arg   = &schema->args[i];
+        value = &args->values[i];
+        text  = (i < typed) ? argv[i + 1] : arg->def;
+
+        value->present = false;
+        value->num     = 0;
+        value->str     = NULL;
+
+        if ( i >= typed && arg->optional == false )
+        {
+            CLI_FmtString(error, size, "missing <%s>", arg->name);
+            return false;
+        }
+
+        if ( text == NULL )
+            continue;
+
+        if ( ! CLI_ArgsValue(arg, text, &value->num, error, size) )
+            return false;
+
+        value->present = true;
+        value->str     = text;
+    }
+
+    return true;
+}
+
+/**
+  * @brief  Set the arguments CLI_GetArgs() returns on this thread, around a
+  *         handler call.
+  * @param args: Arguments of the handler about to run, NULL once it is done.
+  * @retval The previous ones, to be restored.
+  */
+
+const CLI_ArgsTypeDef *CLI_ArgsSwap(const CLI_ArgsTypeDef *args)
+{
+    const CLI_ArgsTypeDef *prev = gCliArgsCurrent;
+
+    gCliArgsCurrent = args;
+    return prev;
+}
+
+/**
+  * @brief  Write the usage text of a schema: '<name>' for a required argument,
+  *         '[name=default]' for an optional one, enums show their choices.
+  * @param schema: Arguments schema.
+  * @param buf: Out, NULL terminated text.
+  * @param size: Room in 'buf'.
+  * @retval Length of the text.
+  */
+
+size_t CLI_ArgsUsage(const CLI_ArgsSchemaTypeDef *schema, char *buf, size_t size)
+{
+    const CLI_ArgTypeDef *arg;
+    const char           *label;
+    size_t                len = 0;
+    uint32_t              i;
+
+    buf[0] = '\0';
+
+    for ( i = 0; i < schema->count && len < size; i++ )
+    {
+        arg   = &schema->args[i];
+        label = (arg->type == CLI_ARG_ENUM) ? arg->choices : arg->name;
+
+        if ( arg->optional )
+            len += CLI_FmtString(buf + len, size - len, "%s[%s%s%s]", (i > 0) ? " " : "", label, arg->def ? "=" : "", arg->def ? arg->def : "");
+        else
+            len += CLI_FmtString(buf + len, size - len, "%s<%s>", (i > 0) ? " " : "", label);
+    }
+
+    return (len < size) ? len : size - 1;
+}
+
+/**
+  * @brief  Find the choices of an enum argument starting with a prefix (any
+  *         case), in their declaration order.
+  * @param arg: Declared argument, anything but an enum has no choices.
+  * @param prefix: Typed prefix.
+  * @param len: Prefix length.
+  * @param choices: Out, matching choices (not NULL terminated).
+  * @param lengths: Out, their lengths.
+  * @param max: Room in 'choices' and 'lengths'.
+  * @retval Count of matching choices, at most 'max'.
+  */
+
+uint32_t CLI_ArgsComplete(const CLI_ArgTypeDef *arg, const char *prefix, size_t len, const char **choices, size_t *lengths, uint32_t max)
+{
+    const char *choice;
+    const char *end;
+    uint32_t    matches = 0;
+
+    if ( arg->type != CLI_ARG_ENUM || arg->choices == NULL )
+        return 0;
+
+    for ( choice = arg->choices; *choice && matches < max; choice = (*end != 0) ? end + 1 : end )
+    {
+        end = strchr(choice, '|');
+        if ( end == NULL )
+            end = choice + strlen(choice);
+
+        if ( (size_t) (end - choice) >= len && strncasecmp(choice, prefix, len) == 0 )
+        {
+            choices[matches] = choice;
+            lengths[matches] = (size_t) (end - choice);
+            matches++;
+        }
+    }
+
+    return matches;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,602 @@
+/**
+  ******************************************************************************
+  *
+  * @file    cli_fmt.c
+  * @brief   Formatted output without stdio, numbers from the cli_num tables.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_fmt.h" /* Module local include */
+#include "ansi.h"
+#include "cli_num.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/** @defgroup CLI_FMT CLI Fmt
+  * @brief CLI formatted output module
+  * @{
+  */
+
+/* Private define ------------------------------------------------------------*/
+/** @defgroup CLI_FMT_Private_Define CLI Fmt Private Define
+  * @{
+  */
+
+/* Conversion flags. */
+#define CLI_FMT_LEFT  0x01 /* '-': pad on the right */
+#define CLI_FMT_ZERO  0x02 /* '0': pad numbers with zeros */
+#define CLI_FMT_PLUS  0x04 /* '+': sign positive numbers */
+#define CLI_FMT_SPACE 0x08 /* ' ': a space before positive numbers */
+#define CLI_FMT_ALT   0x10 /* '#': '0x' before hexadecimal numbers, '0' before octal ones */
+
+/* Room for any 64 bits integer digits, octal ones included. */
+#define CLI_FMT_DIGITS_SIZE 24
+
+/* Fractional digits %f computes, any further ones are written as zeros. */
+#define CLI_FMT_FRAC_DIGITS 9
+
+/* Padding is written from constant runs of this length. */
+#define CLI_FMT_PAD_RUN 32
+
+#define CLI_FMT_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+/**
+  * @}
+  */
+
+/* Private types -------------------------------------------------------------*/
+/** @defgroup CLI_FMT_Private_Types CLI Fmt Private Types
+  * @{
+  */
+
+/** @brief Where the text goes, and how much of it went */
+typedef struct
+{
+    CLI_FmtSinkTypeDef sink; /*!< Receives the pieces */
+    void              *arg;  /*!< Its argument */
+    size_t             len;  /*!< Count of bytes handed so far */
+} CLI_FmtOutTypeDef;
+
+/** @brief A bounded string being formatted, see CLI_FmtString() */
+typedef struct
+{
+    char  *buf;  /*!< The string */
+    size_t size; /*!< Room in 'buf', its NULL included */
+    size_t len;  /*!< Count of bytes written */
+} CLI_FmtStringTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_FMT_Private_Variables CLI Fmt Private Variables
+  * @{
+  */
+
+static const char gCliFmtSpaces[CLI_FMT_PAD_RUN + 1] = ANSI_SPACES;
+static const char gCliFmtZeros[CLI_FMT_PAD_RUN + 1]  = "00000000000000000000000000000000";
+
+/* 10^0 to 10^9, scales of the %f fractional part. */
+static const uint32_t gCliFmtPow10[CLI_FMT_FRAC_DIGITS + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_FMT_Private_Functions CLI Fmt Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Hand a piece of text to the sink.
+ */
+
+static inline void CLI_FmtPut(CLI_FmtOutTypeDef *out, const char *buf, size_t len)
+{
+    if ( len > 0 )
+    {
+        out->sink(out->arg, buf, len);
+        out->len += len;
+    }
+}
+
+/**
+ * @brief
+ *  Hand 'count' fill characters to the sink, a run at a time.
+ */
+
+static void CLI_FmtPad(CLI_FmtOutTypeDef *out, const char *fill, size_t count)
+{
+    size_t chunk;
+
+    while ( count > 0 )
+    {
+        chunk = CLI_FMT_MIN(count, CLI_FMT_PAD_RUN);
+        CLI_FmtPut(out, fill, chunk);
+        count -= chunk;
+    }
+}
+
+/**
+ * @brief
+ *  Terminal columns a text takes: ANSI escape sequences (ESC '[', parameters,
+ *  then a final byte in 0x40..0x7E) take none, UTF-8 continuation bytes add
+ *  nothing to the character they belong to.
+ */
+
+static size_t CLI_FmtColumns(const char *s, size_t len)
+{
+    size_t cols = 0;
+    size_t i    = 0;
+
+    while ( i < len )
+    {
+        if ( s[i] == '\033' && i + 1 < len && s[i + 1] == '[' )
+        {
+            for ( i += 2; i < len && ((unsigned char) s[i] < 0x40 || (unsigned char) s[i] > 0x7E); i++ )
+                ;
+            i++;
+            continue;
+        }
+
+        cols += (((unsigned char) s[i] & 0xC0) != 0x80);
+        i++;
+    }
+
+    return cols;
+}
+
+/**
+ * @brief
+ *  Write a text padded to 'width' columns.
+ */
+
+static void CLI_FmtText(CLI_FmtOutTypeDef *out, const char *s, size_t len, uint32_t flags, int width)
+{
+    size_t cols = (width > 0) ? CLI_FmtColumns(s, len) : 0;
+    size_t pad  = (width > 0 && (size_t) width > cols) ? (size_t) width - cols : 0;
+
+    if ( (flags & CLI_FMT_LEFT) == 0 )
+        CLI_FmtPad(out, gCliFmtSpaces, pad);
+
+    CLI_FmtPut(out, s, len);
+
+    if ( flags & CLI_FMT_LEFT )
+        CLI_FmtPad(out, gCliFmtSpaces, pad);
+}
+
+/**
+ * @brief
+ *  Write an integer: padding, sign or '0x', precision zeros, then the digits.
+ */
+
+static void CLI_FmtInteger(CLI_FmtOutTypeDef *out, uint64_t value, bool negative, char conv, uint32_t flags, int width, int precision)
+{
+    char     digits[CLI_FMT_DIGITS_SIZE];
+    char     prefix[2];
+    uint64_t rest;
+    size_t   dlen;
+    size_t   plen  = 0;
+    size_t   zeros = 0;
+    size_t   total;
+    size_t   i;
+
+    if ( conv == 'x' || conv == 'X' || conv == 'p' )
+        dlen = CLI_NumFormatHex(value, digits, (conv == 'X'));
+    else if ( conv == 'o' )
+    {
+        dlen = (size_t) (64 - __builtin_clzll(value | 1) + 2) / 3;
+        for ( i = dlen, rest = value; i > 0; i--, rest >>= 3 )
+            digits[i - 1] = (char) ('0' + (rest & 7));
+    }
+    else
+        dlen = CLI_NumFormatU64(value, digits);
+
+    /* An explicit zero precision writes no digit for 0. */
+    if ( precision == 0 && value == 0 )
+        dlen = 0;
+
+    if ( negative )
+        prefix[plen++] = '-';
+    else if ( flags & CLI_FMT_PLUS )
+        prefix[plen++] = '+';
+    else if ( flags & CLI_FMT_SPACE )
+        prefix[plen++] = ' ';
+    else if ( conv == 'p' || ((flags & CLI_FMT_ALT) && value != 0 && (conv == 'x' || conv == 'X')) )
+    {
+        prefix[plen++] = '0';
+        prefix[plen++] = (conv == 'X') ? 'X' : 'x';
+    }
+
+    if ( precision >= 0 )
+        zeros = ((size_t) precision > dlen) ? (size_t) precision - dlen : 0;
+    else if ( (flags & (CLI_FMT_ZERO | CLI_FMT_LEFT)) == CLI_FMT_ZERO && (size_t) width > plen + dlen )
+        zeros = (size_t) width - plen - dlen;
+
+    /* '#' octal numbers start with a 0. */
+    if ( conv == 'o' && (flags & CLI_FMT_ALT) && zeros == 0 && (dlen == 0 || digits[0] != '0') )
+        zeros = 1;
+
+    total = plen + zeros + dlen;
+
+    if ( (flags & CLI_FMT_LEFT) == 0 && (size_t) width > total )
+        CLI_FmtPad(out, gCliFmtSpaces, (size_t) width - total);
+
+    CLI_FmtPut(out, prefix, plen);
+    CLI_FmtPad(out, gCliFmtZeros, zeros);
+    CLI_FmtPut(out, digits, dlen);
+
+    if ( (flags & CLI_FMT_LEFT) && (size_t) width > total )
+        CLI_FmtPad(out, gCliFmtSpaces, (size_t) width - total);
+}
+
+/**
+ * @brief
+ *  Write a floating point number in fixed point notation (%f). The number is
+ *  split into its integer part and its fractional part scaled to the
+ *  precision: no libm, no exact decimal expansion. Digits past the 17th
+ *  significant one may thus differ from printf(), integer parts beyond 64
+ *  bits keep their magnitude, not their low digits.
+ */
+
+static void CLI_FmtFixed(CLI_FmtOutTypeDef *out, double value, char conv, uint32_t flags, int width, int precision)
+{
+    char     ipart[CLI_FMT_DIGITS_SIZE];
+    char     fpart[CLI_FMT_DIGITS_SIZE];
+    char     prefix[1];
+    double   magnitude = __builtin_signbit(value) ? -value : value;
+    double   scaled;
+    uint64_t ip;
+    uint64_t fp;
+    size_t   ilen;
+    size_t   flen;
+    size_t   scale = 0;
+    size_t   plen  = 0;
+    size_t   frac;
+    size_t   extra;
+    size_t   zeros = 0;
+    size_t   total;
+    bool     dot;
+
+    if ( __builtin_signbit(value) )
+        prefix[plen++] = '-';
+    else if ( flags & CLI_FMT_PLUS )
+        prefix[plen++] = '+';
+    else if ( flags & CLI_FMT_SPACE )
+        prefix[plen++] = ' ';
+
+    if ( __builtin_isnan(value) || __builtin_isinf(value) )
+    {
+        memcpy(ipart, prefix, plen);
+        memcpy(ipart + plen, __builtin_isnan(value) ? ((conv == 'F') ? "NAN" : "nan") : ((conv == 'F') ? "INF" : "inf"), 3);
+        CLI_FmtText(out, ipart, plen + 3, flags, width);
+        return;
+    }
+
+    frac  = (precision < 0) ? 6 : (size_t) precision;
+    extra = (frac > CLI_FMT_FRAC_DIGITS) ? frac - CLI_FMT_FRAC_DIGITS : 0;
+    frac -= extra;
+    dot   = (frac + extra > 0) || (flags & CLI_FMT_ALT);
+
+    /* Keep the integer part within 64 bits, the dropped digits are zeros. */
+    for ( ; magnitude >= 18446744073709551616.0; scale++ )
+        magnitude /= 10;
+
+    /* Round half to even, ties being the binary fractions scaling exactly. */
+    ip     = (uint64_t) magnitude;
+    scaled = (magnitude - (double) ip) * gCliFmtPow10[frac];
+    fp     = (uint64_t) scaled;
+    if ( scaled - (double) fp > 0.5 || (scaled - (double) fp == 0.5 && ((frac > 0) ? fp : ip) & 1) )
+        fp++;
+    if ( fp >= gCliFmtPow10[frac] )
+    {
+        ip++;
+        fp -= gCliFmtPow10[frac];
+    }
+
+    ilen = CLI_NumFormatU64(ip, ipart);
+    flen = (frac > 0) ? CLI_NumFormatU64(fp, fpart) : 0;
+
+    total = plen + ilen + scale + dot + frac + extra;
+    if ( (flags & (CLI_FMT_ZERO | CLI_FMT_LEFT)) == CLI_FMT_ZERO && (size_t) width > total )
+        zeros = (size_t) width - total;
+    total += zeros;
+
+    if ( (flags & CLI_FMT_LEFT) == 0 && (size_t) width > total )
+        CLI_FmtPad(out, gCliFmtSpaces, (size_t) width - total);
+
+    CLI_FmtPut(out, prefix, plen);
+    CLI_FmtPad(out, gCliFmtZeros, zeros);
+    CLI_FmtPut(out, ipart, ilen);
+    CLI_FmtPad(out, gCliFmtZeros, scale);
+    if ( dot )
+        CLI_FmtPut(out, ".", 1);
+    CLI_FmtPad(out, gCliFmtZeros, frac - flen);
+    CLI_FmtPut(out, fpart, flen);
+    CLI_FmtPad(out, gCliFmtZeros, extra);
+
+    if ( (flags & CLI_FMT_LEFT) && (size_t) width > total )
+        CLI_FmtPad(out, gCliFmtSpaces, (size_t) width - total);
+}
+
+/**
+ * @brief
+ *  Fetch a signed integer argument of the given length modifier ('H' stands
+ *  for hh, 'q' for ll).
+ */
+
+static int64_t CLI_FmtSigned(va_list *args, char size)
+{
+    switch ( size )
+    {
+        case 'H':
+            return (signed char) va_arg(*args, int);
+        case 'h':
+            return (short) va_arg(*args, int);
+        case 'l':
+            return va_arg(*args, long);
+        case 'q':
+            return va_arg(*args, long long);
+        case 'j':
+            return va_arg(*args, intmax_t);
+        case 'z':
+        case 't':
+            return va_arg(*args, ptrdiff_t);
+        default:
+            return va_arg(*args, int);
+    }
+}
+
+/**
+ * @brief
+ *  Fetch an unsigned integer argument, see CLI_FmtSigned().
+ */
+
+static uint64_t CLI_FmtUnsigned(va_list *args, char size)
+{
+    switch ( size )
+    {
+        case 'H':
+            return (unsigned char) va_arg(*args, unsigned int);
+        case 'h':
+            return (unsigned short) va_arg(*args, unsigned int);
+        case 'l':
+            return va_arg(*args, unsigned long);
+        case 'q':
+            return va_arg(*args, unsigned long long);
+        case 'j':
+            return va_arg(*args, uintmax_t);
+        case 'z':
+        case 't':
+            return va_arg(*args, size_t);
+        default:
+            return va_arg(*args, unsigned int);
+    }
+}
+
+/**
+ * @brief
+ *  Sink of CLI_FmtString(), keeps what fits and room for the NULL.
+ */
+
+static void CLI_FmtStringSink(void *arg, const char *buf, size_t len)
+{
+    CLI_FmtStringTypeDef *str = (CLI_FmtStringTypeDef *) arg;
+    size_t                n;
+
+    if ( str->size == 0 )
+        return;
+
+    n = CLI_FMT_MIN(len, str->size - 1 - str->len);
+    memcpy(str->buf + str->len, buf, n);
+    str->len += n;
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_FMT_Exported_Functions CLI Fmt Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Format text, handing it to a sink as it goes.
+  * @param sink: Receives the text, in pieces.
+  * @param arg: Passed to 'sink'.
+  * @param format: printf() like format, conversions listed in cli_fmt.h.
+  * @param args: Arguments of the format.
+  * @retval Count of bytes handed to the sink.
+  */
+
+size_t CLI_FmtVPrint(CLI_FmtSinkTypeDef sink, void *arg, const char *format, va_list args)
+{
+    CLI_FmtOutTypeDef out = {sink, arg, 0};
+    const char       *spec;
+    const char       *p;
+    const char       *s;
+    va_list           ap;
+    uint32_t          flags;
+    int64_t           num;
+    int               width;
+    int               precision;
+    char              size;
+    char              c;
+
+    va_copy(ap, args);
+
+    while ( *format )
+    {
+        /* Literal run up to the next conversion. */
+        spec = strchr(format, '%');
+        if ( spec == NULL )
+            spec = format + strlen(format);
+        CLI_FmtPut(&out, format, (size_t) (spec - format));
+        if ( *spec == '\0' )
+            break;
+
+        flags     = 0;
+        width     = 0;
+        precision = -1;
+        size      = 0;
+
+        for ( p = spec + 1;; p++ )
+        {
+            if ( *p == '-' )
+                flags |= CLI_FMT_LEFT;
+            else if ( *p == '0' )
+                flags |= CLI_FMT_ZERO;
+            else if ( *p == '+' )
+                flags |= CLI_FMT_PLUS;
+            else if ( *p == ' ' )
+                flags |= CLI_FMT_SPACE;
+            else if ( *p == '#' )
+                flags |= CLI_FMT_ALT;
+            else
+                break;
+        }
+
+        if ( *p == '*' )
+        {
+            width = va_arg(ap, int);
+            if ( width < 0 )
+            {
+                flags |= CLI_FMT_LEFT;
+                width = -width;
+            }
+            p++;
+        }
+        else
+        {
+            for ( ; *p >= '0' && *p <= '9'; p++ )
+                width = width * 10 + (*p - '0');
+        }
+
+        if ( *p == '.' )
+        {
+            p++;
+            if ( *p == '*' )
+            {
+                precision = va_arg(ap, int);
+                if ( precision < 0 )
+                    precision = -1;
+                p++;
+            }
+            else
+            {
+                for ( precision = 0; *p >= '0' && *p <= '9'; p++ )
+                    precision = precision * 10 + (*p - '0');
+            }
+        }
+
+        if ( *p == 'h' || *p == 'l' )
+        {
+            size = *p++;
+            if ( *p == size )
+            {
+                size = (size == 'h') ? 'H' : 'q';
+                p++;
+            }
+        }
+        else if ( *p == 'z' || *p == 'j' || *p == 't' )
+            size = *p++;
+
+        if ( *p == '\0' )
+            break; /* Format ends within a conversion. */
+        format = p + 1;
+
+        switch ( *p )
+        {
+            case 'd':
+            case 'i':
+                num = CLI_FmtSigned(&ap, size);
+                CLI_FmtInteger(&out, (num < 0) ? 0 - (uint64_t) num : (uint64_t) num, (num < 0), 'd', flags & ~CLI_FMT_ALT, width,
+                               precision);
+                break;
+
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                CLI_FmtInteger(&out, CLI_FmtUnsigned(&ap, size), false, *p, flags & ~(CLI_FMT_PLUS | CLI_FMT_SPACE), width, precision);
+                break;
+
+            case 'p':
+                s = va_arg(ap, const char *);
+                if ( s == NULL )
+                    CLI_FmtText(&out, "(nil)", 5, flags, width);
+                else
+                    CLI_FmtInteger(&out, (uintptr_t) s, false, 'p', flags & ~(CLI_FMT_PLUS | CLI_FMT_SPACE), width, -1);
+                break;
+
+            case 's':
+                s = va_arg(ap, const char *);
+                if ( s == NULL )
+                    s = "(null)";
+                CLI_FmtText(&out, s, (precision >= 0) ? strnlen(s, (size_t) precision) : strlen(s), flags, width);
+                break;
+
+            case 'f':
+            case 'F':
+                CLI_FmtFixed(&out, va_arg(ap, double), *p, flags, width, precision);
+                break;
+
+            case 'c':
+                c = (char) va_arg(ap, int);
+                CLI_FmtText(&out, &c, 1, flags, width);
+                break;
+
+            case '%':
+                CLI_FmtPut(&out, "%", 1);
+                break;
+
+            default:
+                /* Not supported, written as is. */
+                CLI_FmtPut(&out, spec, (size_t) (format - spec));
+                break;
+        }
+    }
+
+    va_end(ap);
+    return out.len;
+}
+
+/**
+  * @brief  Format text to a string, snprintf() alike.
+  * @param buf: Out, NULL terminated text, truncated to fit. May be NULL if
+  *         'size' is 0.
+  * @param size: Room in 'buf'.
+  * @param format: printf() like format, conversions listed in cli_fmt.h.
+  * @retval Length of the whole text, 'size' or more when it was truncated.
+  */
+
+size_t CLI_FmtString(char *buf, size_t size, const char *format, ...)
+{
+    CLI_FmtStringTypeDef str = {buf, size, 0};
+    va_list              args;
+    size_t               len;
+
+    va_start(args, format);
+    len = CLI_FmtVPrint(CLI_FmtStringSink, &str, format, args);
+    va_end(args);
+
+    if ( size > 0 )
+        buf[str.len] = '\0';
+
+    return len;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
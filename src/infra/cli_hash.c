@@ -0,0 +1,228 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_hash.c
+  * @brief   Minimal perfect hash (hash and displace) over command names.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_hash.h" /* Module local include */
+#include <string.h>
+
+/** @defgroup CLI_HASH CLI Hash
+  * @brief CLI commands perfect hash module
+  * @{
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_HASH_Exported_Functions CLI Hash Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Seeded FNV-1a over the lower cased name, so that typed input can
+  *         be hashed as is against the lower cased table.
+  * @param name: NULL terminated name.
+  * @param seed: Hash seed, 0 selects the bucket.
+  * @retval Hash value.
+  */
+
+uint32_t CLI_HashName(const char *name, uint32_t seed)
+{
+    uint32_t      hash = 0x811C9DC5 ^ (seed * 0x9E3779B9);
+    unsigned char c;
+
+    while ( (c = (unsigned char) *name++) != 0 )
+    {
+        if ( c >= 'A' && c <= 'Z' )
+            c += 'a' - 'A';
+        hash = (hash ^ c) * 0x01000193;
+    }
+
+    /* Final avalanche, FNV alone leaves the low bits poorly mixed. */
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6B;
+    hash ^= hash >> 13;
+
+    return hash;
+}
+
+/**
+  * @brief  Build a minimal perfect hash over unique lower cased names. Names
+  *         are spread over 'count' buckets, then the buckets are placed
+  *         largest first: each multi key bucket gets the first seed that sends
+  *         all of its keys to free slots, single key buckets take the
+  *         remaining slots directly.
+  * @param names: Names pool, names must be unique.
+  * @param nameOffs: Offset of each name in 'names'.
+  * @param count: Count of names.
+  * @param disp: Out, 'count' entries: per bucket seed, or -(slot + 1) for
+  *        single key buckets.
+  * @param slots: Out, 'count' entries: the name of each slot.
+  * @param pMalloc: Scratch memory allocator.
+  * @param pFree: Scratch memory release.
+  * @retval boolean, true if the hash was built.
+  */
+
+bool CLI_HashBuild(const char *names, const uint32_t *nameOffs, uint32_t count, int32_t *disp, CLI_HashSlotTypeDef *slots, __cli_malloc pMalloc,
+                   __cli_free pFree)
+{
+    uint32_t *bucketOf = NULL; /* Bucket of every command */
+    uint32_t *start    = NULL; /* Bucket first key index in 'grouped' */
+    uint32_t *grouped  = NULL; /* Names grouped by bucket */
+    uint8_t  *used     = NULL; /* Slot taken */
+    uint32_t  maxSize  = 0;
+    uint32_t  size;
+    uint32_t  slot;
+    uint32_t  b, k, j;
+    uint32_t  seed;
+    bool      retVal   = false;
+
+    do
+    {
+        if ( count == 0 )
+            break;
+
+        bucketOf = pMalloc(count * sizeof(uint32_t));
+        start    = pMalloc((count + 1) * sizeof(uint32_t));
+        grouped  = pMalloc(count * sizeof(uint32_t));
+        used     = pMalloc(count);
+
+        if ( ! bucketOf || ! start || ! grouped || ! used )
+            break;
+
+        memset(disp, 0, count * sizeof(int32_t));
+        memset(start, 0, (count + 1) * sizeof(uint32_t));
+        memset(used, 0, count);
+
+        /* Group the names by bucket (counting sort). */
+        for ( k = 0; k < count; k++ )
+        {
+            bucketOf[k] = CLI_HashName(names + nameOffs[k], 0) % count;
+            start[bucketOf[k] + 1]++;
+        }
+
+        for ( b = 0; b < count; b++ )
+        {
+            if ( start[b + 1] > maxSize )
+                maxSize = start[b + 1];
+            start[b + 1] += start[b];
+        }
+
+        for ( k = 0; k < count; k++ )
+            grouped[--start[bucketOf[k] + 1]] = k;
+
+        /* 'start[b + 1]' went back to the bucket first index, shift it down. */
+        for ( b = 0; b < count; b++ )
+            start[b] = start[b + 1];
+        start[count] = count;
+
+        /* Multi key buckets first, largest first, each one picking a seed. */
+        retVal = true;
+        for ( size = maxSize; size > 1 && retVal == true; size-- )
+        {
+            for ( b = 0; b < count && retVal == true; b++ )
+            {
+                if ( start[b + 1] - start[b] != size )
+                    continue;
+
+                for ( seed = 1; seed < CLI_HASH_MAX_SEED; seed++ )
+                {
+                    for ( j = 0; j < size; j++ )
+                    {
+                        slot = CLI_HashName(names + nameOffs[grouped[start[b] + j]], seed) % count;
+                        if ( used[slot] )
+                            break;
+                        used[slot]  = 1;
+                        bucketOf[j] = slot; /* Grouping is done, reuse as scratch */
+                    }
+
+                    if ( j == size )
+                        break;
+
+                    /* Collision, release what this seed took. */
+                    while ( j-- > 0 )
+                        used[bucketOf[j]] = 0;
+                }
+
+                if ( seed == CLI_HASH_MAX_SEED )
+                {
+                    retVal = false;
+                    break;
+                }
+
+                disp[b] = (int32_t) seed;
+                for ( j = 0; j < size; j++ )
+                    slots[bucketOf[j]].index = grouped[start[b] + j];
+            }
+        }
+
+        if ( retVal == false )
+            break;
+
+        /* Single key buckets take the remaining slots in order. */
+        slot = 0;
+        for ( b = 0; b < count; b++ )
+        {
+            if ( start[b + 1] - start[b] != 1 )
+                continue;
+
+            while ( used[slot] )
+                slot++;
+
+            used[slot]  = 1;
+            disp[b]     = -(int32_t) slot - 1;
+            slots[slot].index = grouped[start[b]];
+        }
+
+        /* A lookup rules most misses out on the key, and reads a hit name
+         * without going through the offsets. */
+        for ( slot = 0; slot < count; slot++ )
+        {
+            slots[slot].nameOff = nameOffs[slots[slot].index];
+            slots[slot].key     = CLI_HashName(names + slots[slot].nameOff, 0);
+        }
+
+    } while ( 0 );
+
+    if ( bucketOf )
+        pFree(bucketOf);
+    if ( start )
+        pFree(start);
+    if ( grouped )
+        pFree(grouped);
+    if ( used )
+        pFree(used);
+
+    return retVal;
+}
+
+/**
+  * @brief  Find the only name a name may match, the caller still has to
+  *         compare them.
+  * @param disp: Per bucket seeds, see CLI_HashBuild().
+  * @param slots: Slots, see CLI_HashBuild().
+  * @param count: Count of names, must not be 0.
+  * @param name: Name looked up, any case.
+  * @retval Candidate slot, NULL if the name can't be in the table.
+  */
+
+const CLI_HashSlotTypeDef *CLI_HashLookup(const int32_t *disp, const CLI_HashSlotTypeDef *slots, uint32_t count, const char *name)
+{
+    uint32_t key  = CLI_HashName(name, 0);
+    int32_t  d    = disp[key % count];
+    uint32_t slot = (d < 0) ? (uint32_t) (-d - 1) : CLI_HashName(name, (uint32_t) d) % count;
+
+    return (slots[slot].key == key) ? &slots[slot] : NULL;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,588 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_io.c
+  * @brief   CLI I/O backends.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_io.h" /* Module local include */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+/** @defgroup CLI_IO CLI I/O
+  * @brief CLI I/O backends module
+  * @{
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup CLI_IO_Private_Typedef CLI I/O Private Typedef
+  * @{
+  */
+
+/**
+  * @brief  Terminal backend private data.
+  */
+typedef struct __CLI_IoTtyTypeDef
+{
+    struct termios originalTerm;  /* Terminal settings to restore on close */
+    int            originalFlags; /* Input descriptor flags to restore on close */
+    bool           isTerm;        /* Input is a terminal we switched to raw mode */
+
+} CLI_IoTtyTypeDef;
+
+/**
+  * @brief  Loopback byte queue.
+  */
+typedef struct __CLI_IoQueueTypeDef
+{
+    unsigned char *buf;   /* Queue storage */
+    size_t         size;  /* Capacity in bytes */
+    size_t         head;  /* Next byte is read from here */
+    size_t         count; /* Bytes queued */
+
+} CLI_IoQueueTypeDef;
+
+/**
+  * @brief  Loopback backend private data.
+  */
+typedef struct __CLI_IoLoopbackTypeDef
+{
+    pthread_mutex_t    mutex;   /* Serializes the feeding side with the engine side */
+    CLI_IoQueueTypeDef in;      /* Bytes pushed by the feeder, read by the engine */
+    CLI_IoQueueTypeDef out;     /* Bytes written by the engine, pulled by the feeder */
+    size_t             dropped; /* Output bytes discarded because nobody pulled them */
+
+} CLI_IoLoopbackTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_IO_Private_Functions CLI I/O Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Descriptor based read, shared by the terminal and pipe backends.
+ */
+
+static ssize_t CLI_IoFdRead(CLI_IoTypeDef *io, void *buf, size_t len)
+{
+    return read(io->inFd, buf, len);
+}
+
+/**
+ * @brief
+ *  Descriptor based write, shared by the terminal and pipe backends.
+ */
+
+static ssize_t CLI_IoFdWritev(CLI_IoTypeDef *io, const struct iovec *iov, int iovcnt)
+{
+    return writev(io->outFd, iov, iovcnt);
+}
+
+/**
+ * @brief
+ *  Terminal backend: restore the original terminal mode.
+ */
+
+static void CLI_IoTtyClose(CLI_IoTypeDef *io)
+{
+    CLI_IoTtyTypeDef *tty = io->priv;
+
+    if ( tty == NULL )
+        return;
+
+    if ( tty->isTerm )
+        tcsetattr(io->inFd, TCSANOW, &tty->originalTerm);
+
+    fcntl(io->inFd, F_SETFL, tty->originalFlags);
+    free(tty);
+    io->priv = NULL;
+}
+
+/**
+ * @brief
+ *  Pipe backend: restore the input descriptor flags.
+ */
+
+static void CLI_IoPipeClose(CLI_IoTypeDef *io)
+{
+    int flags = fcntl(io->inFd, F_GETFL, 0);
+
+    if ( flags >= 0 )
+        fcntl(io->inFd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+/**
+ * @brief
+ *  Socket backend: non blocking receive.
+ */
+
+static ssize_t CLI_IoSocketRead(CLI_IoTypeDef *io, void *buf, size_t len)
+{
+    return recv(io->inFd, buf, len, MSG_DONTWAIT);
+}
+
+/**
+ * @brief
+ *  Socket backend: gathered send, a vanished peer must not raise SIGPIPE.
+ */
+
+static ssize_t CLI_IoSocketWritev(CLI_IoTypeDef *io, const struct iovec *iov, int iovcnt)
+{
+    struct msghdr msg = {0};
+
+    msg.msg_iov    = (struct iovec *) iov;
+    msg.msg_iovlen = (size_t) iovcnt;
+
+    return sendmsg(io->inFd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+/**
+ * @brief
+ *  Socket backend: close the connection.
+ */
+
+static void CLI_IoSocketClose(CLI_IoTypeDef *io)
+{
+    close(io->inFd);
+}
+
+/**
+ * @brief
+ *  Append to a loopback queue, returns count of bytes that fit.
+ */
+
+static size_t CLI_IoQueuePut(CLI_IoQueueTypeDef *q, const unsigned char *src, size_t len)
+{
+    size_t done = 0;
+    size_t tail;
+    size_t chunk;
+
+    while ( done < len && q->count < q->size )
+    {
+        tail  = (q->head + q->count) % q->size;
+        chunk = q->size - q->count;
+        if ( chunk > q->size - tail )
+            chunk = q->size - tail;
+        if ( chunk > len - done )
+            chunk = len - done;
+
+        memcpy(q->buf + tail, src + done, chunk);
+        q->count += chunk;
+        done += chunk;
+    }
+
+    return done;
+}
+
+/**
+ * @brief
+ *  Remove from a loopback queue, returns count of bytes copied out.
+ */
+
+static size_t CLI_IoQueueGet(CLI_IoQueueTypeDef *q, unsigned char *dst, size_t len)
+{
+    size_t done = 0;
+    size_t chunk;
+
+    while ( done < len && q->count > 0 )
+    {
+        chunk = q->count;
+        if ( chunk > q->size - q->head )
+            chunk = q->size - q->head;
+        if ( chunk > len - done )
+            chunk = len - done;
+
+        memcpy(dst + done, q->buf + q->head, chunk);
+        q->head = (q->head + chunk) % q->size;
+        q->count -= chunk;
+        done += chunk;
+    }
+
+    if ( q->count == 0 )
+        q->head = 0;
+
+    return done;
+}
+
+/**
+ * @brief
+ *  Loopback backend: hand pushed bytes to the engine.
+ */
+
+static ssize_t CLI_IoLoopbackRead(CLI_IoTypeDef *io, void *buf, size_t len)
+{
+    CLI_IoLoopbackTypeDef *lb = io->priv;
+    uint64_t               count;
+    size_t                 n;
+
+    pthread_mutex_lock(&lb->mutex);
+    n = CLI_IoQueueGet(&lb->in, buf, len);
+
+    /* Nothing left, re-arm the readiness descriptor. */
+    if ( lb->in.count == 0 && read(io->inFd, &count, sizeof(count)) < 0 )
+    {
+        /* EAGAIN: already drained. */
+    }
+
+    pthread_mutex_unlock(&lb->mutex);
+
+    if ( n == 0 )
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    return (ssize_t) n;
+}
+
+/**
+ * @brief
+ *  Loopback backend: keep engine output for the feeder, output that doesn't
+ *  fit is counted and dropped so the engine never stalls.
+ */
+
+static ssize_t CLI_IoLoopbackWritev(CLI_IoTypeDef *io, const struct iovec *iov, int iovcnt)
+{
+    CLI_IoLoopbackTypeDef *lb    = io->priv;
+    size_t                 total = 0;
+    size_t                 put;
+    int                    i;
+
+    pthread_mutex_lock(&lb->mutex);
+    for ( i = 0; i < iovcnt; i++ )
+    {
+        put = CLI_IoQueuePut(&lb->out, iov[i].iov_base, iov[i].iov_len);
+        lb->dropped += iov[i].iov_len - put;
+        total += iov[i].iov_len;
+    }
+    pthread_mutex_unlock(&lb->mutex);
+
+    return (ssize_t) total;
+}
+
+/**
+ * @brief
+ *  Loopback backend: release everything.
+ */
+
+static void CLI_IoLoopbackClose(CLI_IoTypeDef *io)
+{
+    CLI_IoLoopbackTypeDef *lb = io->priv;
+
+    if ( lb == NULL )
+        return;
+
+    close(io->inFd);
+    pthread_mutex_destroy(&lb->mutex);
+    free(lb->in.buf);
+    free(lb->out.buf);
+    free(lb);
+    io->priv = NULL;
+}
+
+/**
+ * @brief
+ *  Switch a descriptor to non-blocking mode.
+ */
+
+static bool CLI_IoSetNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+
+    if ( flags < 0 )
+        return false;
+
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/* clang-format off */
+static const CLI_IoOpsTypeDef gCliIoTtyOps      = { CLI_IoFdRead,       CLI_IoFdWritev,       CLI_IoTtyClose      };
+static const CLI_IoOpsTypeDef gCliIoPipeOps     = { CLI_IoFdRead,       CLI_IoFdWritev,       CLI_IoPipeClose     };
+static const CLI_IoOpsTypeDef gCliIoSocketOps   = { CLI_IoSocketRead,   CLI_IoSocketWritev,   CLI_IoSocketClose   };
+static const CLI_IoOpsTypeDef gCliIoLoopbackOps = { CLI_IoLoopbackRead, CLI_IoLoopbackWritev, CLI_IoLoopbackClose };
+/* clang-format on */
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_IO_Exported_Functions CLI I/O Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Terminal backend, the input terminal is switched to raw non-blocking
+  *         mode until the backend is closed. Falls back to a plain pipe when the
+  *         input is not a terminal.
+  * @param io: Backend instance to initialize.
+  * @param inFd: Input descriptor, typically STDIN_FILENO.
+  * @param outFd: Output descriptor, typically STDOUT_FILENO.
+  * @retval boolean, true on success.
+  */
+
+bool CLI_IoOpenTty(CLI_IoTypeDef *io, int inFd, int outFd)
+{
+    CLI_IoTtyTypeDef *tty;
+    struct termios    term;
+
+    if ( io == NULL )
+        return false;
+
+    tty = calloc(1, sizeof(CLI_IoTtyTypeDef));
+    if ( tty == NULL )
+        return false;
+
+    tty->originalFlags = fcntl(inFd, F_GETFL, 0);
+    if ( tty->originalFlags < 0 )
+    {
+        free(tty);
+        return false;
+    }
+
+    if ( tcgetattr(inFd, &term) == 0 )
+    {
+        tty->originalTerm = term;
+
+        /* Set the terminal to raw mode */
+        term.c_lflag &= ~(ICANON | ECHO | ISIG);
+        term.c_iflag &= ~(IXON | ICRNL);
+        term.c_oflag &= ~(OPOST);
+        term.c_cc[VMIN]  = 0;
+        term.c_cc[VTIME] = 1; // 100ms timeout
+
+        tty->isTerm = (tcsetattr(inFd, TCSANOW, &term) == 0);
+    }
+
+    if ( ! CLI_IoSetNonBlocking(inFd) )
+    {
+        if ( tty->isTerm )
+            tcsetattr(inFd, TCSANOW, &tty->originalTerm);
+        free(tty);
+        return false;
+    }
+
+    io->ops   = &gCliIoTtyOps;
+    io->inFd  = inFd;
+    io->outFd = outFd;
+    io->priv  = tty;
+
+    return true;
+}
+
+/**
+  * @brief  Pipe backend, plain descriptors with no terminal handling.
+  * @param io: Backend instance to initialize.
+  * @param inFd: Input descriptor.
+  * @param outFd: Output descriptor.
+  * @retval boolean, true on success.
+  */
+
+bool CLI_IoOpenPipe(CLI_IoTypeDef *io, int inFd, int outFd)
+{
+    if ( io == NULL || ! CLI_IoSetNonBlocking(inFd) )
+        return false;
+
+    io->ops   = &gCliIoPipeOps;
+    io->inFd  = inFd;
+    io->outFd = outFd;
+    io->priv  = NULL;
+
+    return true;
+}
+
+/**
+  * @brief  Socket backend over a connected stream socket (Unix or TCP), the
+  *         socket is owned by the backend and closed with it. Writes never
+  *         wait: a full socket stalls the output, the owner resumes it once the
+  *         socket is writable (CLI_ContextFlush()).
+  * @param io: Backend instance to initialize.
+  * @param sockFd: Connected socket.
+  * @retval boolean, true on success.
+  */
+
+bool CLI_IoOpenSocket(CLI_IoTypeDef *io, int sockFd)
+{
+    if ( io == NULL || sockFd < 0 )
+        return false;
+
+    io->ops   = &gCliIoSocketOps;
+    io->inFd  = sockFd;
+    io->outFd = -1;
+    io->priv  = NULL;
+
+    return true;
+}
+
+/**
+  * @brief  In-memory loopback backend. Input is fed with CLI_IoLoopbackPush(),
+  *         engine output is collected with CLI_IoLoopbackPull(). The input side
+  *         is waitable through an eventfd so the CLI task can be driven by it.
+  * @param io: Backend instance to initialize.
+  * @param size: Capacity of each direction in bytes.
+  * @retval boolean, true on success.
+  */
+
+bool CLI_IoOpenLoopback(CLI_IoTypeDef *io, size_t size)
+{
+    CLI_IoLoopbackTypeDef *lb;
+
+    if ( io == NULL || size == 0 )
+        return false;
+
+    lb = calloc(1, sizeof(CLI_IoLoopbackTypeDef));
+    if ( lb == NULL )
+        return false;
+
+    lb->in.buf   = malloc(size);
+    lb->out.buf  = malloc(size);
+    lb->in.size  = size;
+    lb->out.size = size;
+    io->inFd     = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if ( lb->in.buf == NULL || lb->out.buf == NULL || io->inFd < 0 || pthread_mutex_init(&lb->mutex, NULL) != 0 )
+    {
+        if ( io->inFd >= 0 )
+            close(io->inFd);
+        free(lb->in.buf);
+        free(lb->out.buf);
+        free(lb);
+        return false;
+    }
+
+    io->ops   = &gCliIoLoopbackOps;
+    io->outFd = -1;
+    io->priv  = lb;
+
+    return true;
+}
+
+/**
+  * @brief  Feed input bytes to a loopback backend.
+  * @param io: Loopback backend.
+  * @param buf: Bytes to feed.
+  * @param len: Count of bytes in 'buf'.
+  * @retval Count of bytes queued, less than 'len' when the input side is full.
+  */
+
+size_t CLI_IoLoopbackPush(CLI_IoTypeDef *io, const void *buf, size_t len)
+{
+    CLI_IoLoopbackTypeDef *lb;
+    uint64_t               one = 1;
+    size_t                 n;
+
+    if ( io == NULL || io->ops != &gCliIoLoopbackOps || buf == NULL )
+        return 0;
+
+    lb = io->priv;
+
+    pthread_mutex_lock(&lb->mutex);
+    n = CLI_IoQueuePut(&lb->in, buf, len);
+    if ( n > 0 && write(io->inFd, &one, sizeof(one)) < 0 )
+    {
+        /* EAGAIN: already signaled. */
+    }
+    pthread_mutex_unlock(&lb->mutex);
+
+    return n;
+}
+
+/**
+  * @brief  Collect engine output from a loopback backend.
+  * @param io: Loopback backend.
+  * @param buf: Destination buffer.
+  * @param len: Size of 'buf'.
+  * @retval Count of bytes copied.
+  */
+
+size_t CLI_IoLoopbackPull(CLI_IoTypeDef *io, void *buf, size_t len)
+{
+    CLI_IoLoopbackTypeDef *lb;
+    size_t                 n;
+
+    if ( io == NULL || io->ops != &gCliIoLoopbackOps || buf == NULL )
+        return 0;
+
+    lb = io->priv;
+
+    pthread_mutex_lock(&lb->mutex);
+    n = CLI_IoQueueGet(&lb->out, buf, len);
+    pthread_mutex_unlock(&lb->mutex);
+
+    return n;
+}
+
+/**
+  * @brief  Block read through a backend.
+  * @retval See read(2).
+  */
+
+ssize_t CLI_IoRead(CLI_IoTypeDef *io, void *buf, size_t len)
+{
+    if ( io == NULL || io->ops == NULL || io->ops->read == NULL )
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    return io->ops->read(io, buf, len);
+}
+
+/**
+  * @brief  Block write through a backend.
+  * @retval See writev(2).
+  */
+
+ssize_t CLI_IoWritev(CLI_IoTypeDef *io, const struct iovec *iov, int iovcnt)
+{
+    if ( io == NULL || io->ops == NULL || io->ops->writev == NULL )
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    return io->ops->writev(io, iov, iovcnt);
+}
+
+/**
+  * @brief  Release a backend.
+  * @param io: Backend instance.
+  */
+
+void CLI_IoClose(CLI_IoTypeDef *io)
+{
+    if ( io == NULL || io->ops == NULL )
+        return;
+
+    if ( io->ops->close != NULL )
+        io->ops->close(io);
+
+    io->ops   = NULL;
+    io->inFd  = -1;
+    io->outFd = -1;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,727 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_jobs.c
+  * @brief   CLI jobs, asynchronous command execution on a worker pool.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_jobs.h" /* Module local include */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cli_args.h" /* Typed command arguments */
+#include "cli_fmt.h"  /* Formatted output */
+#include "cli_num.h"  /* Integers formatting and parsing */
+#include "llist.h"    /* Basic lists manipulation */
+
+/** @defgroup CLI_JOBS CLI Jobs
+  * @brief CLI jobs module
+  * @{
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup CLI_JOBS_Private_Typedef CLI Jobs Private Typedef
+  * @{
+  */
+
+/**
+  * @brief  Job life cycle.
+  */
+typedef enum
+{
+    CLI_Job_Queued = 0, /* Waiting for a worker */
+    CLI_Job_Running,    /* A worker runs the handler */
+    CLI_Job_Done,       /* Handler returned, output pending report */
+
+} CLI_JobStateTypeDef;
+
+/**
+  * @brief  A single job.
+  */
+typedef struct __CLI_JobTypeDef
+{
+    uint32_t                 id;                             /* Job id, as shown to the user */
+    CLI_Context             *ctx;                            /* Context the job reports to, NULL once detached */
+    int                      (*pHandler)(int, char **);      /* Command handler */
+    int                      argc;                           /* Arguments count */
+    char                    *argv[CLI_MAX_NUM_PARAMS + 1];   /* Arguments, pointing into 'args' */
+    char                     args[CLI_MAX_LINE_LENGTH + 16]; /* Arguments storage */
+    CLI_ArgsTypeDef          typed;                          /* Typed arguments, when the command declared them */
+    bool                     hasTyped;                       /* 'typed' is set */
+    char                    *out;                            /* Buffered output, allocated on first write */
+    size_t                   outLen;                         /* Buffered output length */
+    bool                     truncated;                      /* Output exceeded CLI_JOB_OUTPUT_SIZE */
+    CLI_JobStateTypeDef      state;                          /* Life cycle state */
+    int                      result;                         /* Handler return value */
+    bool                     background;                     /* Reported asynchronously when done */
+    bool                     cancel;                         /* Cancellation requested */
+    struct __CLI_JobTypeDef *prev;                           /* Jobs registry */
+    struct __CLI_JobTypeDef *next;                           /* Jobs registry */
+    struct __CLI_JobTypeDef *qprev;                          /* Worker queue */
+    struct __CLI_JobTypeDef *qnext;                          /* Worker queue */
+
+} CLI_JobTypeDef;
+
+/**
+  * @brief  A worker thread and its own jobs queue.
+  */
+typedef struct __CLI_WorkerTypeDef
+{
+    pthread_t        thread; /* Worker thread */
+    pthread_mutex_t  lock;   /* Protects 'queue' */
+    CLI_JobTypeDef  *queue;  /* Jobs handed to this worker */
+    uint32_t         index;  /* Position in the pool */
+
+} CLI_WorkerTypeDef;
+
+/**
+  * @brief  The module locals.
+  */
+typedef struct __CLI_JobsDataTypeDef
+{
+    CLI_WorkerTypeDef workers[CLI_JOBS_WORKERS]; /* Worker pool */
+    uint32_t          workersCount;              /* Workers actually running */
+    uint32_t          nextWorker;                /* Round robin submission */
+    pthread_mutex_t   poolLock;                  /* Protects 'queued' and is held around queuing, idle workers sleep on 'poolCond' */
+    pthread_cond_t    poolCond;                  /* Signaled when a job is queued */
+    uint32_t          queued;                    /* Jobs waiting in all queues */
+    pthread_mutex_t   lock;                      /* Protects the registry and job states */
+    CLI_JobTypeDef   *jobs;                      /* Registry of all jobs */
+    uint32_t          nextId;                    /* Last assigned job id */
+    pthread_once_t    once;                      /* Pool start up */
+
+} CLI_JobsDataTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_JOBS_Private_Variables CLI Jobs Private Variables
+  * @{
+  */
+
+static CLI_JobsDataTypeDef gCliJobs = {
+    .poolLock = PTHREAD_MUTEX_INITIALIZER,
+    .poolCond = PTHREAD_COND_INITIALIZER,
+    .lock     = PTHREAD_MUTEX_INITIALIZER,
+    .once     = PTHREAD_ONCE_INIT,
+};
+
+/* Job run by the calling worker thread, its output is captured. */
+static __thread CLI_JobTypeDef *gCliJobCurrent = NULL;
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_JOBS_Private_Functions CLI Jobs Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Take a job: the oldest from the worker's own queue, or else steal the
+ *  newest from a sibling.
+ */
+
+static CLI_JobTypeDef *CLI_JobsTake(CLI_WorkerTypeDef *self)
+{
+    CLI_WorkerTypeDef *victim;
+    CLI_JobTypeDef    *job = NULL;
+    uint32_t           i;
+
+    for ( i = 0; i < gCliJobs.workersCount && job == NULL; i++ )
+    {
+        victim = &gCliJobs.workers[(self->index + i) % gCliJobs.workersCount];
+
+        pthread_mutex_lock(&victim->lock);
+        if ( victim->queue != NULL )
+        {
+            job = (victim == self) ? victim->queue : victim->queue->qprev;
+            DL_DELETE3(victim->queue, job, qprev, qnext);
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    if ( job != NULL )
+    {
+        pthread_mutex_lock(&gCliJobs.poolLock);
+        gCliJobs.queued--;
+        pthread_mutex_unlock(&gCliJobs.poolLock);
+    }
+
+    return job;
+}
+
+/**
+ * @brief
+ *  Release a job.
+ */
+
+static void CLI_JobFree(CLI_JobTypeDef *job)
+{
+    free(job->out);
+    free(job);
+}
+
+/**
+ * @brief
+ *  Run a job on the calling worker and hand it back to its context.
+ */
+
+static void CLI_JobRun(CLI_JobTypeDef *job)
+{
+    int result;
+
+    pthread_mutex_lock(&gCliJobs.lock);
+    job->state = CLI_Job_Running;
+    pthread_mutex_unlock(&gCliJobs.lock);
+
+    gCliJobCurrent = job;
+    CLI_ArgsSwap(job->hasTyped ? &job->typed : NULL);
+    result = job->pHandler(job->argc, job->argv);
+    CLI_ArgsSwap(NULL);
+    gCliJobCurrent = NULL;
+
+    pthread_mutex_lock(&gCliJobs.lock);
+
+    job->result = result;
+    job->state  = CLI_Job_Done;
+
+    /* Nobody left to report to, otherwise have the context pick it up. */
+    if ( job->ctx == NULL )
+    {
+        DL_DELETE(gCliJobs.jobs, job);
+        CLI_JobFree(job);
+    }
+    else
+        CLI_ContextAlert(job->ctx);
+
+    pthread_mutex_unlock(&gCliJobs.lock);
+}
+
+/**
+ * @brief
+ *  Worker thread.
+ */
+
+static void *CLI_JobsWorker(void *arg)
+{
+    CLI_WorkerTypeDef *self = arg;
+    CLI_JobTypeDef    *job;
+
+    while ( 1 )
+    {
+        job = CLI_JobsTake(self);
+        if ( job != NULL )
+        {
+            CLI_JobRun(job);
+            continue;
+        }
+
+        pthread_mutex_lock(&gCliJobs.poolLock);
+        while ( gCliJobs.queued == 0 )
+            pthread_cond_wait(&gCliJobs.poolCond, &gCliJobs.poolLock);
+        pthread_mutex_unlock(&gCliJobs.poolLock);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief
+ *  Spawn the worker pool.
+ */
+
+static void CLI_JobsStart(void)
+{
+    uint32_t started = 0;
+    uint32_t i;
+
+    /* Queues of workers that failed to start are drained by stealing. */
+    for ( i = 0; i < CLI_JOBS_WORKERS; i++ )
+    {
+        gCliJobs.workers[i].index = i;
+        pthread_mutex_init(&gCliJobs.workers[i].lock, NULL);
+    }
+
+    gCliJobs.workersCount = CLI_JOBS_WORKERS;
+
+    for ( i = 0; i < CLI_JOBS_WORKERS; i++ )
+    {
+        if ( pthread_create(&gCliJobs.workers[i].thread, NULL, CLI_JobsWorker, &gCliJobs.workers[i]) == 0 )
+        {
+            pthread_detach(gCliJobs.workers[i].thread);
+            started++;
+        }
+    }
+
+    if ( started == 0 )
+        gCliJobs.workersCount = 0;
+}
+
+/**
+ * @brief
+ *  Print a job status line, "[id] Status  command line".
+ */
+
+static void CLI_JobPrintStatus(CLI_Context *ctx, const CLI_JobTypeDef *job, const char *status)
+{
+    char   line[CLI_MAX_LINE_LENGTH + 48];
+    size_t len;
+    int    i;
+
+    len = CLI_FmtString(line, sizeof(line), "[%u] %-10s", job->id, status);
+    for ( i = 0; i < job->argc && len < sizeof(line) - 1; i++ )
+        len += CLI_FmtString(line + len, sizeof(line) - len, "%s%s", (i > 0) ? " " : "", job->argv[i]);
+
+    if ( len > sizeof(line) - 1 )
+        len = sizeof(line) - 1; /* Truncated */
+
+    CLI_ContextWrite(ctx, line, len);
+    CLI_ContextWrite(ctx, "\r\n", 2);
+}
+
+/**
+ * @brief
+ *  Print a job output, every line prefixed with the job id when 'tagged'.
+ */
+
+static void CLI_JobPrintOutput(CLI_Context *ctx, const CLI_JobTypeDef *job, bool tagged)
+{
+    const char *line = job->out;
+    const char *end  = job->out + job->outLen;
+    const char *eol;
+    char        tag[16];
+    int         tagLen;
+
+    if ( job->outLen == 0 )
+        return;
+
+    if ( ! tagged )
+    {
+        CLI_ContextWrite(ctx, job->out, job->outLen);
+    }
+    else
+    {
+        tagLen = (int) CLI_FmtString(tag, sizeof(tag), "[%u] ", job->id);
+
+        while ( line < end )
+        {
+            eol = memchr(line, '\n', (size_t) (end - line));
+            if ( eol == NULL )
+                eol = end;
+
+            CLI_ContextWrite(ctx, tag, (size_t) tagLen);
+            CLI_ContextWrite(ctx, line, (size_t) ((eol > line && eol[-1] == '\r') ? eol - line - 1 : eol - line));
+            CLI_ContextWrite(ctx, "\r\n", 2);
+
+            line = eol + 1;
+        }
+    }
+
+    if ( job->truncated )
+        CLI_ContextWrite(ctx, "[output truncated]\r\n", 20);
+}
+
+/**
+ * @brief
+ *  Print a background job that is done.
+ */
+
+static void CLI_JobReport(CLI_Context *ctx, const CLI_JobTypeDef *job)
+{
+    CLI_JobPrintStatus(ctx, job, job->cancel ? "Cancelled" : ((job->result == EXIT_SUCCESS) ? "Done" : "Failed"));
+    CLI_JobPrintOutput(ctx, job, true);
+}
+
+/**
+ * @brief
+ *  Built in: list the jobs of the current context.
+ *  The built ins are listed in cli_jobs.def and have external linkage, as
+ *  CLI_STATIC_TABLE builds refer to them from the generated table.
+ */
+
+int CLI_JobsCmdJobs(int argc, char **argv)
+{
+    CLI_Context    *ctx = CLI_GetCurrentContext();
+    CLI_JobTypeDef *job;
+
+    CLI_SHOW_HELP("List background jobs.");
+
+    pthread_mutex_lock(&gCliJobs.lock);
+    DL_FOREACH(gCliJobs.jobs, job)
+    {
+        if ( job->ctx == ctx )
+            CLI_JobPrintStatus(ctx, job, (job->state == CLI_Job_Done) ? "Done" : ((job->state == CLI_Job_Running) ? "Running" : "Queued"));
+    }
+    pthread_mutex_unlock(&gCliJobs.lock);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief
+ *  Built in: wait for a job, the most recent one by default, and show its
+ *  output.
+ */
+
+int CLI_JobsCmdFg(int argc, char **argv)
+{
+    CLI_Context    *ctx   = CLI_GetCurrentContext();
+    CLI_JobTypeDef *job   = NULL;
+    CLI_JobTypeDef *found = NULL;
+    uint64_t        id    = 0;
+
+    CLI_SHOW_HELP("Bring a job to the foreground: fg [job id].");
+
+    if ( argc > 1 && (CLI_NumParseU64((argv[1][0] == '%') ? argv[1] + 1 : argv[1], CLI_NUM_DEC, &id) != CLI_NUM_OK || id > UINT32_MAX) )
+    {
+        CLI_Printf("fg: no such job\n");
+        return EXIT_FAILURE;
+    }
+
+    pthread_mutex_lock(&gCliJobs.lock);
+    DL_FOREACH(gCliJobs.jobs, job)
+    {
+        if ( job->ctx == ctx && (id == 0 || job->id == id) )
+            found = job;
+    }
+
+    if ( found != NULL )
+        found->background = false;
+    pthread_mutex_unlock(&gCliJobs.lock);
+
+    if ( found == NULL )
+    {
+        CLI_Printf("fg: no such job\n");
+        return EXIT_FAILURE;
+    }
+
+    CLI_ContextWait(ctx, found->id);
+    return CLI_RESET_CMD;
+}
+
+/**
+ * @brief
+ *  Built in: wait for all jobs of the current context.
+ */
+
+int CLI_JobsCmdWait(int argc, char **argv)
+{
+    CLI_Context    *ctx     = CLI_GetCurrentContext();
+    CLI_JobTypeDef *job;
+    bool            pending = false;
+
+    CLI_SHOW_HELP("Wait for all background jobs.");
+
+    pthread_mutex_lock(&gCliJobs.lock);
+    DL_FOREACH(gCliJobs.jobs, job)
+    {
+        if ( job->ctx == ctx )
+            pending = true;
+    }
+    pthread_mutex_unlock(&gCliJobs.lock);
+
+    if ( ! pending )
+        return EXIT_SUCCESS;
+
+    CLI_ContextWait(ctx, 0);
+    return CLI_RESET_CMD;
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_JOBS_Exported_Functions CLI Jobs Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Lets a long running asynchronous handler know the user asked to
+  *         cancel it (Ctrl-C while waiting for it), handlers are expected to
+  *         poll it and return early.
+  * @retval boolean, true if cancellation was requested.
+  */
+
+bool CLI_JobIsCancelled(void)
+{
+    CLI_JobTypeDef *job = gCliJobCurrent;
+
+    return job != NULL && __atomic_load_n(&job->cancel, __ATOMIC_RELAXED);
+}
+
+/**
+  * @brief  Injects the jobs built in commands, the pool itself is started
+  *         with the first job.
+  */
+
+void CLI_JobsInit(void)
+{
+    static const CLI_CmdTypeDef gCliJobsCommands[] = {
+#define CLI_COMMAND(handler, name, flags) { handler, name, flags },
+#include "cli_jobs.def"
+#undef CLI_COMMAND
+    };
+
+    CLI_InjectCommands(gCliJobsCommands, SIZEOF_ITEM(gCliJobsCommands));
+}
+
+/**
+  * @brief  Queue a command for execution on the worker pool.
+  * @param ctx: Context the job reports to.
+  * @param pHandler: Command handler.
+  * @param schema: Arguments schema of the command, NULL for none. The
+  *        arguments were validated against it already.
+  * @param argc: Arguments count.
+  * @param argv: Arguments, copied.
+  * @param background: Report the job asynchronously when done.
+  * @retval Job id, 0 if the job could not be queued.
+  */
+
+uint32_t CLI_JobSubmit(CLI_Context *ctx, int (*pHandler)(int, char **), const CLI_ArgsSchemaTypeDef *schema, int argc, char **argv,
+                       bool background)
+{
+    CLI_WorkerTypeDef *worker;
+    CLI_JobTypeDef    *job;
+    size_t             used = 0;
+    size_t             len;
+    int                i;
+    char               error[CLI_MAX_LINE_LENGTH];
+
+    pthread_once(&gCliJobs.once, CLI_JobsStart);
+    if ( gCliJobs.workersCount == 0 || argc > CLI_MAX_NUM_PARAMS )
+        return 0;
+
+    job = calloc(1, sizeof(CLI_JobTypeDef));
+    if ( job == NULL )
+        return 0;
+
+    for ( i = 0; i < argc; i++ )
+    {
+        len = strlen(argv[i]);
+        if ( used + len + 1 > sizeof(job->args) )
+            break;
+
+        job->argv[i] = memcpy(job->args + used, argv[i], len + 1);
+        used += len + 1;
+    }
+
+    job->argc = i;
+
+    /* Typed again, over the job own copy of the arguments. */
+    if ( schema != NULL )
+    {
+        job->hasTyped = CLI_ArgsParse(schema, job->argc, job->argv, &job->typed, error, sizeof(error));
+        if ( job->hasTyped == false )
+        {
+            CLI_JobFree(job);
+            return 0;
+        }
+    }
+
+    job->ctx        = ctx;
+    job->pHandler   = pHandler;
+    job->background = background;
+
+    pthread_mutex_lock(&gCliJobs.lock);
+    job->id = ++gCliJobs.nextId;
+    DL_APPEND(gCliJobs.jobs, job);
+    pthread_mutex_unlock(&gCliJobs.lock);
+
+    worker = &gCliJobs.workers[__atomic_fetch_add(&gCliJobs.nextWorker, 1, __ATOMIC_RELAXED) % gCliJobs.workersCount];
+
+    /* Counted before any worker can take it, a taker decrements under the
+     * pool lock once we're done. */
+    pthread_mutex_lock(&gCliJobs.poolLock);
+
+    pthread_mutex_lock(&worker->lock);
+    DL_APPEND2(worker->queue, job, qprev, qnext);
+    pthread_mutex_unlock(&worker->lock);
+
+    gCliJobs.queued++;
+    pthread_cond_signal(&gCliJobs.poolCond);
+    pthread_mutex_unlock(&gCliJobs.poolLock);
+
+    return job->id;
+}
+
+/**
+  * @brief  Serve a context waiting for a job ('fg', a foreground asynchronous
+  *         command) or for all of its jobs ('wait').
+  * @param ctx: Waiting context.
+  * @param jobId: Job waited for, 0 for all the jobs of the context.
+  * @param interrupted: The user gave up waiting (Ctrl-C), the waited job is
+  *        asked to cancel and moves to the background.
+  * @retval boolean, true when the wait is over.
+  */
+
+bool CLI_JobsWait(CLI_Context *ctx, uint32_t jobId, bool interrupted)
+{
+    CLI_JobTypeDef *job;
+    CLI_JobTypeDef *tmp;
+    CLI_JobTypeDef *done = NULL;
+    bool            over = true;
+
+    pthread_mutex_lock(&gCliJobs.lock);
+
+    DL_FOREACH_SAFE(gCliJobs.jobs, job, tmp)
+    {
+        if ( job->ctx != ctx || (jobId != 0 && job->id != jobId) )
+            continue;
+
+        if ( interrupted )
+        {
+            if ( jobId != 0 )
+            {
+                __atomic_store_n(&job->cancel, true, __ATOMIC_RELAXED);
+                job->background = true;
+            }
+        }
+        else if ( job->state == CLI_Job_Done )
+        {
+            DL_DELETE(gCliJobs.jobs, job);
+            DL_APPEND(done, job);
+        }
+        else
+            over = false;
+    }
+
+    pthread_mutex_unlock(&gCliJobs.lock);
+
+    if ( interrupted )
+        CLI_ContextWrite(ctx, "^C\r\n", 4);
+
+    DL_FOREACH_SAFE(done, job, tmp)
+    {
+        if ( jobId != 0 )
+            CLI_JobPrintOutput(ctx, job, false);
+        else
+            CLI_JobReport(ctx, job);
+
+        DL_DELETE(done, job);
+        CLI_JobFree(job);
+    }
+
+    return over || interrupted;
+}
+
+/**
+  * @brief  Print the background jobs of a context that are done.
+  * @param ctx: Context.
+  * @retval boolean, true if anything was printed.
+  */
+
+bool CLI_JobsReport(CLI_Context *ctx)
+{
+    CLI_JobTypeDef *job;
+    CLI_JobTypeDef *tmp;
+    CLI_JobTypeDef *done = NULL;
+
+    pthread_mutex_lock(&gCliJobs.lock);
+    DL_FOREACH_SAFE(gCliJobs.jobs, job, tmp)
+    {
+        if ( job->ctx == ctx && job->background && job->state == CLI_Job_Done )
+        {
+            DL_DELETE(gCliJobs.jobs, job);
+            DL_APPEND(done, job);
+        }
+    }
+    pthread_mutex_unlock(&gCliJobs.lock);
+
+    if ( done == NULL )
+        return false;
+
+    CLI_ContextWrite(ctx, "\r\n", 2);
+
+    DL_FOREACH_SAFE(done, job, tmp)
+    {
+        CLI_JobReport(ctx, job);
+        DL_DELETE(done, job);
+        CLI_JobFree(job);
+    }
+
+    return true;
+}
+
+/**
+  * @brief  Forget a context that is going away, its running jobs complete
+  *         silently.
+  * @param ctx: Context.
+  */
+
+void CLI_JobsDetach(CLI_Context *ctx)
+{
+    CLI_JobTypeDef *job;
+    CLI_JobTypeDef *tmp;
+
+    pthread_mutex_lock(&gCliJobs.lock);
+    DL_FOREACH_SAFE(gCliJobs.jobs, job, tmp)
+    {
+        if ( job->ctx != ctx )
+            continue;
+
+        if ( job->state == CLI_Job_Done )
+        {
+            DL_DELETE(gCliJobs.jobs, job);
+            CLI_JobFree(job);
+        }
+        else
+        {
+            job->ctx = NULL;
+            __atomic_store_n(&job->cancel, true, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&gCliJobs.lock);
+}
+
+/**
+  * @brief  Output sink for handlers running as jobs.
+  * @param buf: Bytes to output.
+  * @param len: Count of bytes in 'buf'.
+  * @retval boolean, false if the calling thread does not run a job.
+  */
+
+bool CLI_JobsWrite(const char *buf, size_t len)
+{
+    CLI_JobTypeDef *job = gCliJobCurrent;
+
+    if ( job == NULL )
+        return false;
+
+    if ( len == 0 )
+        return true;
+
+    if ( job->out == NULL )
+        job->out = malloc(CLI_JOB_OUTPUT_SIZE);
+
+    if ( job->out == NULL || job->outLen + len > CLI_JOB_OUTPUT_SIZE )
+    {
+        job->truncated = true;
+        len            = (job->out != NULL) ? CLI_JOB_OUTPUT_SIZE - job->outLen : 0;
+    }
+
+    if ( len > 0 )
+    {
+        memcpy(job->out + job->outLen, buf, len);
+        job->outLen += len;
+    }
+
+    return true;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,428 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_num.c
+  * @brief   Integer formatting and parsing, table driven and SWAR.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_num.h" /* Module local include */
+#include <string.h>
+
+/** @defgroup CLI_NUM CLI Num
+  * @brief CLI integers formatting and parsing module
+  * @{
+  */
+
+/* Private define ------------------------------------------------------------*/
+/** @defgroup CLI_NUM_Private_Define CLI Num Private Define
+  * @{
+  */
+
+/* A byte repeated over a 64 bits word. */
+#define CLI_NUM_BYTES(b) (0x0101010101010101ULL * (uint64_t) (b))
+
+/* Eight ASCII digits in a word, loaded in memory order. */
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CLI_NUM_SWAR 1
+#else
+#define CLI_NUM_SWAR 0
+#endif
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_NUM_Private_Variables CLI Num Private Variables
+  * @{
+  */
+
+/* "00" to "99". */
+static const char gCliNumDec2[200] = {
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899"};
+
+/* "00" to "ff". */
+static const char gCliNumHex2[512] = {
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"
+};
+
+/* 10^0 to 10^19. */
+static const uint64_t gCliNumPow10[20] = {
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_NUM_Private_Functions CLI Num Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Count of decimal digits: log10 estimated from the bit length, then
+ *  corrected by a single compare.
+ */
+
+static inline uint32_t CLI_NumDecDigits(uint64_t value)
+{
+    uint32_t digits = ((uint32_t) (64 - __builtin_clzll(value | 1)) * 1233) >> 12;
+
+    /* 0 is counted as 1, the powers of 10 at stake are even. */
+    return digits + 1 - ((value | 1) < gCliNumPow10[digits]);
+}
+
+/**
+ * @brief
+ *  Per byte high bit set where 'lo' <= byte <= 'hi', bytes below 0x80.
+ */
+
+static inline uint64_t CLI_NumSwarInRange(uint64_t w, uint8_t lo, uint8_t hi)
+{
+    return (w + CLI_NUM_BYTES(0x80 - lo)) & ~(w + CLI_NUM_BYTES(0x7F - hi)) & CLI_NUM_BYTES(0x80);
+}
+
+/**
+ * @brief
+ *  Value of eight decimal digits, 'w' holding them in memory order: pairs,
+ *  then quads, then the whole, each step one multiply.
+ */
+
+static inline uint32_t CLI_NumSwarDec8(uint64_t w)
+{
+    w -= CLI_NUM_BYTES('0');
+    w  = (w * 10) + (w >> 8);
+    w  = (((w & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) + (((w >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+    return (uint32_t) w;
+}
+
+/**
+ * @brief
+ *  Value of eight hexadecimal digits (any case), 'w' holding them in memory
+ *  order. Return false if any is not one.
+ */
+
+static inline bool CLI_NumSwarHex8(uint64_t w, uint32_t *value)
+{
+    uint64_t lower = w | CLI_NUM_BYTES(0x20);
+
+    if ( (w & CLI_NUM_BYTES(0x80)) != 0 ||
+         (CLI_NumSwarInRange(w, '0', '9') | CLI_NumSwarInRange(lower, 'a', 'f')) != CLI_NUM_BYTES(0x80) )
+        return false;
+
+    /* Nibbles, letters are 0x6? once lower cased. */
+    w = (lower & CLI_NUM_BYTES(0x0F)) + 9 * ((lower >> 6) & CLI_NUM_BYTES(0x01));
+
+    /* Bytes, 16 bits, then 32 bits lanes, the first digit the most significant. */
+    w = ((w << 4) | (w >> 8)) & 0x00FF00FF00FF00FFULL;
+    w = ((w << 8) | (w >> 16)) & 0x0000FFFF0000FFFFULL;
+    w = ((w << 16) | (w >> 32)) & 0x00000000FFFFFFFFULL;
+
+    *value = (uint32_t) w;
+    return true;
+}
+
+/**
+ * @brief
+ *  Parse 'len' digits of 'base' (2, 10 or 16), eight at a time while they
+ *  last. Malformed digits are reported ahead of an overflow.
+ */
+
+static CLI_NumStatusTypeDef CLI_NumDigits(const char *text, size_t len, uint32_t base, uint64_t *value)
+{
+    const uint32_t bits     = (base == 16) ? 4 : 1;
+    bool           overflow = false;
+    uint64_t       v        = 0;
+    uint64_t       w;
+    uint32_t       chunk;
+    uint32_t       digit;
+    size_t         i        = 0;
+    unsigned char  c;
+
+    if ( len == 0 )
+        return CLI_NUM_INVALID;
+
+#if CLI_NUM_SWAR
+    for ( ; i + 8 <= len; i += 8 )
+    {
+        memcpy(&w, text + i, sizeof(w));
+
+        if ( base == 10 )
+        {
+            if ( ((w & CLI_NUM_BYTES(0xF0)) | (((w + CLI_NUM_BYTES(0x06)) & CLI_NUM_BYTES(0xF0)) >> 4)) != CLI_NUM_BYTES(0x33) )
+                return CLI_NUM_INVALID;
+            chunk     = CLI_NumSwarDec8(w);
+            overflow |= __builtin_mul_overflow(v, 100000000ULL, &v) | __builtin_add_overflow(v, chunk, &v);
+        }
+        else if ( base == 16 )
+        {
+            if ( ! CLI_NumSwarHex8(w, &chunk) )
+                return CLI_NUM_INVALID;
+            overflow |= (v >> 32) != 0;
+            v         = (v << 32) | chunk;
+        }
+        else
+        {
+            /* '0' or '1' bytes, their low bits gathered in the top byte. */
+            if ( (w & CLI_NUM_BYTES(0xFE)) != CLI_NUM_BYTES(0x30) )
+                return CLI_NUM_INVALID;
+            chunk     = (uint32_t) (((w & CLI_NUM_BYTES(0x01)) * 0x8040201008040201ULL) >> 56);
+            overflow |= (v >> 56) != 0;
+            v         = (v << 8) | chunk;
+        }
+    }
+#endif
+
+    for ( ; i < len; i++ )
+    {
+        c = (unsigned char) text[i];
+
+        if ( c >= '0' && c <= '9' )
+            digit = c - '0';
+        else if ( base == 16 && (c | 0x20) >= 'a' && (c | 0x20) <= 'f' )
+            digit = (c | 0x20) - 'a' + 10;
+        else
+            return CLI_NUM_INVALID;
+
+        if ( digit >= base )
+            return CLI_NUM_INVALID;
+
+        if ( base == 10 )
+            overflow |= __builtin_mul_overflow(v, 10, &v) | __builtin_add_overflow(v, digit, &v);
+        else
+        {
+            overflow |= (v >> (64 - bits)) != 0;
+            v         = (v << bits) | digit;
+        }
+    }
+
+    *value = v;
+    return overflow ? CLI_NUM_OVERFLOW : CLI_NUM_OK;
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_NUM_Exported_Functions CLI Num Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Write an unsigned integer in decimal.
+  * @param value: The integer.
+  * @param buf: Out, NULL terminated digits, room for CLI_NUM_DEC_SIZE bytes.
+  * @retval Count of digits.
+  */
+
+size_t CLI_NumFormatU64(uint64_t value, char *buf)
+{
+    uint32_t len = CLI_NumDecDigits(value);
+    char    *p   = buf + len;
+
+    *p = '\0';
+
+    while ( value >= 100 )
+    {
+        p -= 2;
+        memcpy(p, &gCliNumDec2[(value % 100) * 2], 2);
+        value /= 100;
+    }
+
+    if ( value >= 10 )
+        memcpy(p - 2, &gCliNumDec2[value * 2], 2);
+    else
+        p[-1] = (char) ('0' + value);
+
+    return len;
+}
+
+/**
+  * @brief  Write a signed integer in decimal.
+  * @param value: The integer.
+  * @param buf: Out, NULL terminated text, room for CLI_NUM_DEC_SIZE bytes.
+  * @retval Length of the text.
+  */
+
+size_t CLI_NumFormatI64(int64_t value, char *buf)
+{
+    if ( value >= 0 )
+        return CLI_NumFormatU64((uint64_t) value, buf);
+
+    buf[0] = '-';
+    return 1 + CLI_NumFormatU64(0 - (uint64_t) value, buf + 1);
+}
+
+/**
+  * @brief  Write an unsigned integer in hexadecimal, without prefix.
+  * @param value: The integer.
+  * @param buf: Out, NULL terminated digits, room for CLI_NUM_HEX_SIZE bytes.
+  * @param upper: Upper case letters.
+  * @retval Count of digits.
+  */
+
+size_t CLI_NumFormatHex(uint64_t value, char *buf, bool upper)
+{
+    uint32_t len  = (uint32_t) (64 - __builtin_clzll(value | 1) + 3) / 4;
+    char    *p    = buf + len;
+    uint32_t i;
+
+    *p = '\0';
+
+    while ( value > 0xFF )
+    {
+        p -= 2;
+        memcpy(p, &gCliNumHex2[(value & 0xFF) * 2], 2);
+        value >>= 8;
+    }
+
+    if ( value > 0xF )
+        memcpy(p - 2, &gCliNumHex2[value * 2], 2);
+    else
+        p[-1] = gCliNumHex2[value * 2 + 1];
+
+    /* Letters are the only digits with 0x40 set. */
+    for ( i = 0; upper && i < len; i++ )
+        buf[i] &= (char) ~((buf[i] & 0x40) >> 1);
+
+    return len;
+}
+
+/**
+  * @brief  Parse an unsigned integer.
+  * @param text: NULL terminated text, nothing but the number.
+  * @param flags: Notations accepted, CLI_NUM_DEC, CLI_NUM_HEX, ...
+  * @param value: Out, the integer, untouched unless CLI_NUM_OK.
+  * @retval CLI_NUM_OK, or why the text is not a 64 bits integer.
+  */
+
+CLI_NumStatusTypeDef CLI_NumParseU64(const char *text, uint32_t flags, uint64_t *value)
+{
+    CLI_NumStatusTypeDef status;
+    size_t               len   = strlen(text);
+    uint32_t             shift = 0;
+    uint64_t             v;
+
+    if ( text[0] == '0' && (text[1] | 0x20) == 'x' && (flags & (CLI_NUM_HEX | CLI_NUM_HEX_BARE)) )
+        status = CLI_NumDigits(text + 2, len - 2, 16, &v);
+    else if ( flags & CLI_NUM_HEX_BARE )
+        status = CLI_NumDigits(text, len, 16, &v);
+    else if ( text[0] == '0' && (text[1] | 0x20) == 'b' && (flags & CLI_NUM_BIN) )
+        status = CLI_NumDigits(text + 2, len - 2, 2, &v);
+    else if ( flags & (CLI_NUM_DEC | CLI_NUM_SIZE) )
+    {
+        if ( (flags & CLI_NUM_SIZE) && len > 1 )
+        {
+            switch ( text[len - 1] | 0x20 )
+            {
+                case 'k': shift = 10; break;
+                case 'm': shift = 20; break;
+                case 'g': shift = 30; break;
+                case 't': shift = 40; break;
+                default: break;
+            }
+        }
+
+        status = CLI_NumDigits(text, (shift != 0) ? len - 1 : len, 10, &v);
+        if ( status == CLI_NUM_OK && shift != 0 )
+        {
+            if ( (v >> (64 - shift)) != 0 )
+                status = CLI_NUM_OVERFLOW;
+            v <<= shift;
+        }
+    }
+    else
+        status = CLI_NUM_INVALID;
+
+    if ( status == CLI_NUM_OK )
+        *value = v;
+
+    return status;
+}
+
+/**
+  * @brief  Parse a signed integer, '-' or '+' signed.
+  * @param text: NULL terminated text, nothing but the number.
+  * @param flags: Notations accepted, CLI_NUM_DEC, CLI_NUM_HEX, ...
+  * @param value: Out, the integer, untouched unless CLI_NUM_OK.
+  * @retval CLI_NUM_OK, or why the text is not a 64 bits integer.
+  */
+
+CLI_NumStatusTypeDef CLI_NumParseI64(const char *text, uint32_t flags, int64_t *value)
+{
+    CLI_NumStatusTypeDef status;
+    bool                 negative = (text[0] == '-');
+    uint64_t             magnitude;
+
+    if ( text[0] == '-' || text[0] == '+' )
+        text++;
+
+    status = CLI_NumParseU64(text, flags, &magnitude);
+    if ( status != CLI_NUM_OK )
+        return status;
+
+    if ( magnitude > (uint64_t) INT64_MAX + negative )
+        return CLI_NUM_OVERFLOW;
+
+    *value = negative ? (int64_t) (0 - magnitude) : (int64_t) magnitude;
+    return CLI_NUM_OK;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
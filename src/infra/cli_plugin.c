@@ -0,0 +1,553 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_plugin.c
+  * @brief   CLI plugins, command modules loaded on first use.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_plugin.h" /* Module local include */
+#include <ctype.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "cli_args.h" /* Typed command arguments */
+#include "cli_fmt.h"  /* Formatted output */
+#include "cli_num.h"  /* Integers formatting and parsing */
+#include "llist.h"    /* Basic lists manipulation */
+
+/** @defgroup CLI_PLUGIN CLI Plugin
+  * @brief CLI plugins module
+  * @{
+  */
+
+/* Private define ------------------------------------------------------------*/
+/** @defgroup CLI_PLUGIN_Private_Define CLI Plugin Private Define
+  * @{
+  */
+
+#define CLI_PLUGIN_MAX_LINE   512
+#define CLI_PLUGIN_MAX_SYMBOL 128
+#define CLI_PLUGIN_MAX_ERROR  160
+
+/**
+  * @}
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup CLI_PLUGIN_Private_Typedef CLI Plugin Private Typedef
+  * @{
+  */
+
+/**
+  * @brief  A registered plugin.
+  */
+typedef struct __CLI_PluginTypeDef
+{
+    char                        path[PATH_MAX];                  /* Shared object */
+    void                       *handle;                          /* dlopen() handle, NULL until loaded */
+    CLI_CmdTypeDef             *stubs;                           /* Injected until loaded, freed then */
+    CLI_CmdTypeDef             *cmnds;                           /* Resolved commands, injected once loaded */
+    char                      (*symbols)[CLI_PLUGIN_MAX_SYMBOL]; /* Handlers symbols, freed once loaded */
+    char                      (*schemas)[CLI_PLUGIN_MAX_SYMBOL]; /* Arguments schemas symbols (empty for none), freed once loaded */
+    char                      (*names)[CLI_PLUGIN_MAX_SYMBOL];   /* Commands paths, kept along with the commands */
+    uint32_t                    count;                           /* Commands count */
+    char                        error[CLI_PLUGIN_MAX_ERROR];     /* Last loading error */
+    struct __CLI_PluginTypeDef *next;                            /* Plugins list */
+
+} CLI_PluginTypeDef;
+
+/**
+  * @brief  The module locals.
+  */
+typedef struct __CLI_PluginsDataTypeDef
+{
+    CLI_PluginTypeDef *plugins; /* Registered plugins */
+    pthread_mutex_t    lock;    /* Protects the plugins and serializes loading */
+
+} CLI_PluginsDataTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_PLUGIN_Private_Variables CLI Plugin Private Variables
+  * @{
+  */
+
+static CLI_PluginsDataTypeDef gCliPlugins = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_PLUGIN_Private_Functions CLI Plugin Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Copy 'len' bytes into a NULL terminated, bounded buffer, trimming white
+ *  spaces on both ends. Return false if it did not fit or ended up empty.
+ */
+
+static bool CLI_PluginCopy(char *dst, size_t size, const char *src, size_t len)
+{
+    while ( len > 0 && isspace((unsigned char) *src) )
+    {
+        src++;
+        len--;
+    }
+
+    while ( len > 0 && isspace((unsigned char) src[len - 1]) )
+        len--;
+
+    if ( len == 0 || len >= size )
+        return false;
+
+    memcpy(dst, src, len);
+    dst[len] = 0;
+    return true;
+}
+
+/**
+ * @brief
+ *  Evaluate a manifest flags expression: numbers and CLI_CMD_FLAG_xxx names
+ *  joined with '|'. Return false if it holds anything else.
+ */
+
+static bool CLI_PluginFlags(const char *expr, uint32_t *flags)
+{
+    char        token[CLI_PLUGIN_MAX_SYMBOL];
+    const char *end;
+    uint64_t    value;
+
+    *flags = 0;
+
+    while ( *expr )
+    {
+        end = strchr(expr, '|');
+        if ( end == NULL )
+            end = expr + strlen(expr);
+
+        if ( ! CLI_PluginCopy(token, sizeof(token), expr, (size_t) (end - expr)) )
+            return false;
+
+        if ( strcmp(token, "CLI_CMD_FLAG_ASYNC") == 0 )
+            *flags |= CLI_CMD_FLAG_ASYNC;
+        else
+        {
+            if ( CLI_NumParseU64(token, CLI_NUM_DEC | CLI_NUM_HEX, &value) != CLI_NUM_OK || value > UINT32_MAX )
+                return false;
+            *flags |= (uint32_t) value;
+        }
+
+        expr = (*end != 0) ? end + 1 : end;
+    }
+
+    return true;
+}
+
+/**
+ * @brief
+ *  Parse one 'CLI_COMMAND(handler, "name", flags)' or
+ *  'CLI_COMMAND_ARGS(handler, "name", flags, schema)' manifest line into a
+ *  stub, its name is written to 'name' and its schema symbol, if any, to
+ *  'schema'.
+ *  Return 1 when a command was parsed, 0 for a line without one and -1 for a
+ *  malformed declaration.
+ */
+
+static int CLI_PluginParseLine(const char *line, CLI_CmdTypeDef *stub, char *symbol, char *name, char *schema)
+{
+    const char *p        = line;
+    const char *end;
+    const char *comma;
+    char        flags[CLI_PLUGIN_MAX_SYMBOL];
+    size_t      i;
+    size_t      len      = 0;
+    bool        withArgs = false;
+
+    while ( *p == ' ' || *p == '\t' )
+        p++;
+
+    if ( strncmp(p, "CLI_COMMAND_ARGS(", 17) == 0 )
+    {
+        p        = p + 17;
+        withArgs = true;
+    }
+    else if ( strncmp(p, "CLI_COMMAND(", 12) == 0 )
+        p = p + 12;
+    else
+        return 0;
+
+    /* Handler */
+    end = strchr(p, ',');
+    if ( end == NULL || ! CLI_PluginCopy(symbol, CLI_PLUGIN_MAX_SYMBOL, p, (size_t) (end - p)) )
+        return -1;
+
+    /* Quoted path, normalized the way CLI_BuildTable() does: lower case
+     * words separated by single spaces. */
+    p = strchr(end + 1, '"');
+    if ( p == NULL || (end = strchr(++p, '"')) == NULL )
+        return -1;
+
+    if ( ! CLI_PluginCopy(name, CLI_PLUGIN_MAX_SYMBOL, p, (size_t) (end - p)) )
+        return -1;
+
+    for ( i = 0; name[i] != 0; i++ )
+    {
+        if ( isspace((unsigned char) name[i]) )
+        {
+            if ( ! isspace((unsigned char) name[i + 1]) )
+                name[len++] = ' ';
+        }
+        else
+            name[len++] = (char) tolower((unsigned char) name[i]);
+    }
+    name[len] = 0;
+
+    /* Flags expression, up to the closing parenthesis. */
+    p = end + 1;
+    while ( *p == ' ' || *p == '\t' )
+        p++;
+
+    if ( *p++ != ',' || (end = strrchr(p, ')')) == NULL )
+        return -1;
+
+    /* The schema symbol follows the last comma. */
+    schema[0] = 0;
+    if ( withArgs )
+    {
+        comma = strrchr(p, ',');
+        if ( comma == NULL || comma > end || ! CLI_PluginCopy(schema, CLI_PLUGIN_MAX_SYMBOL, comma + 1, (size_t) (end - comma - 1)) )
+            return -1;
+        end = comma;
+    }
+
+    if ( ! CLI_PluginCopy(flags, sizeof(flags), p, (size_t) (end - p)) || ! CLI_PluginFlags(flags, &stub->flags) )
+        return -1;
+
+    return 1;
+}
+
+/**
+ * @brief
+ *  Find the plugin declaring a command, lock held.
+ */
+
+static CLI_PluginTypeDef *CLI_PluginFind(const char *name, uint32_t *index)
+{
+    CLI_PluginTypeDef    *plugin;
+    const CLI_CmdTypeDef *cmnds;
+    uint32_t              i;
+
+    LL_FOREACH(gCliPlugins.plugins, plugin)
+    {
+        cmnds = (plugin->handle != NULL) ? plugin->cmnds : plugin->stubs;
+
+        for ( i = 0; i < plugin->count; i++ )
+        {
+            if ( strcasecmp(cmnds[i].Name, name) == 0 )
+            {
+                *index = i;
+                return plugin;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief
+ *  Open a plugin and have its real handlers replace the stubs, lock held.
+ */
+
+static bool CLI_PluginOpen(CLI_PluginTypeDef *plugin)
+{
+    void    *handle;
+    uint32_t i;
+
+    if ( plugin->handle != NULL )
+        return true;
+
+    handle = dlopen(plugin->path, RTLD_NOW | RTLD_LOCAL);
+    if ( handle == NULL )
+    {
+        CLI_FmtString(plugin->error, sizeof(plugin->error), "%s", dlerror());
+        return false;
+    }
+
+    for ( i = 0; i < plugin->count; i++ )
+    {
+        *(void **) &plugin->cmnds[i].pHandler = dlsym(handle, plugin->symbols[i]);
+        if ( plugin->cmnds[i].pHandler == NULL )
+        {
+            CLI_FmtString(plugin->error, sizeof(plugin->error), "undefined handler '%s'", plugin->symbols[i]);
+            dlclose(handle);
+            return false;
+        }
+
+        plugin->cmnds[i].args = NULL;
+        if ( plugin->schemas[i][0] != 0 && (plugin->cmnds[i].args = dlsym(handle, plugin->schemas[i])) == NULL )
+        {
+            CLI_FmtString(plugin->error, sizeof(plugin->error), "undefined arguments schema '%s'", plugin->schemas[i]);
+            dlclose(handle);
+            return false;
+        }
+
+        plugin->cmnds[i].Name  = plugin->names[i];
+        plugin->cmnds[i].flags = plugin->stubs[i].flags & ~CLI_CMD_FLAG_LAZY;
+    }
+
+    /* Sessions keep using the stubs until they are done with the current table. */
+    if ( CLI_ReplaceCommands(plugin->stubs, plugin->cmnds, (int) plugin->count) == 0 )
+    {
+        CLI_FmtString(plugin->error, sizeof(plugin->error), "commands table update failed");
+        dlclose(handle);
+        return false;
+    }
+
+    plugin->handle = handle;
+
+    free(plugin->stubs);
+    free(plugin->symbols);
+    free(plugin->schemas);
+    plugin->stubs   = NULL;
+    plugin->symbols = NULL;
+    plugin->schemas = NULL;
+
+    return true;
+}
+
+/**
+ * @brief
+ *  Handler injected for every plugin command until its plugin is loaded. The
+ *  engine loads the plugin and dispatches through the real command instead,
+ *  so it only runs when that failed: try again and tell why. The command is
+ *  identified by its path, argv[0].
+ */
+
+static int CLI_PluginStub(int argc, char **argv)
+{
+    CLI_PluginTypeDef *plugin;
+    uint32_t           index = 0;
+
+    CLI_SHOW_HELP("Plugin command, loaded on first use.");
+
+    pthread_mutex_lock(&gCliPlugins.lock);
+
+    plugin = CLI_PluginFind(argv[0], &index);
+    if ( plugin == NULL )
+        CLI_Printf("%s: no plugin declares it", argv[0]);
+    else if ( ! CLI_PluginOpen(plugin) )
+        CLI_Printf("%s: plugin not loaded, %s", argv[0], plugin->error);
+    else
+        CLI_Printf("%s: plugin loaded, run it again", argv[0]);
+
+    pthread_mutex_unlock(&gCliPlugins.lock);
+
+    return EXIT_FAILURE;
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_PLUGIN_Exported_Functions CLI Plugin Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Register a plugin from its manifest: its commands are injected as
+  *         stubs, the shared object next to the manifest is not opened yet.
+  * @param manifest: Manifest path, 'name.def' for the plugin 'name.so'.
+  * @retval boolean, true if the plugin was registered.
+  */
+
+bool CLI_PluginRegister(const char *manifest)
+{
+    CLI_PluginTypeDef *plugin;
+    FILE              *file;
+    char               line[CLI_PLUGIN_MAX_LINE];
+    CLI_CmdTypeDef     stub;
+    char               symbol[CLI_PLUGIN_MAX_SYMBOL];
+    char               name[CLI_PLUGIN_MAX_SYMBOL];
+    char               schema[CLI_PLUGIN_MAX_SYMBOL];
+    uint32_t           allocated = 0;
+    uint32_t           i;
+    size_t             len;
+    void              *grown;
+    int                parsed    = 0;
+
+    len = strlen(manifest);
+    if ( len <= strlen(CLI_PLUGIN_MANIFEST_EXT) || len >= PATH_MAX - strlen(CLI_PLUGIN_MODULE_EXT) )
+        return false;
+
+    plugin = calloc(1, sizeof(CLI_PluginTypeDef));
+    if ( plugin == NULL )
+        return false;
+
+    /* The shared object sits next to its manifest. */
+    len -= strlen(CLI_PLUGIN_MANIFEST_EXT);
+    memcpy(plugin->path, manifest, len);
+    strcpy(plugin->path + len, CLI_PLUGIN_MODULE_EXT);
+
+    file = fopen(manifest, "r");
+    while ( file != NULL && fgets(line, sizeof(line), file) != NULL )
+    {
+        memset(&stub, 0, sizeof(stub));
+        parsed = CLI_PluginParseLine(line, &stub, symbol, name, schema);
+        if ( parsed < 0 )
+            break;
+        if ( parsed == 0 )
+            continue;
+
+        if ( plugin->count == allocated )
+        {
+            allocated = allocated ? allocated * 2 : 16;
+
+            grown = realloc(plugin->stubs, allocated * sizeof(CLI_CmdTypeDef));
+            if ( grown != NULL )
+                plugin->stubs = grown;
+
+            grown = (grown != NULL) ? realloc(plugin->symbols, allocated * sizeof(*plugin->symbols)) : NULL;
+            if ( grown != NULL )
+                plugin->symbols = grown;
+
+            grown = (grown != NULL) ? realloc(plugin->names, allocated * sizeof(*plugin->names)) : NULL;
+            if ( grown != NULL )
+                plugin->names = grown;
+
+            grown = (grown != NULL) ? realloc(plugin->schemas, allocated * sizeof(*plugin->schemas)) : NULL;
+            if ( grown == NULL )
+            {
+                parsed = -1; /* No memory */
+                break;
+            }
+            plugin->schemas = grown;
+        }
+
+        stub.pHandler  = CLI_PluginStub;
+        stub.flags    |= CLI_CMD_FLAG_LAZY;
+
+        plugin->stubs[plugin->count] = stub;
+        strcpy(plugin->symbols[plugin->count], symbol);
+        strcpy(plugin->names[plugin->count], name);
+        strcpy(plugin->schemas[plugin->count], schema);
+        plugin->count++;
+    }
+
+    /* Names are settled, the stubs may now point to them. */
+    for ( i = 0; i < plugin->count; i++ )
+        plugin->stubs[i].Name = plugin->names[i];
+
+    if ( file != NULL )
+        fclose(file);
+
+    if ( file != NULL && parsed >= 0 && plugin->count > 0 && (plugin->cmnds = calloc(plugin->count, sizeof(CLI_CmdTypeDef))) != NULL )
+    {
+        pthread_mutex_lock(&gCliPlugins.lock);
+        if ( CLI_InjectCommands(plugin->stubs, (int) plugin->count) > 0 )
+        {
+            LL_APPEND(gCliPlugins.plugins, plugin);
+            plugin = NULL;
+        }
+        pthread_mutex_unlock(&gCliPlugins.lock);
+    }
+
+    if ( plugin == NULL )
+        return true;
+
+    free(plugin->stubs);
+    free(plugin->symbols);
+    free(plugin->schemas);
+    free(plugin->names);
+    free(plugin->cmnds);
+    free(plugin);
+
+    return false;
+}
+
+/**
+  * @brief  Register every plugin of a directory, see CLI_PluginRegister().
+  * @param dir: Directory holding the manifests and shared objects.
+  * @retval Count of registered plugins.
+  */
+
+uint32_t CLI_PluginScan(const char *dir)
+{
+    DIR           *handle;
+    struct dirent *entry;
+    char           path[PATH_MAX];
+    size_t         len;
+    size_t         extLen     = strlen(CLI_PLUGIN_MANIFEST_EXT);
+    uint32_t       registered = 0;
+
+    handle = opendir(dir);
+    if ( handle == NULL )
+        return 0;
+
+    while ( (entry = readdir(handle)) != NULL )
+    {
+        len = strlen(entry->d_name);
+        if ( len <= extLen || strcmp(entry->d_name + len - extLen, CLI_PLUGIN_MANIFEST_EXT) != 0 )
+            continue;
+
+        if ( CLI_FmtString(path, sizeof(path), "%s/%s", dir, entry->d_name) >= sizeof(path) )
+            continue;
+
+        if ( CLI_PluginRegister(path) )
+            registered++;
+    }
+
+    closedir(handle);
+    return registered;
+}
+
+/**
+  * @brief  Load the plugin declaring a command, if not loaded yet. The engine
+  *         calls it when a command flagged CLI_CMD_FLAG_LAZY is completed or
+  *         invoked, the real commands are published once it returns.
+  * @param name: Command path.
+  * @retval boolean, true if the plugin is loaded.
+  */
+
+bool CLI_PluginLoad(const char *name)
+{
+    CLI_PluginTypeDef *plugin;
+    uint32_t           index;
+    bool               loaded = false;
+
+    pthread_mutex_lock(&gCliPlugins.lock);
+
+    plugin = CLI_PluginFind(name, &index);
+    if ( plugin != NULL )
+        loaded = CLI_PluginOpen(plugin);
+
+    pthread_mutex_unlock(&gCliPlugins.lock);
+
+    return loaded;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,721 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_server.c
+  * @brief   CLI console server, many sessions served by a single thread.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_server.h" /* Module local include */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "cli_telnet.h" /* Telnet protocol filter */
+#include "llist.h"      /* Basic lists manipulation */
+
+/** @defgroup CLI_SERVER CLI Server
+  * @brief CLI console server module
+  * @{
+  */
+
+/* Private define ------------------------------------------------------------*/
+/** @defgroup CLI_SERVER_Private_define CLI Server Private Define
+  * @{
+  */
+
+#define CLI_SERVER_MAX_EVENTS 64 /* Events fetched by a single epoll_wait() */
+#define CLI_SERVER_BACKLOG    16 /* Pending connections queue length */
+#define CLI_SERVER_PATH_SIZE  sizeof(((struct sockaddr_un *) 0)->sun_path)
+
+/**
+  * @}
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup CLI_SERVER_Private_Typedef CLI Server Private Typedef
+  * @{
+  */
+
+/**
+  * @brief  A single connected session (list node).
+  */
+typedef struct __CLI_SessionTypeDef
+{
+    CLI_IoTypeDef                io;                           /* Socket backend */
+    CLI_Context                 *ctx;                          /* Session CLI context */
+    unsigned char                rx[CLI_SERVER_RX_BATCH_SIZE]; /* Receive buffer */
+    size_t                       rxLen;                        /* Bytes in the receive buffer */
+    size_t                       rxPos;                        /* Bytes of the receive buffer already fed */
+    bool                         paused;                       /* Not reading, the context input queue is full */
+    uint32_t                     events;                       /* Events the socket is watched for */
+    bool                         lastCr;                       /* Last received byte was a carriage return */
+    bool                         isTelnet;                     /* Connection came through the telnet listener */
+    CLI_TelnetTypeDef            telnet;                       /* Telnet protocol state */
+    bool                         ready;                        /* Queued on the ready list */
+    struct __CLI_SessionTypeDef *readyNext;                    /* Sessions alerted for state processing */
+    bool                         closing;                      /* Ended, freed once the current events batch is served */
+    struct __CLI_SessionTypeDef *closeNext;                    /* Sessions to close after the events batch */
+    struct __CLI_SessionTypeDef *prev;                         /* Sessions list */
+    struct __CLI_SessionTypeDef *next;                         /* Sessions list */
+
+} CLI_SessionTypeDef;
+
+/**
+  * @brief  The server locals.
+  */
+typedef struct __CLI_ServerDataTypeDef
+{
+    CLI_ServerConfigTypeDef config;                     /* Configuration provided when started */
+    char                    path[CLI_SERVER_PATH_SIZE]; /* Unix socket path */
+    pthread_t               thread;                     /* Server thread */
+    int                     epollFd;                    /* The one epoll instance */
+    int                     listenFd;                   /* Unix socket listener */
+    int                     tcpFd;                      /* Telnet listener */
+    int                     stopFd;                     /* eventfd used to stop the server */
+    int                     wakeFd;                     /* eventfd kicked when sessions are alerted */
+    pthread_mutex_t         readyLock;                  /* Protects 'ready' and the sessions 'ready' flag */
+    CLI_SessionTypeDef     *ready;                      /* Sessions alerted for state processing */
+    CLI_SessionTypeDef     *sessions;                   /* Connected sessions */
+    CLI_SessionTypeDef     *closing;                    /* Ended sessions, closed after the events batch */
+    uint32_t                sessionCount;               /* Count of connected sessions */
+    bool                    running;                    /* Server thread is up */
+
+} CLI_ServerDataTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_SERVER_Private_Variables CLI Server Private Variables
+  * @{
+  */
+
+static CLI_ServerDataTypeDef gCliServer = {
+    .epollFd   = -1,
+    .listenFd  = -1,
+    .tcpFd     = -1,
+    .stopFd    = -1,
+    .wakeFd    = -1,
+    .readyLock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_SERVER_Private_Functions CLI Server Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Register a descriptor with the server epoll instance.
+ */
+
+static bool CLI_ServerWatch(int fd, void *tag)
+{
+    struct epoll_event ev = {0};
+
+    ev.events   = EPOLLIN;
+    ev.data.ptr = tag;
+
+    return epoll_ctl(gCliServer.epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+/**
+ * @brief
+ *  Terminals send CR on enter, scripts send LF or CR LF. Fold all of them
+ *  into the single CR the engine expects.
+ * @retval New length of the buffer.
+ */
+
+static size_t CLI_ServerFoldLineEnds(CLI_SessionTypeDef *session, unsigned char *buf, size_t len)
+{
+    size_t in;
+    size_t out = 0;
+
+    for ( in = 0; in < len; in++ )
+    {
+        if ( buf[in] == '\n' )
+        {
+            if ( ! session->lastCr )
+                buf[out++] = '\r';
+            session->lastCr = false;
+            continue;
+        }
+
+        session->lastCr = (buf[in] == '\r');
+        buf[out++]      = buf[in];
+    }
+
+    return out;
+}
+
+/**
+ * @brief
+ *  Drop a session and release everything it holds.
+ */
+
+static void CLI_ServerCloseSession(CLI_SessionTypeDef *session)
+{
+    epoll_ctl(gCliServer.epollFd, EPOLL_CTL_DEL, session->io.inFd, NULL);
+    DL_DELETE(gCliServer.sessions, session);
+    __atomic_sub_fetch(&gCliServer.sessionCount, 1, __ATOMIC_RELAXED);
+
+    /* No alerts once the context is gone, drop a pending one. */
+    CLI_ContextDestroy(session->ctx);
+
+    pthread_mutex_lock(&gCliServer.readyLock);
+    if ( session->ready )
+        LL_DELETE2(gCliServer.ready, session, readyNext);
+    pthread_mutex_unlock(&gCliServer.readyLock);
+
+    CLI_IoClose(&session->io);
+    free(session);
+}
+
+/**
+ * @brief
+ *  Close a session once the events batch being served is done with it: a
+ *  later event of the same batch may still point to it.
+ */
+
+static void CLI_ServerEndSession(CLI_SessionTypeDef *session)
+{
+    if ( session->closing )
+        return;
+
+    session->closing = true;
+    LL_PREPEND2(gCliServer.closing, session, closeNext);
+}
+
+/**
+ * @brief
+ *  Close the sessions ended while serving the last events batch.
+ */
+
+static void CLI_ServerCloseEnded(void)
+{
+    CLI_SessionTypeDef *session;
+
+    while ( gCliServer.closing != NULL )
+    {
+        session            = gCliServer.closing;
+        gCliServer.closing = session->closeNext;
+        CLI_ServerCloseSession(session);
+    }
+}
+
+/**
+ * @brief
+ *  Session context alert, may be called from any thread (jobs workers):
+ *  queue the session and wake the server thread up to serve it.
+ */
+
+static void CLI_ServerAlert(CLI_Context *ctx, void *arg)
+{
+    CLI_SessionTypeDef *session = arg;
+    uint64_t            one     = 1;
+
+    pthread_mutex_lock(&gCliServer.readyLock);
+    if ( ! session->ready )
+    {
+        session->ready = true;
+        LL_PREPEND2(gCliServer.ready, session, readyNext);
+    }
+    pthread_mutex_unlock(&gCliServer.readyLock);
+
+    if ( write(gCliServer.wakeFd, &one, sizeof(one)) < 0 )
+    {
+        /* EAGAIN: the counter is saturated, the server is bound to wake up anyway. */
+    }
+}
+
+/**
+ * @brief
+ *  Watch the session socket for input unless paused, and for room while the
+ *  context holds output the socket did not take.
+ */
+
+static void CLI_ServerArm(CLI_SessionTypeDef *session)
+{
+    struct epoll_event ev = {0};
+
+    ev.events   = (session->paused ? 0 : EPOLLIN) | (CLI_ContextOutPending(session->ctx) ? EPOLLOUT : 0);
+    ev.data.ptr = session;
+
+    if ( ev.events != session->events )
+    {
+        epoll_ctl(gCliServer.epollFd, EPOLL_CTL_MOD, session->io.inFd, &ev);
+        session->events = ev.events;
+    }
+}
+
+/**
+ * @brief
+ *  Feed the received bytes to the session context. Reading is paused while
+ *  the context can't take more input, it resumes once the rest is fed.
+ */
+
+static void CLI_ServerFeed(CLI_SessionTypeDef *session)
+{
+    session->rxPos += CLI_ContextProcessBytes(session->ctx, session->rx + session->rxPos, session->rxLen - session->rxPos);
+    session->paused = session->rxPos < session->rxLen;
+    CLI_ServerArm(session);
+}
+
+/**
+ * @brief
+ *  Send the telnet negotiation queued by the filter. It goes through the
+ *  context output ring, in order with the session output, and what the socket
+ *  does not take is resumed on EPOLLOUT like any other output.
+ */
+
+static void CLI_ServerTelnetFlush(CLI_SessionTypeDef *session)
+{
+    if ( session->telnet.replyLen == 0 )
+        return;
+
+    CLI_ContextWrite(session->ctx, (const char *) session->telnet.reply, session->telnet.replyLen);
+    CLI_ContextFlush(session->ctx);
+
+    session->telnet.replyLen = 0;
+}
+
+/**
+ * @brief
+ *  Accept a pending connection and set up its session.
+ */
+
+static void CLI_ServerAccept(int listenFd)
+{
+    CLI_SessionTypeDef *session;
+    CLI_InitTypeDef     init;
+    int                 fd;
+
+    fd = accept(listenFd, NULL, NULL);
+    if ( fd < 0 )
+        return;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if ( gCliServer.sessionCount >= gCliServer.config.maxSessions )
+    {
+        close(fd);
+        return;
+    }
+
+    session = calloc(1, sizeof(CLI_SessionTypeDef));
+    if ( session == NULL )
+    {
+        close(fd);
+        return;
+    }
+
+    CLI_IoOpenSocket(&session->io, fd);
+    session->isTelnet = (listenFd == gCliServer.tcpFd);
+
+    /* States are served from the server loop once alerted. */
+    init          = gCliServer.config.sessionInit;
+    init.io       = &session->io;
+    init.alert    = CLI_ServerAlert;
+    init.alertArg = session;
+
+    /* Telnet negotiates before the first prompt, printed once it is queued. */
+    if ( session->isTelnet )
+        init.printPrompt = false;
+
+    session->ctx = CLI_ContextCreate(&init);
+    if ( session->ctx == NULL || ! CLI_ServerWatch(fd, session) )
+    {
+        CLI_ContextDestroy(session->ctx);
+        CLI_IoClose(&session->io);
+        free(session);
+        return;
+    }
+
+    if ( session->isTelnet )
+    {
+        CLI_TelnetInit(&session->telnet);
+        CLI_ServerTelnetFlush(session);
+
+        if ( gCliServer.config.sessionInit.printPrompt )
+        {
+            CLI_ContextPrintPrompt(session->ctx, 1);
+            CLI_ContextFlush(session->ctx);
+        }
+    }
+
+    session->events = EPOLLIN;
+    DL_APPEND(gCliServer.sessions, session);
+    __atomic_add_fetch(&gCliServer.sessionCount, 1, __ATOMIC_RELAXED);
+
+    /* The first prompt may not have fit already. */
+    CLI_ServerArm(session);
+}
+
+/**
+ * @brief
+ *  Resume a stalled output once the socket has room, then feed whatever the
+ *  session sent to its context.
+ */
+
+static void CLI_ServerReceive(CLI_SessionTypeDef *session, uint32_t events)
+{
+    ssize_t n;
+
+    if ( session->closing )
+        return;
+
+    if ( events & EPOLLOUT )
+    {
+        CLI_ContextFlush(session->ctx);
+        CLI_ServerArm(session);
+    }
+
+    if ( (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) == 0 )
+        return;
+
+    /* Paused, only hang ups and errors are reported. */
+    if ( session->paused )
+    {
+        if ( events & (EPOLLHUP | EPOLLERR) )
+            CLI_ServerEndSession(session);
+        return;
+    }
+
+    n = CLI_IoRead(&session->io, session->rx, sizeof(session->rx));
+    if ( n < 0 && (errno == EAGAIN || errno == EINTR) )
+        return;
+
+    if ( n <= 0 )
+    {
+        CLI_ServerEndSession(session);
+        return;
+    }
+
+    if ( session->isTelnet )
+    {
+        n = (ssize_t) CLI_TelnetFilter(&session->telnet, session->rx, (size_t) n);
+        CLI_ServerTelnetFlush(session);
+    }
+    else
+        n = (ssize_t) CLI_ServerFoldLineEnds(session, session->rx, (size_t) n);
+
+    session->rxLen = (size_t) n;
+    session->rxPos = 0;
+    CLI_ServerFeed(session);
+
+    if ( CLI_ContextIsEnded(session->ctx) )
+        CLI_ServerEndSession(session);
+}
+
+/**
+ * @brief
+ *  Serve the pending states of alerted sessions.
+ */
+
+static void CLI_ServerServeReady(void)
+{
+    CLI_SessionTypeDef *session;
+    uint64_t            count;
+
+    if ( read(gCliServer.wakeFd, &count, sizeof(count)) < 0 )
+    {
+        /* EAGAIN: spurious wake-up. */
+    }
+
+    while ( 1 )
+    {
+        pthread_mutex_lock(&gCliServer.readyLock);
+        session = gCliServer.ready;
+        if ( session != NULL )
+        {
+            gCliServer.ready = session->readyNext;
+            session->ready   = false;
+        }
+        pthread_mutex_unlock(&gCliServer.readyLock);
+
+        if ( session == NULL )
+            break;
+
+        if ( session->closing )
+            continue;
+
+        CLI_ContextProcessState(session->ctx);
+
+        /* Resume input held back while the context was busy. */
+        if ( session->rxPos < session->rxLen )
+            CLI_ServerFeed(session);
+        else
+            CLI_ServerArm(session);
+
+        if ( CLI_ContextIsEnded(session->ctx) )
+            CLI_ServerEndSession(session);
+    }
+}
+
+/**
+ * @brief
+ *  The server thread, a single epoll loop for the listener and all sessions.
+ */
+
+static void *CLI_ServerTask(void *arg)
+{
+    struct epoll_event  events[CLI_SERVER_MAX_EVENTS];
+    CLI_SessionTypeDef *session;
+    CLI_SessionTypeDef *tmp;
+    bool                stop = false;
+    int                 count;
+    int                 i;
+
+    while ( ! stop )
+    {
+        count = epoll_wait(gCliServer.epollFd, events, CLI_SERVER_MAX_EVENTS, -1);
+        if ( count < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+
+        for ( i = 0; i < count; i++ )
+        {
+            if ( events[i].data.ptr == &gCliServer.stopFd )
+                stop = true;
+            else if ( events[i].data.ptr == &gCliServer.wakeFd )
+                CLI_ServerServeReady();
+            else if ( events[i].data.ptr == &gCliServer.listenFd )
+                CLI_ServerAccept(gCliServer.listenFd);
+            else if ( events[i].data.ptr == &gCliServer.tcpFd )
+                CLI_ServerAccept(gCliServer.tcpFd);
+            else
+                CLI_ServerReceive(events[i].data.ptr, events[i].events);
+        }
+
+        CLI_ServerCloseEnded();
+    }
+
+    DL_FOREACH_SAFE(gCliServer.sessions, session, tmp)
+    CLI_ServerCloseSession(session);
+
+    return NULL;
+}
+
+/**
+ * @brief
+ *  Release the server descriptors.
+ */
+
+static void CLI_ServerCleanup(void)
+{
+    if ( gCliServer.listenFd >= 0 )
+    {
+        close(gCliServer.listenFd);
+        unlink(gCliServer.path);
+    }
+
+    if ( gCliServer.tcpFd >= 0 )
+        close(gCliServer.tcpFd);
+
+    if ( gCliServer.stopFd >= 0 )
+        close(gCliServer.stopFd);
+
+    if ( gCliServer.wakeFd >= 0 )
+        close(gCliServer.wakeFd);
+
+    if ( gCliServer.epollFd >= 0 )
+        close(gCliServer.epollFd);
+
+    gCliServer.listenFd = -1;
+    gCliServer.tcpFd    = -1;
+    gCliServer.stopFd   = -1;
+    gCliServer.wakeFd   = -1;
+    gCliServer.epollFd  = -1;
+}
+
+/**
+ * @brief
+ *  Listen on the configured Unix domain socket path.
+ */
+
+static bool CLI_ServerListenUnix(void)
+{
+    struct sockaddr_un addr = {0};
+
+    gCliServer.listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ( gCliServer.listenFd < 0 )
+        return false;
+
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, gCliServer.path, sizeof(addr.sun_path));
+    unlink(gCliServer.path); /* Stale socket from a previous run */
+
+    if ( bind(gCliServer.listenFd, (struct sockaddr *) &addr, sizeof(addr)) < 0 )
+        return false;
+
+    if ( listen(gCliServer.listenFd, CLI_SERVER_BACKLOG) < 0 )
+        return false;
+
+    return CLI_ServerWatch(gCliServer.listenFd, &gCliServer.listenFd);
+}
+
+/**
+ * @brief
+ *  Listen for telnet connections on the configured address and port.
+ */
+
+static bool CLI_ServerListenTcp(void)
+{
+    struct sockaddr_in addr    = {0};
+    const char        *address = gCliServer.config.tcpAddress;
+    int                reuse   = 1;
+
+    if ( address == NULL )
+        address = CLI_SERVER_TCP_ADDRESS;
+
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(gCliServer.config.tcpPort);
+    if ( inet_pton(AF_INET, address, &addr.sin_addr) != 1 )
+        return false;
+
+    gCliServer.tcpFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ( gCliServer.tcpFd < 0 )
+        return false;
+
+    setsockopt(gCliServer.tcpFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if ( bind(gCliServer.tcpFd, (struct sockaddr *) &addr, sizeof(addr)) < 0 )
+        return false;
+
+    if ( listen(gCliServer.tcpFd, CLI_SERVER_BACKLOG) < 0 )
+        return false;
+
+    return CLI_ServerWatch(gCliServer.tcpFd, &gCliServer.tcpFd);
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_SERVER_Exported_Functions CLI Server Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Start listening and spawn the server thread.
+  * @note   CLI_Init() must have been called, commands injected before
+  *         CLI_BuildTable() are available to every session.
+  * @param config: Server configuration.
+  * @retval boolean, true on success.
+  */
+
+bool CLI_ServerStart(const CLI_ServerConfigTypeDef *config)
+{
+    bool success = false;
+
+    if ( config == NULL || gCliServer.running )
+        return false;
+
+    if ( config->unixPath == NULL && config->tcpPort == 0 )
+        return false;
+
+    if ( config->unixPath != NULL && strlen(config->unixPath) >= CLI_SERVER_PATH_SIZE )
+        return false;
+
+    gCliServer.config = *config;
+    if ( gCliServer.config.maxSessions == 0 )
+        gCliServer.config.maxSessions = CLI_SERVER_MAX_SESSIONS;
+
+    gCliServer.path[0] = '\0';
+    if ( config->unixPath != NULL )
+    {
+        memcpy(gCliServer.path, config->unixPath, strlen(config->unixPath) + 1);
+        gCliServer.config.unixPath = gCliServer.path;
+    }
+
+    do
+    {
+        gCliServer.epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if ( gCliServer.epollFd < 0 )
+            break;
+
+        gCliServer.stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if ( gCliServer.stopFd < 0 || ! CLI_ServerWatch(gCliServer.stopFd, &gCliServer.stopFd) )
+            break;
+
+        gCliServer.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if ( gCliServer.wakeFd < 0 || ! CLI_ServerWatch(gCliServer.wakeFd, &gCliServer.wakeFd) )
+            break;
+
+        if ( gCliServer.path[0] != '\0' && ! CLI_ServerListenUnix() )
+            break;
+
+        if ( gCliServer.config.tcpPort != 0 && ! CLI_ServerListenTcp() )
+            break;
+
+        if ( pthread_create(&gCliServer.thread, NULL, CLI_ServerTask, NULL) != 0 )
+            break;
+
+        gCliServer.running = true;
+        success            = true;
+
+    } while ( 0 );
+
+    if ( ! success )
+        CLI_ServerCleanup();
+
+    return success;
+}
+
+/**
+  * @brief  Close all sessions and stop the server thread.
+  */
+
+void CLI_ServerStop(void)
+{
+    uint64_t one = 1;
+
+    if ( ! gCliServer.running )
+        return;
+
+    if ( write(gCliServer.stopFd, &one, sizeof(one)) == sizeof(one) )
+        pthread_join(gCliServer.thread, NULL);
+
+    CLI_ServerCleanup();
+    gCliServer.running = false;
+}
+
+/**
+  * @brief  Gets the count of connected sessions.
+  * @retval Count of sessions.
+  */
+
+uint32_t CLI_ServerGetSessionCount(void)
+{
+    return __atomic_load_n(&gCliServer.sessionCount, __ATOMIC_RELAXED);
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -11,13 +11,14 @@
 /* Includes ------------------------------------------------------------------*/
 #include <pthread.h>
 #include <unistd.h>
-#include <signal.h>
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
-#include <termios.h>
 #include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include "cli.h"
 #include "infra.h"
 
@@ -32,6 +33,8 @@
 #define CLI_TASK_EVENT_CLI_POLL_RX (uint32_t)(1 << 2) /*!< Periodic poll for user input */
 #define CLI_TASK_EVENT_SIGTERM     (uint32_t)(1 << 3) /*!< Terminate task  */
 
+#define CLI_TASK_RX_BATCH_SIZE 256 /*!< Max bytes fetched from the input by a single read() */
+
 /** @} */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -47,12 +50,25 @@ typedef struct
     pthread_t thread; /*!< Thread handle */
     struct
     {
-        pthread_mutex_t mutex;       /*!< Mutex for event handling */
-        pthread_cond_t  cond;        /*!< Condition variable for event signaling */
-        int             event_flags; /*!< Event flags */
+        int      fd;          /*!< eventfd used to wake up the task */
+        uint32_t event_flags; /*!< Pending event flags, accessed atomically */
     } event;
+    struct
+    {
+        int      fd;    /*!< CLOCK_MONOTONIC timerfd, -1 when not in use */
+        uint32_t event; /*!< Event flag raised on every expiry */
+    } timer;
+    CLI_IoTypeDef *io;            /*!< Backend the task reads user input from */
+    CLI_IoTypeDef  localIo;       /*!< Default terminal backend when none was provided */
+    int            inputFd;       /*!< Descriptor the task waits on for input, -1 when closed */
+    struct
+    {
+        unsigned char buf[CLI_TASK_RX_BATCH_SIZE]; /*!< Last batch read from the input */
+        size_t        len;                         /*!< Bytes in 'buf' */
+        size_t        pos;                         /*!< Bytes already passed to the engine */
+    } rx;
+    bool           inputOpen;     /*!< Input has not reached its end yet */
     bool           initialized;   /*!< Flag indicating if the task is initialized */
-    struct termios original_term; /*!< Original terminal settings */
 } CLITask_Data_TypeDef;
 
 /** @} */
@@ -62,7 +78,7 @@ typedef struct
   * @{
   */
 
-static CLITask_Data_TypeDef gTaskCli = {0};
+static CLITask_Data_TypeDef gTaskCli = {.event.fd = -1, .timer.fd = -1, .localIo.inFd = -1, .inputFd = -1};
 
 /** @} */
 
@@ -71,118 +87,57 @@ static CLITask_Data_TypeDef gTaskCli = {0};
   * @{
   */
 
-/**
- * @brief Set terminal to non-blocking mode.
- * @retval EXIT_SUCCESS on success, EXIT_FAILURE on error.
- */
-
-static int CLI_Terminal_SetNB(void)
-{
-    struct termios term;
-    int            flags;
-
-    /* Get the current terminal attributes */
-    if ( tcgetattr(STDIN_FILENO, &term) < 0 )
-        return EXIT_FAILURE;
-
-    /* Save the original terminal attributes */
-    gTaskCli.original_term = term;
-
-    /* Set the terminal to raw mode */
-    term.c_lflag &= ~(ICANON | ECHO | ISIG);
-    term.c_iflag &= ~(IXON | ICRNL);
-    term.c_oflag &= ~(OPOST);
-    term.c_cc[VMIN]  = 0;
-    term.c_cc[VTIME] = 1; // 100ms timeout
-
-    if ( tcsetattr(STDIN_FILENO, TCSANOW, &term) < 0 )
-        return EXIT_FAILURE;
-
-    /* Set the file descriptor to non-blocking mode */
-    flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-    if ( flags < 0 )
-        return EXIT_FAILURE;
-
-    if ( fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK) < 0 )
-        return EXIT_FAILURE;
-
-    return EXIT_SUCCESS;
-}
-
-/**
- * @brief Restore terminal to normal blocking mode.
- * @retval EXIT_SUCCESS on success, EXIT_FAILURE on error.
- */
-
-int CLI_Terminal_SetNormal(void)
-{
-    int flags;
-
-    /* Restore the terminal to its original mode */
-    if ( tcsetattr(STDIN_FILENO, TCSANOW, &gTaskCli.original_term) < 0 )
-        return EXIT_FAILURE;
-
-    /* Set the file descriptor to blocking mode */
-    flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-    if ( flags < 0 )
-        return EXIT_FAILURE;
-
-    if ( fcntl(STDIN_FILENO, F_SETFL, flags & ~O_NONBLOCK) < 0 )
-        return EXIT_FAILURE;
-
-    return EXIT_SUCCESS;
-}
-
 /**
  * @brief Signal an event to the CLI task.
  * @param event_flag The event flag to signal.
  */
 
-static void CLI_SignalEvent(int event_flag)
+static void CLI_SignalEvent(uint32_t event_flag)
 {
-    pthread_mutex_lock(&gTaskCli.event.mutex);
-    gTaskCli.event.event_flags |= event_flag;
-    pthread_cond_signal(&gTaskCli.event.cond);
-    pthread_mutex_unlock(&gTaskCli.event.mutex);
-}
+    uint64_t one = 1;
 
-/**
- * @brief Timer handler function to signal CLI poll event.
- * @param arg Not used.
- */
+    __atomic_fetch_or(&gTaskCli.event.event_flags, event_flag, __ATOMIC_RELEASE);
 
-static void CLI_TimerHandler(union sigval arg)
-{
-    CLI_SignalEvent(CLI_TASK_EVENT_CLI_POLL_RX);
+    /* Kick the eventfd, the counter is sticky so a wake-up can't be lost
+     * even if the task is not sleeping yet. */
+    if ( write(gTaskCli.event.fd, &one, sizeof(one)) < 0 )
+    {
+        /* EAGAIN: the counter is saturated, the task is bound to wake up anyway. */
+    }
 }
 
 /**
- * @brief Set up a periodic timer.
- * @param interval The timer interval in milliseconds.
+ * @brief Arm the task periodic timer.
+ *        The timer is a CLOCK_MONOTONIC timerfd which is waited on by the task
+ *        itself alongside its other descriptors, expiries are therefore serviced
+ *        on the CLI thread and wall-clock adjustments can't disturb them.
+ * @param interval The timer interval in milliseconds, 0 disarms the timer.
+ * @param event_flag The event flag to raise on every expiry.
  * @retval true on success, false on error.
  */
 
-static bool CLI_Timer_Set(uint32_t interval)
+static bool CLI_Timer_Set(uint32_t interval, uint32_t event_flag)
 {
-    /* Create and start a periodic timer */
-    struct sigevent   sev;
     struct itimerspec its;
-    timer_t           timerid;
 
-    sev.sigev_notify            = SIGEV_THREAD;
-    sev.sigev_value.sival_ptr   = &gTaskCli.event;
-    sev.sigev_notify_function   = CLI_TimerHandler;
-    sev.sigev_notify_attributes = NULL;
+    if ( gTaskCli.timer.fd < 0 && interval == 0 )
+        return true; /* Never armed */
 
-    if ( timer_create(CLOCK_REALTIME, &sev, &timerid) == -1 )
-        return false;
+    if ( gTaskCli.timer.fd < 0 )
+    {
+        gTaskCli.timer.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if ( gTaskCli.timer.fd < 0 )
+            return false;
+    }
+
+    gTaskCli.timer.event = event_flag;
 
     its.it_value.tv_sec     = interval / 1000;
     its.it_value.tv_nsec    = (interval % 1000) * 1000000; // Convert milliseconds to nanoseconds
     its.it_interval.tv_sec  = interval / 1000;
     its.it_interval.tv_nsec = (interval % 1000) * 1000000; // Convert milliseconds to nanoseconds
 
-    if ( timer_settime(timerid, 0, &its, NULL) == -1 )
+    if ( timerfd_settime(gTaskCli.timer.fd, 0, &its, NULL) == -1 )
         return false;
 
     return true;
@@ -190,23 +145,75 @@ static bool CLI_Timer_Set(uint32_t interval)
 
 /**
  * @brief Wait for events and return the event flags.
+ *        Blocks in poll() on the task eventfd, the task timer when armed and,
+ *        in event driven mode, on the input descriptor as well, so an idle
+ *        console costs no wake-ups at all. The input is left out while part
+ *        of the last batch is still waiting for the engine.
  * @retval The event flags.
  */
 
-static int CLI_WaitEvents(void)
+static uint32_t CLI_WaitEvents(void)
 {
-    int events = 0;
-    pthread_mutex_lock(&gTaskCli.event.mutex);
-    while ( gTaskCli.event.event_flags == 0 )
+    struct pollfd fds[3];
+    nfds_t        nfds;
+    nfds_t        timerSlot;
+    nfds_t        inputSlot;
+    uint32_t      events;
+    uint64_t      count;
+
+    for ( ;; )
     {
-        pthread_cond_wait(&gTaskCli.event.cond, &gTaskCli.event.mutex);
-    }
+        events = __atomic_exchange_n(&gTaskCli.event.event_flags, 0, __ATOMIC_ACQUIRE);
+        if ( events != 0 )
+            return events;
+
+        fds[0].fd     = gTaskCli.event.fd;
+        fds[0].events = POLLIN;
+        nfds          = 1;
+        timerSlot     = 0;
+        inputSlot     = 0;
 
-    events                     = gTaskCli.event.event_flags;
-    gTaskCli.event.event_flags = 0; // Reset the event flags after being signaled
-    pthread_mutex_unlock(&gTaskCli.event.mutex);
+        if ( gTaskCli.timer.fd >= 0 )
+        {
+            fds[nfds].fd     = gTaskCli.timer.fd;
+            fds[nfds].events = POLLIN;
+            timerSlot        = nfds++;
+        }
+
+        /* A batch the engine could not take yet is resumed on its alert,
+         * until then the pending input must not wake us up. */
+        if ( CLI_EVENT_DRIVEN_RX && gTaskCli.initialized && gTaskCli.inputFd >= 0 && gTaskCli.rx.pos == gTaskCli.rx.len )
+        {
+            fds[nfds].fd     = gTaskCli.inputFd;
+            fds[nfds].events = POLLIN;
+            inputSlot        = nfds++;
+        }
+
+        if ( poll(fds, nfds, -1) < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            return CLI_TASK_EVENT_SIGTERM; /* Nothing sane left to wait on */
+        }
+
+        /* Drain the eventfd counter, the flags tell us what was signaled. */
+        if ( (fds[0].revents & POLLIN) != 0 )
+        {
+            if ( read(gTaskCli.event.fd, &count, sizeof(count)) < 0 && errno != EAGAIN )
+                return CLI_TASK_EVENT_SIGTERM;
+        }
+
+        /* Timer expired, the read count tells how many periods elapsed but a
+         * single event is enough for any periodic job. */
+        if ( timerSlot != 0 && (fds[timerSlot].revents & POLLIN) != 0 )
+        {
+            if ( read(gTaskCli.timer.fd, &count, sizeof(count)) == sizeof(count) )
+                __atomic_fetch_or(&gTaskCli.event.event_flags, gTaskCli.timer.event, __ATOMIC_RELAXED);
+        }
 
-    return events;
+        if ( inputSlot != 0 && (fds[inputSlot].revents & (POLLIN | POLLHUP | POLLERR)) != 0 )
+            __atomic_fetch_or(&gTaskCli.event.event_flags, CLI_TASK_EVENT_CLI_POLL_RX, __ATOMIC_RELAXED);
+    }
 }
 
 /**
@@ -220,7 +227,7 @@ static void *CLI_Task(void *arg)
 {
     for ( ;; )
     {
-        int cli_events = CLI_WaitEvents(); /* Block indefinitely*/
+        uint32_t cli_events = CLI_WaitEvents(); /* Block indefinitely*/
 
         /*!****************************************************************/
         /**
@@ -231,16 +238,23 @@ static void *CLI_Task(void *arg)
 
         if ( (cli_events & CLI_TASK_EVENT_INIT) != 0 )
         {
-            /* If we're here it is safe to assume we're initialized. */
-            gTaskCli.initialized = true;
+            /* If we're here it is safe to assume we're initialized, ordered
+             * against CLI_BuildTable() so its alert can't be missed. */
+            __atomic_store_n(&gTaskCli.initialized, true, __ATOMIC_SEQ_CST);
+
+            /* Linux: no backend provided, default to the controlling
+             * terminal switched to RAW mode so reading will not block. */
 
-            /* Linux: need to switch to RAW terminal so getch()  
-             * will not block. */
+            if ( gTaskCli.io == NULL && CLI_IoOpenTty(&gTaskCli.localIo, STDIN_FILENO, STDOUT_FILENO) )
+                gTaskCli.io = &gTaskCli.localIo;
 
-            CLI_Terminal_SetNB();
+            gTaskCli.inputOpen = (gTaskCli.io != NULL);
+            gTaskCli.inputFd   = (gTaskCli.io != NULL) ? gTaskCli.io->inFd : -1;
 
-            /* Start the periodic 10 milliseconds timer. */
-            CLI_Timer_Set(5);
+            /* Polling mode, or a backend with nothing to wait on: start the
+             * periodic input poll timer. */
+            if ( gTaskCli.inputOpen && (CLI_EVENT_DRIVEN_RX == 0 || gTaskCli.inputFd < 0) )
+                CLI_Timer_Set(CLI_POLL_INTERVAL_MS, CLI_TASK_EVENT_CLI_POLL_RX);
         }
 
         /*!****************************************************************/
@@ -259,22 +273,37 @@ static void *CLI_Task(void *arg)
 
         /*!****************************************************************/ /**
          * @brief
-        *   Poll and read the standard input.
+        *   Read the standard input.
         *
         ***********************************************************************/
 
-        if ( (cli_events & CLI_TASK_EVENT_CLI_POLL_RX) != 0 )
+        if ( gTaskCli.rx.pos == gTaskCli.rx.len && (cli_events & CLI_TASK_EVENT_CLI_POLL_RX) != 0 && gTaskCli.inputOpen )
         {
-            char    c;
-            ssize_t n = read(STDIN_FILENO, &c, 1);
+            ssize_t n = CLI_IoRead(gTaskCli.io, gTaskCli.rx.buf, sizeof(gTaskCli.rx.buf));
 
             if ( n > 0 )
             {
-                /* Pass to the CLI engine */
-                CLI_ProcessChar(c);
+                gTaskCli.rx.len = (size_t) n;
+                gTaskCli.rx.pos = 0;
+            }
+            else if ( n == 0 || (errno != EAGAIN && errno != EINTR) )
+            {
+                /* End of input, stop watching the backend. */
+                gTaskCli.inputOpen = false;
+                gTaskCli.inputFd   = -1;
+                CLI_Timer_Set(0, 0);
             }
         }
 
+        /* Pass the batch to the CLI engine. Bytes arriving while it has
+         * pending work are kept in its typeahead queue, it stops early only
+         * when that queue is full. The alert it raised brings us back here
+         * once the work is done and the rest of the batch is resumed. */
+        if ( gTaskCli.rx.pos < gTaskCli.rx.len )
+        {
+            gTaskCli.rx.pos += CLI_ProcessBytes(gTaskCli.rx.buf + gTaskCli.rx.pos, gTaskCli.rx.len - gTaskCli.rx.pos);
+        }
+
         /*!****************************************************************/ /**
          * @brief
         *   Task termination event.
@@ -295,7 +324,7 @@ static void *CLI_Task(void *arg)
  */
 void CLI_TaskAlert(void)
 {
-    if ( gTaskCli.initialized == true )
+    if ( __atomic_load_n(&gTaskCli.initialized, __ATOMIC_SEQ_CST) == true )
     {
         CLI_SignalEvent(CLI_TASK_EVENT_CLI_CMD_REQ);
     }
@@ -316,39 +345,42 @@ void CLI_TaskTerminate(void)
         pthread_join(gTaskCli.thread, NULL);
 
         /* Cleanup (this will not be reached in this example, as the loop is infinite). */
-        pthread_mutex_destroy(&gTaskCli.event.mutex);
-        pthread_cond_destroy(&gTaskCli.event.cond);
+        close(gTaskCli.event.fd);
+        gTaskCli.event.fd = -1;
+
+        if ( gTaskCli.timer.fd >= 0 )
+        {
+            close(gTaskCli.timer.fd);
+            gTaskCli.timer.fd = -1;
+        }
 
-        CLI_Terminal_SetNormal();
+        /* Restores the terminal when reading from one. */
+        CLI_IoClose(gTaskCli.io);
     }
 }
 
 /**
  * @brief Initializes the CLI task.
+ * @param io Backend to read user input from, the task closes it when terminated.
+ *           NULL to read from the controlling terminal.
  */
 
-bool CLI_InitTask(void)
+bool CLI_InitTask(CLI_IoTypeDef *io)
 {
     bool success = true;
     int  ret;
 
     do
     {
-        ret = pthread_mutex_init(&gTaskCli.event.mutex, NULL);
-        if ( ret != 0 )
-        {
-            success = false;
-            break;
-        }
-
-        ret = pthread_cond_init(&gTaskCli.event.cond, NULL);
-        if ( ret != 0 )
+        gTaskCli.event.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if ( gTaskCli.event.fd < 0 )
         {
             success = false;
             break;
         }
 
         gTaskCli.event.event_flags = 0;
+        gTaskCli.io                = io;
 
         /* Create a new thread */
         ret = pthread_create(&gTaskCli.thread, NULL, CLI_Task, NULL);
@@ -363,10 +395,10 @@ bool CLI_InitTask(void)
 
     } while ( 0 );
 
-    if ( ! success )
+    if ( ! success && gTaskCli.event.fd >= 0 )
     {
-        pthread_cond_destroy(&gTaskCli.event.cond);
-        pthread_mutex_destroy(&gTaskCli.event.mutex);
+        close(gTaskCli.event.fd);
+        gTaskCli.event.fd = -1;
     }
 
     return success;
@@ -0,0 +1,299 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_telnet.c
+  * @brief   Minimal telnet protocol filter for CLI sessions.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_telnet.h" /* Module local include */
+#include <string.h>
+
+/** @defgroup CLI_TELNET CLI Telnet
+  * @brief CLI telnet protocol module
+  * @{
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup CLI_TELNET_Private_Typedef CLI Telnet Private Typedef
+  * @{
+  */
+
+/**
+  * @brief  Receive state machine states.
+  */
+typedef enum
+{
+    CLI_Telnet_Data = 0, /* Plain data */
+    CLI_Telnet_Cr,       /* Data, last byte was a carriage return */
+    CLI_Telnet_Iac,      /* IAC received */
+    CLI_Telnet_Verb,     /* IAC WILL / WONT / DO / DONT received, option follows */
+    CLI_Telnet_Sb,       /* Inside sub negotiation */
+    CLI_Telnet_SbIac,    /* IAC received inside sub negotiation */
+
+} CLI_TelnetStateTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_TELNET_Private_Functions CLI Telnet Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Options bit set helpers.
+ */
+
+static inline bool CLI_TelnetTest(const uint32_t *set, uint8_t option)
+{
+    return (set[option >> 5] >> (option & 31)) & 1;
+}
+
+static inline void CLI_TelnetAssign(uint32_t *set, uint8_t option, bool enabled)
+{
+    if ( enabled )
+        set[option >> 5] |= (1U << (option & 31));
+    else
+        set[option >> 5] &= ~(1U << (option & 31));
+}
+
+/**
+ * @brief
+ *  Queue a three bytes IAC command for transmission.
+ */
+
+static void CLI_TelnetReply(CLI_TelnetTypeDef *telnet, uint8_t verb, uint8_t option)
+{
+    if ( telnet->replyLen + 3 > sizeof(telnet->reply) )
+        return;
+
+    telnet->reply[telnet->replyLen++] = CLI_TELNET_IAC;
+    telnet->reply[telnet->replyLen++] = verb;
+    telnet->reply[telnet->replyLen++] = option;
+}
+
+/**
+ * @brief
+ *  Options we are willing to enable on our side and ask the client for.
+ */
+
+static bool CLI_TelnetLocalSupported(uint8_t option)
+{
+    return option == CLI_TELNET_OPT_ECHO || option == CLI_TELNET_OPT_SGA;
+}
+
+static bool CLI_TelnetRemoteSupported(uint8_t option)
+{
+    return option == CLI_TELNET_OPT_SGA || option == CLI_TELNET_OPT_NAWS;
+}
+
+/**
+ * @brief
+ *  Handle a received WILL / WONT / DO / DONT. Replies are only sent when the
+ *  request changes an option state, which keeps negotiation from looping.
+ */
+
+static void CLI_TelnetNegotiate(CLI_TelnetTypeDef *telnet, uint8_t verb, uint8_t option)
+{
+    switch ( verb )
+    {
+        case CLI_TELNET_WILL:
+            if ( ! CLI_TelnetRemoteSupported(option) )
+                CLI_TelnetReply(telnet, CLI_TELNET_DONT, option);
+            else if ( ! CLI_TelnetTest(telnet->remote, option) )
+            {
+                CLI_TelnetAssign(telnet->remote, option, true);
+                CLI_TelnetReply(telnet, CLI_TELNET_DO, option);
+            }
+            break;
+
+        case CLI_TELNET_WONT:
+            if ( CLI_TelnetTest(telnet->remote, option) )
+            {
+                CLI_TelnetAssign(telnet->remote, option, false);
+                CLI_TelnetReply(telnet, CLI_TELNET_DONT, option);
+            }
+            break;
+
+        case CLI_TELNET_DO:
+            if ( ! CLI_TelnetLocalSupported(option) )
+                CLI_TelnetReply(telnet, CLI_TELNET_WONT, option);
+            else if ( ! CLI_TelnetTest(telnet->local, option) )
+            {
+                CLI_TelnetAssign(telnet->local, option, true);
+                CLI_TelnetReply(telnet, CLI_TELNET_WILL, option);
+            }
+            break;
+
+        case CLI_TELNET_DONT:
+            if ( CLI_TelnetTest(telnet->local, option) )
+            {
+                CLI_TelnetAssign(telnet->local, option, false);
+                CLI_TelnetReply(telnet, CLI_TELNET_WONT, option);
+            }
+            break;
+    }
+}
+
+/**
+ * @brief
+ *  Handle a complete sub negotiation, only NAWS is understood.
+ */
+
+static void CLI_TelnetSubNegotiation(CLI_TelnetTypeDef *telnet)
+{
+    if ( telnet->sbLen >= 5 && telnet->sb[0] == CLI_TELNET_OPT_NAWS )
+    {
+        telnet->width  = (uint16_t) ((telnet->sb[1] << 8) | telnet->sb[2]);
+        telnet->height = (uint16_t) ((telnet->sb[3] << 8) | telnet->sb[4]);
+    }
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_TELNET_Exported_Functions CLI Telnet Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Reset a connection state and queue the opening negotiation: we
+  *         echo and suppress go ahead (character-at-a-time mode) and ask the
+  *         client to report its window size.
+  * @param telnet: Connection state.
+  */
+
+void CLI_TelnetInit(CLI_TelnetTypeDef *telnet)
+{
+    memset(telnet, 0, sizeof(CLI_TelnetTypeDef));
+
+    CLI_TelnetAssign(telnet->local, CLI_TELNET_OPT_ECHO, true);
+    CLI_TelnetAssign(telnet->local, CLI_TELNET_OPT_SGA, true);
+    CLI_TelnetAssign(telnet->remote, CLI_TELNET_OPT_SGA, true);
+    CLI_TelnetAssign(telnet->remote, CLI_TELNET_OPT_NAWS, true);
+
+    CLI_TelnetReply(telnet, CLI_TELNET_WILL, CLI_TELNET_OPT_ECHO);
+    CLI_TelnetReply(telnet, CLI_TELNET_WILL, CLI_TELNET_OPT_SGA);
+    CLI_TelnetReply(telnet, CLI_TELNET_DO, CLI_TELNET_OPT_SGA);
+    CLI_TelnetReply(telnet, CLI_TELNET_DO, CLI_TELNET_OPT_NAWS);
+}
+
+/**
+  * @brief  Strip protocol commands from received bytes in place and fold
+  *         telnet line ends (CR LF, CR NUL, bare LF) and DEL into what the
+  *         engine expects. Negotiation replies are queued in 'reply'; the
+  *         caller sends and clears them.
+  * @param telnet: Connection state.
+  * @param buf: Received bytes, overwritten with the data bytes.
+  * @param len: Count of received bytes.
+  * @retval Count of data bytes left in 'buf'.
+  */
+
+size_t CLI_TelnetFilter(CLI_TelnetTypeDef *telnet, unsigned char *buf, size_t len)
+{
+    size_t  in;
+    size_t  out = 0;
+    uint8_t c;
+
+    for ( in = 0; in < len; in++ )
+    {
+        c = buf[in];
+
+        switch ( telnet->state )
+        {
+            case CLI_Telnet_Cr:
+                telnet->state = CLI_Telnet_Data;
+                if ( c == '\n' || c == '\0' )
+                    break;
+                /* Fall through */
+
+            case CLI_Telnet_Data:
+                if ( c == CLI_TELNET_IAC )
+                    telnet->state = CLI_Telnet_Iac;
+                else if ( c == '\r' || c == '\n' )
+                {
+                    buf[out++]    = '\r';
+                    telnet->state = (c == '\r') ? CLI_Telnet_Cr : CLI_Telnet_Data;
+                }
+                else if ( c == 0x7F )
+                    buf[out++] = '\b';
+                else if ( c != '\0' )
+                    buf[out++] = c;
+                break;
+
+            case CLI_Telnet_Iac:
+                telnet->state = CLI_Telnet_Data;
+                if ( c >= CLI_TELNET_WILL && c <= CLI_TELNET_DONT )
+                {
+                    telnet->verb  = c;
+                    telnet->state = CLI_Telnet_Verb;
+                }
+                else if ( c == CLI_TELNET_SB )
+                {
+                    telnet->sbLen = 0;
+                    telnet->state = CLI_Telnet_Sb;
+                }
+                else if ( c == CLI_TELNET_IAC )
+                    buf[out++] = c; /* Escaped 255, the engine will drop it */
+                break;
+
+            case CLI_Telnet_Verb:
+                CLI_TelnetNegotiate(telnet, telnet->verb, c);
+                telnet->state = CLI_Telnet_Data;
+                break;
+
+            case CLI_Telnet_Sb:
+                if ( c == CLI_TELNET_IAC )
+                    telnet->state = CLI_Telnet_SbIac;
+                else if ( telnet->sbLen < sizeof(telnet->sb) )
+                    telnet->sb[telnet->sbLen++] = c;
+                break;
+
+            case CLI_Telnet_SbIac:
+                if ( c == CLI_TELNET_IAC )
+                {
+                    if ( telnet->sbLen < sizeof(telnet->sb) )
+                        telnet->sb[telnet->sbLen++] = c;
+                    telnet->state = CLI_Telnet_Sb;
+                }
+                else
+                {
+                    if ( c == CLI_TELNET_SE )
+                        CLI_TelnetSubNegotiation(telnet);
+                    telnet->state = CLI_Telnet_Data;
+                }
+                break;
+        }
+    }
+
+    return out;
+}
+
+/**
+  * @brief  Checks whether an option is currently enabled.
+  * @param telnet: Connection state.
+  * @param local: true for our side, false for the client side.
+  * @param option: Option code.
+  * @retval boolean, true if enabled.
+  */
+
+bool CLI_TelnetIsEnabled(const CLI_TelnetTypeDef *telnet, bool local, uint8_t option)
+{
+    return CLI_TelnetTest(local ? telnet->local : telnet->remote, option);
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
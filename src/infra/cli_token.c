@@ -0,0 +1,245 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_token.c
+  * @brief   Reentrant, zero-copy command line tokenizer.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_token.h" /* Module local include */
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/** @defgroup CLI_TOKEN CLI Token
+  * @brief CLI command line tokenizer module
+  * @{
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_TOKEN_Private_Functions CLI Token Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Bytes the tokenizer stops on: delimiters, quotes and escapes.
+ */
+
+static inline bool CLI_TokenIsSpecial(char c)
+{
+    return c == ' ' || c == '\t' || c == '"' || c == '\'' || c == '\\';
+}
+
+/**
+ * @brief
+ *  Offset of the first special byte at or past 'i', 'len' if none.
+ *  Scans 16 bytes at a time with SSE2, 8 bytes at a time (SWAR) elsewhere.
+ */
+
+static size_t CLI_TokenSpecial(const char *line, size_t i, size_t len)
+{
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab   = _mm_set1_epi8('\t');
+    const __m128i dquot = _mm_set1_epi8('"');
+    const __m128i squot = _mm_set1_epi8('\'');
+    const __m128i bslsh = _mm_set1_epi8('\\');
+
+    for ( ; i + 16 <= len; i += 16 )
+    {
+        __m128i  v = _mm_loadu_si128((const __m128i *) (line + i));
+        uint32_t mask;
+
+        mask = (uint32_t) _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                                         _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, dquot), _mm_cmpeq_epi8(v, squot)),
+                                                                      _mm_cmpeq_epi8(v, bslsh))));
+        if ( mask != 0 )
+            return i + (size_t) __builtin_ctz(mask);
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t low  = 0x7F7F7F7F7F7F7F7FULL;
+
+    for ( ; i + 8 <= len; i += 8 )
+    {
+        uint64_t w;
+        uint64_t found = 0;
+        uint64_t t;
+        int      k;
+
+        memcpy(&w, line + i, sizeof(w));
+
+        /* Exact per byte equality: the high bit of a byte is set once it is 0 after the xor. */
+        for ( k = 0; k < 5; k++ )
+        {
+            t      = w ^ (ones * (uint64_t) (unsigned char) " \t\"'\\"[k]);
+            found |= ~(((t & low) + low) | t | low);
+        }
+
+        if ( found )
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return i + (size_t) (__builtin_ctzll(found) / 8);
+#else
+            break;
+#endif
+        }
+    }
+#endif
+
+    while ( i < len && ! CLI_TokenIsSpecial(line[i]) ) i++;
+
+    return i;
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_TOKEN_Exported_Functions CLI Token Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Split a line into words, in a single pass and without touching it.
+  * @param line: The line, need not be NULL terminated.
+  * @param len: Line length, at most 65535.
+  * @param tokens: Out, the words views.
+  * @param max: Room in 'tokens'.
+  * @param count: Out, count of words.
+  * @retval CLI_TOKEN_OK, or the reason the line could not be tokenized.
+  */
+
+CLI_TokenStatusTypeDef CLI_Tokenize(const char *line, size_t len, CLI_TokenTypeDef *tokens, uint32_t max, uint32_t *count)
+{
+    size_t i = 0;
+    size_t start;
+    bool   plain;
+    char   c;
+
+    *count = 0;
+
+    while ( 1 )
+    {
+        while ( i < len && (line[i] == ' ' || line[i] == '\t') )
+            i++;
+
+        if ( i == len )
+            break;
+
+        if ( *count == max )
+            return CLI_TOKEN_TOO_MANY;
+
+        start = i;
+        plain = true;
+
+        /* Up to the next delimiter outside quotes. */
+        while ( (i = CLI_TokenSpecial(line, i, len)) < len )
+        {
+            c = line[i];
+            if ( c == ' ' || c == '\t' )
+                break;
+
+            plain = false;
+
+            if ( c == '\\' )
+                i = (i + 2 < len) ? i + 2 : len; /* A trailing '\' is kept as is */
+            else if ( c == '\'' )
+            {
+                const char *close = memchr(line + i + 1, '\'', len - i - 1);
+
+                if ( close == NULL )
+                    return CLI_TOKEN_UNTERMINATED;
+                i = (size_t) (close - line) + 1;
+            }
+            else
+            {
+                /* Double quotes, only escapes and the closing quote matter. */
+                for ( i++; (i = CLI_TokenSpecial(line, i, len)) < len && line[i] != '"'; i++ )
+                {
+                    if ( line[i] == '\\' )
+                        i++;
+                }
+
+                if ( i >= len )
+                    return CLI_TOKEN_UNTERMINATED;
+                i++;
+            }
+        }
+
+        tokens[*count].offset = (uint16_t) start;
+        tokens[*count].length = (uint16_t) (i - start);
+        tokens[*count].plain  = plain;
+        (*count)++;
+    }
+
+    return CLI_TOKEN_OK;
+}
+
+/**
+  * @brief  Write a word NULL terminated, its quotes and escapes resolved.
+  * @param line: The tokenized line.
+  * @param token: The word view.
+  * @param out: Out, room for 'token->length' + 1 bytes.
+  * @retval Length of the word.
+  */
+
+size_t CLI_TokenCopy(const char *line, const CLI_TokenTypeDef *token, char *out)
+{
+    const char *p     = line + token->offset;
+    const char *end   = p + token->length;
+    size_t      n     = 0;
+    char        quote = 0;
+    char        c;
+
+    if ( token->plain )
+    {
+        memcpy(out, p, token->length);
+        out[token->length] = '\0';
+        return token->length;
+    }
+
+    while ( p < end )
+    {
+        c = *p++;
+
+        if ( quote == '\'' )
+        {
+            if ( c == '\'' )
+                quote = 0;
+            else
+                out[n++] = c;
+        }
+        else if ( c == '\\' )
+            out[n++] = (p < end) ? *p++ : c;
+        else if ( quote == '"' )
+        {
+            if ( c == '"' )
+                quote = 0;
+            else
+                out[n++] = c;
+        }
+        else if ( c == '"' || c == '\'' )
+            quote = c;
+        else
+            out[n++] = c;
+    }
+
+    out[n] = '\0';
+    return n;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,264 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_trie.c
+  * @brief   Radix trie completion index over the sorted commands table.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cli_trie.h" /* Module local include */
+#include <string.h>
+
+/** @defgroup CLI_TRIE CLI Trie
+  * @brief CLI commands completion trie module
+  * @{
+  */
+
+/* Private define ------------------------------------------------------------*/
+/** @defgroup CLI_TRIE_Private_Define CLI Trie Private Define
+  * @{
+  */
+
+/* Name of sorted entry 'i' */
+#define CLI_TRIE_NAME(i) (names + nameOffs[i])
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_TRIE_Private_Functions CLI Trie Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  ASCII lower case, the table is lower cased while typed input may not be.
+ */
+
+static inline char CLI_TrieLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char) (c + 'a' - 'A') : c;
+}
+
+/**
+ * @brief
+ *  Length of the prefix two names share.
+ */
+
+static uint32_t CLI_TrieCommon(const char *a, const char *b)
+{
+    uint32_t i = 0;
+
+    while ( a[i] != 0 && a[i] == b[i] )
+        i++;
+
+    return i;
+}
+
+/**
+ * @brief
+ *  Eytzinger position (1 based) following 'pos' in sorted order, over 'n'
+ *  positions: the leftmost one of the right subtree if any, otherwise the
+ *  first ancestor reached from a left child. Pass 0 to get the first one.
+ */
+
+static uint32_t CLI_TrieNextPos(uint32_t pos, uint32_t n)
+{
+    if ( pos == 0 || 2 * pos + 1 <= n )
+    {
+        pos = (pos == 0) ? 1 : 2 * pos + 1;
+        while ( 2 * pos <= n )
+            pos *= 2;
+        return pos;
+    }
+
+    while ( pos & 1 )
+        pos >>= 1;
+
+    return pos >> 1;
+}
+
+/**
+ * @brief
+ *  Fill node 'idx' covering commands [first, first + count) and, depth first,
+ *  its children. The table is sorted, so the range shares the prefix its
+ *  first and last names share, a name ending right there sorts first and
+ *  the remaining names group by their next character.
+ */
+
+static void CLI_TrieFill(const char *names, const uint32_t *nameOffs, CLI_TrieNodeTypeDef *nodes, uint32_t idx, uint32_t first, uint32_t count,
+                         uint8_t label, uint32_t *used)
+{
+    CLI_TrieNodeTypeDef *node     = &nodes[idx];
+    uint32_t             end      = first + count;
+    uint32_t             depth    = CLI_TrieCommon(CLI_TRIE_NAME(first), CLI_TRIE_NAME(end - 1));
+    uint32_t             k        = first;
+    uint32_t             children = 0;
+    uint32_t             j;
+    uint32_t             pos;
+
+    node->first = first;
+    node->count = count;
+    node->depth = (uint16_t) depth;
+    node->label = label;
+
+    if ( CLI_TRIE_NAME(k)[depth] == 0 )
+        k++; /* Terminal, the name is the prefix itself */
+
+    /* Count the groups so that the children can be laid out next to each other. */
+    for ( j = k; j < end; j++ )
+    {
+        if ( j == k || CLI_TRIE_NAME(j)[depth] != CLI_TRIE_NAME(j - 1)[depth] )
+            children++;
+    }
+
+    node->children = (uint8_t) children;
+    node->child    = *used;
+    *used         += children;
+
+    /* Groups come in sorted order, their nodes go in Eytzinger order. */
+    for ( pos = CLI_TrieNextPos(0, children); k < end; pos = CLI_TrieNextPos(pos, children) )
+    {
+        for ( j = k + 1; j < end && CLI_TRIE_NAME(j)[depth] == CLI_TRIE_NAME(k)[depth]; j++ )
+            ;
+
+        CLI_TrieFill(names, nameOffs, nodes, node->child + pos - 1, k, j - k, (uint8_t) CLI_TRIE_NAME(k)[depth], used);
+        k = j;
+    }
+}
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_TRIE_Exported_Functions CLI Trie Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Upper bound of the nodes count: every node is a leaf, ends a name or
+  *         branches, hence at most two nodes per name.
+  * @param count: Count of commands.
+  * @retval Count of nodes to allocate.
+  */
+
+uint32_t CLI_TrieMaxNodes(uint32_t count)
+{
+    return count * 2;
+}
+
+/**
+  * @brief  Build the trie over sorted unique lower cased names.
+  * @param names: Names pool.
+  * @param nameOffs: Offset of each name in 'names', in sorted order.
+  * @param count: Count of names, must not be 0.
+  * @param nodes: Out, room for CLI_TrieMaxNodes() nodes, the root is nodes[0].
+  * @retval Count of nodes used.
+  */
+
+uint32_t CLI_TrieBuild(const char *names, const uint32_t *nameOffs, uint32_t count, CLI_TrieNodeTypeDef *nodes)
+{
+    uint32_t used = 1;
+
+    CLI_TrieFill(names, nameOffs, nodes, 0, 0, count, 0, &used);
+
+    return used;
+}
+
+/**
+  * @brief  Find the commands starting with a prefix (any case).
+  * @param nodes: Trie, NULL to scan the names instead.
+  * @param names: Names pool the trie was built over.
+  * @param nameOffs: Offset of each name in 'names', in sorted order.
+  * @param count: Count of names.
+  * @param prefix: Typed prefix.
+  * @param len: Prefix length.
+  * @param first: Out, first matching command.
+  * @param matches: Out, count of matching commands, they follow 'first'.
+  * @param common: Out, length of the prefix shared by all matching commands.
+  * @retval boolean, true if anything matched.
+  */
+
+bool CLI_TrieFind(const CLI_TrieNodeTypeDef *nodes, const char *names, const uint32_t *nameOffs, uint32_t count, const char *prefix,
+                  uint32_t len, uint32_t *first, uint32_t *matches, uint32_t *common)
+{
+    const CLI_TrieNodeTypeDef *node;
+    const CLI_TrieNodeTypeDef *child;
+    uint32_t                   pos;
+    uint32_t                   p;
+    uint8_t                    c;
+
+    if ( count == 0 )
+        return false;
+
+    if ( nodes == NULL )
+    {
+        /* No index, matches are still contiguous in the sorted names. */
+        for ( *first = 0; *first < count; (*first)++ )
+        {
+            for ( p = 0; p < len && (uint8_t) CLI_TRIE_NAME(*first)[p] == (uint8_t) CLI_TrieLower(prefix[p]); p++ )
+                ;
+            if ( p == len )
+                break;
+        }
+
+        for ( *matches = 0; *first + *matches < count; (*matches)++ )
+        {
+            for ( p = 0; p < len && (uint8_t) CLI_TRIE_NAME(*first + *matches)[p] == (uint8_t) CLI_TrieLower(prefix[p]); p++ )
+                ;
+            if ( p != len )
+                break;
+        }
+
+        if ( *matches == 0 )
+            return false;
+
+        *common = CLI_TrieCommon(CLI_TRIE_NAME(*first), CLI_TRIE_NAME(*first + *matches - 1));
+        return true;
+    }
+
+    node = &nodes[0];
+    for ( p = 0; p < len; p++ )
+    {
+        c = (uint8_t) CLI_TrieLower(prefix[p]);
+
+        /* Within this node shared prefix. */
+        if ( p < node->depth )
+        {
+            if ( (uint8_t) CLI_TRIE_NAME(node->first)[p] != c )
+                return false;
+            continue;
+        }
+
+        /* Past it, step into the child labeled 'c': a branchless lower bound
+         * over the Eytzinger ordered labels, the exit position holds it. */
+        child = &nodes[node->child];
+        for ( pos = 1; pos <= node->children; )
+            pos = 2 * pos + (child[pos - 1].label < c);
+        pos >>= __builtin_ffs((int) ~pos);
+
+        if ( pos == 0 || child[pos - 1].label != c )
+            return false;
+
+        node = &child[pos - 1];
+    }
+
+    *first   = node->first;
+    *matches = node->count;
+    *common  = node->depth;
+
+    return true;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -16,10 +16,12 @@
 #define __CLI_H__
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include "infra.h"
+#include "cli_io.h"
 
 /** @addtogroup CLI
  * @{
@@ -32,31 +34,44 @@
 
 #define CLI_CONTROL_FLOW_ENABLE (CONFIG_CLI_CONTROL_FLOW_ENABLE)
 
+/* CLI task input mode: when set the task blocks on the input descriptor and
+ * wakes up only when bytes arrive, otherwise the input is polled periodically. */
+#ifndef CLI_EVENT_DRIVEN_RX
+#define CLI_EVENT_DRIVEN_RX 1
+#endif
+
+/* Input poll period in milliseconds (polling input mode only). */
+#ifndef CLI_POLL_INTERVAL_MS
+#define CLI_POLL_INTERVAL_MS 5
+#endif
+
 /* Max number of typed CLI commands remembered by CLI engine. */
 #define CLI_MAX_HISTORY_LINES 10
 
-/* Max number of bytes for the UART printf buffer */
-#define CLI_MAX_UART_BUFFER_LEN 256
+/* Default size of the output ring in bytes (see CLI_InitTypeDef.outBufferSize) */
+#define CLI_OUT_BUFFER_SIZE 1024
+
+/* Default size of the typeahead queue in bytes, rounded up to a power of two
+ * (see CLI_InitTypeDef.typeaheadSize) */
+#define CLI_TYPEAHEAD_SIZE 256
 
 /* Max CLI command line length allowed to type including delimiters,
  * includes termination zero character. */
 #define CLI_MAX_LINE_LENGTH 80
 
-/* Max number of completion suggestions supported. */
-#define CLI_MAX_COMPLETIONS 32
-
 /* Max size of CLI prompt, including termination zero character. */
 #define CLI_MAX_PROMPT 10
 
-/* Maximum bytes allowed for a command name */
-#define CLI_MAX_COMMAND_NAME_LEN 12
-
 /* Max number of CLI command parameters. */
 #define CLI_MAX_NUM_PARAMS 15
 
 /* Return value reserved for re-setting (prevents echoing the prompt) */
 #define CLI_RESET_CMD -10
 
+/* Command flags (CLI_CmdTypeDef.flags) */
+#define CLI_CMD_FLAG_ASYNC 0x01 /* Run on the jobs worker pool, see cli_jobs.h */
+#define CLI_CMD_FLAG_LAZY  0x02 /* Stub of a plugin command not loaded yet, see cli_plugin.h */
+
 /* Convert commands to lower case (only in dynamic mode) */
 #define CLI_FORCE_LOWER_CASE 1
 
@@ -66,7 +81,7 @@
     {                                       \
         if ( argc == 2 && *argv[0] == '@' ) \
         {                                   \
-            printf(str);                    \
+            CLI_Printf("%s", str);          \
             return EXIT_SUCCESS;            \
         }                                   \
     }
@@ -84,11 +99,38 @@
   * @{
   */
 
-/** @brief CLI command descriptor structure. */
-typedef struct
+/** @brief CLI context (console session) handle, see CLI_ContextCreate(). */
+typedef struct __CLI_ContextTypeDef CLI_Context;
+
+/** @brief Completion trie node, see cli_trie.h. */
+typedef struct __CLI_TrieNodeTypeDef CLI_TrieNodeTypeDef;
+
+/** @brief Perfect hash slot, see cli_hash.h. */
+typedef struct __CLI_HashSlotTypeDef CLI_HashSlotTypeDef;
+
+/** @brief Command arguments schema, see cli_args.h. */
+typedef struct __CLI_ArgsSchemaTypeDef CLI_ArgsSchemaTypeDef;
+
+/** @brief Called when a context has a state pending for CLI_ContextProcessState(). */
+typedef void (*__cli_alert)(CLI_Context *ctx, void *arg);
+
+/** @brief A level of the commands tree, see CLI_CmdNodeTypeDef. */
+typedef struct __CLI_CmdNodeTypeDef CLI_CmdNodeTypeDef;
+
+/** @brief CLI command descriptor structure.
+  *        Subcommands are declared by their path, "net if show", each word
+  *        selecting the next level. Levels nobody declares a handler for are
+  *        groups, they only hold subcommands. A subcommand handler gets the
+  *        whole path as argv[0].
+  *        Commands declaring an arguments schema have them validated before
+  *        the handler is called, which then reads them typed (CLI_GetArgs()). */
+typedef struct __CLI_CmdTypeDef
 {
-    int (*pHandler)(int argc, char **argv); /*!< Pointer to CLI command handler function */
-    char Name[CLI_MAX_COMMAND_NAME_LEN];    /*!< Command name, as it should be typed on CLI prompt */
+    int (*pHandler)(int argc, char **argv); /*!< Pointer to CLI command handler function, NULL for a group */
+    const char *Name;                       /*!< Command name (or path), as it should be typed on CLI prompt */
+    uint32_t flags;                         /*!< CLI_CMD_FLAG_xxx */
+    const CLI_ArgsSchemaTypeDef *args;      /*!< Arguments schema, NULL for a handler parsing argv itself */
+    const CLI_CmdNodeTypeDef *subCmnds;     /*!< Subcommands, set in built tables only (Name is then a single word) */
 } CLI_CmdTypeDef;
 
 /** @defgroup CLI_ExtHandlers CLI External Handlers
@@ -114,7 +156,7 @@ typedef struct
     __cli_stristr stristr; /*!< Function to find a substring case-insensitively */
     __cli_strtrim strtrim; /*!< Function to trim a string */
     __cli_strlwr  strlwr;  /*!< Function to convert a string to lower case */
-    __cli_itoa    itoa;    /*!< Function to convert an integer to a string */
+    __cli_itoa    itoa;    /*!< Function to convert an integer to a string, the engine formats its own through cli_num.h */
     __cli_stricmp stricmp; /*!< Function to compare strings case-insensitively */
 } CLI_ExtHandlersTypDef;
 
@@ -126,8 +168,46 @@ typedef struct
     bool                  autoLowerCase;          /*!< Auto set user input to lower case */
     bool                  echo;                   /*!< Local echo */
     char                  prompt[CLI_MAX_PROMPT]; /*!< Product prompt, this will prefix the prompt '>' symbol */
+    uint32_t              outBufferSize;          /*!< Output ring size in bytes, 0 for CLI_OUT_BUFFER_SIZE */
+    uint32_t              typeaheadSize;          /*!< Typeahead queue size in bytes, 0 for CLI_TYPEAHEAD_SIZE */
+    CLI_IoTypeDef        *io;                     /*!< I/O backend, NULL for stdin input and 'handlers.putc' output */
+    __cli_alert           alert;                  /*!< Pending state notification, NULL to process states inline (CLI_ContextCreate() only) */
+    void                 *alertArg;               /*!< Argument passed to 'alert' */
 } CLI_InitTypeDef;
 
+/** @brief CLI output counters */
+typedef struct
+{
+    uint32_t writeCalls;        /*!< Write syscalls issued so far */
+    uint32_t bytesWritten;      /*!< Bytes written so far */
+    uint32_t lastCmdWriteCalls; /*!< Write syscalls issued from submitting the last command line up to its prompt */
+} CLI_OutStatsTypeDef;
+
+/** @brief CLI typeahead queue counters */
+typedef struct
+{
+    uint32_t size;      /*!< Queue capacity in bytes */
+    uint32_t pending;   /*!< Bytes currently queued */
+    uint32_t highWater; /*!< Most bytes ever queued at once */
+    uint32_t overflows; /*!< Bytes that did not fit in the queue */
+} CLI_TypeaheadStatsTypeDef;
+
+/** @brief A level of the merged commands tree, its own commands sorted and
+  *        indexed. Built by CLI_BuildTable(), or at build time (CLI_STATIC_TABLE).
+  *        Split hot / cold: lookups and completion only read the names pool,
+  *        the offsets and the indexes, the commands themselves are read once
+  *        one was found (or to list them). */
+struct __CLI_CmdNodeTypeDef
+{
+    const CLI_CmdTypeDef      *cmnds;     /*!< Cold: sorted, lower cased unique commands, followed by a zeroed entry */
+    const char                *names;     /*!< Hot: the level names, NULL terminated back to back in commands order */
+    const uint32_t            *nameOffs;  /*!< Hot: offset of each command name in 'names' */
+    const int32_t             *hashDisp;  /*!< Perfect hash seeds, see CLI_HashBuild(), NULL to scan */
+    const CLI_HashSlotTypeDef *hashSlots; /*!< Perfect hash slots: name hash, name offset and command index */
+    const CLI_TrieNodeTypeDef *trie;      /*!< Completion trie, see CLI_TrieBuild(), NULL to scan */
+    uint32_t                   count;     /*!< Count of commands */
+};
+
 /**
  * @}
  */
@@ -137,18 +217,56 @@ typedef struct
  * @{
  */
 
-bool            CLI_Init(CLI_InitTypeDef *cliInit);
-void            CLI_ResetState(void);
-bool            CLI_ProcessChar(unsigned char c);
-int             CLI_InjectCommands(const CLI_CmdTypeDef *pCommand, int count);
-bool            CLI_BuildTable(void);
-CLI_CmdTypeDef *CLI_GetCommandsPtr(void);
-void            CLI_PrintPrompt(int addCrLfCnt);
-int             CLI_GetCommandCnt(void);
-bool            CLI_ProcessState(void);
+bool                  CLI_Init(CLI_InitTypeDef *cliInit);
+void                  CLI_ResetState(void);
+bool                  CLI_ProcessChar(unsigned char c);
+size_t                CLI_ProcessBytes(const unsigned char *buf, size_t len);
+int                   CLI_InjectCommands(const CLI_CmdTypeDef *pCommand, int count);
+int                   CLI_RemoveCommands(const CLI_CmdTypeDef *pCommand);
+int                   CLI_ReplaceCommands(const CLI_CmdTypeDef *pCommand, const CLI_CmdTypeDef *pWith, int count);
+bool                  CLI_BuildTable(void);
+const CLI_CmdTypeDef *CLI_GetCommandsPtr(void);
+void                  CLI_PrintPrompt(int addCrLfCnt);
+int                   CLI_GetCommandCnt(void);
+int                   CLI_Printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+int                   CLI_VPrintf(const char *format, va_list args) __attribute__((format(printf, 1, 0)));
+void                  CLI_Write(const char *buf, size_t len);
+void                  CLI_Flush(void);
+void                  CLI_GetOutStats(CLI_OutStatsTypeDef *stats);
+size_t                CLI_Typeahead(const unsigned char *buf, size_t len);
+void                  CLI_GetTypeaheadStats(CLI_TypeaheadStatsTypeDef *stats);
+bool                  CLI_ProcessState(void);
+
+#ifdef CLI_STATIC_TABLE
+/* Emitted by the table generator from the modules '.def' files, see Makefile */
+extern const CLI_CmdNodeTypeDef gCliStaticTable;
+#endif
+
+/* Context (console session) interface, the commands table is shared */
+CLI_Context *CLI_ContextCreate(CLI_InitTypeDef *cliInit);
+void         CLI_ContextDestroy(CLI_Context *ctx);
+bool         CLI_ContextProcessChar(CLI_Context *ctx, unsigned char c);
+size_t       CLI_ContextProcessBytes(CLI_Context *ctx, const unsigned char *buf, size_t len);
+bool         CLI_ContextProcessState(CLI_Context *ctx);
+void         CLI_ContextResetState(CLI_Context *ctx);
+void         CLI_ContextPrintPrompt(CLI_Context *ctx, int addCrLfCnt);
+void         CLI_ContextGetOutStats(CLI_Context *ctx, CLI_OutStatsTypeDef *stats);
+void         CLI_ContextFlush(CLI_Context *ctx);
+bool         CLI_ContextOutPending(CLI_Context *ctx);
+size_t       CLI_ContextTypeahead(CLI_Context *ctx, const unsigned char *buf, size_t len);
+void         CLI_ContextGetTypeaheadStats(CLI_Context *ctx, CLI_TypeaheadStatsTypeDef *stats);
+void         CLI_ContextEnd(CLI_Context *ctx);
+bool         CLI_ContextIsEnded(CLI_Context *ctx);
+CLI_Context *CLI_GetDefaultContext(void);
+CLI_Context *CLI_GetCurrentContext(void);
+
+/* Jobs interface */
+void CLI_ContextAlert(CLI_Context *ctx);
+void CLI_ContextWrite(CLI_Context *ctx, const char *buf, size_t len);
+void CLI_ContextWait(CLI_Context *ctx, uint32_t jobId);
 
 /* Auxiliary task interface */
-bool CLI_InitTask(void);
+bool CLI_InitTask(CLI_IoTypeDef *io);
 void CLI_TaskAlert(void);
 void CLI_TaskTerminate(void);
 
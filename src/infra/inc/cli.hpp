@@ -0,0 +1,393 @@
+/**
+ ******************************************************************************
+ * @file    cli.hpp
+ * @brief   Header only C++20 layer over the CLI engine: typed commands.
+ *          A command is declared by its name and argument types,
+ *
+ *              cli::inject(cli::command<"add", long, long>(add, "Add 2 numbers."),
+ *                          cli::async_command<"diag", std::optional<int>>(diag));
+ *
+ *          and its handler takes typed values rather than argv,
+ *
+ *              int add(long a, long b);
+ *              int diag(std::string_view path, std::optional<int> seconds);
+ *
+ *          The argument types expand at compile time into the command
+ *          arguments schema (see cli_args.h), so the engine validates them,
+ *          writes the usage text and completes them as for any C command. The
+ *          names are checked and the table sorted at compile time, then
+ *          injected through CLI_InjectCommands() as is.
+ *
+ *          Argument types:
+ *           - integers, bounded by their type (64 bits ones by int64_t).
+ *           - bool, typed as false|true|off|on.
+ *           - std::string_view, the word as typed.
+ *           - cli::hex<T>, an integer typed in hexadecimal.
+ *           - cli::choice<"a|b|c">, one of the listed words.
+ *           - std::optional<T>, may be left out, and so may the following
+ *             arguments.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_HPP__
+#define __CLI_HPP__
+
+/* Includes ------------------------------------------------------------------*/
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "cli.h"
+#include "cli_args.h"
+}
+
+/** @addtogroup CLI_CPP
+ * @{
+ */
+
+namespace cli
+{
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_CPP_Exported_Types CLI C++ Exported Types
+  * @{
+  */
+
+/** @brief A string usable as a template argument: command names and choices */
+template <std::size_t N>
+struct fixed_string
+{
+    char value[N] = {}; /*!< NULL terminated text */
+
+    constexpr fixed_string(const char (&text)[N]) { std::copy_n(text, N, value); }
+    constexpr std::string_view view() const { return {value, N - 1}; }
+};
+
+/** @brief An integer argument typed in hexadecimal, '0x' prefix optional */
+template <typename T>
+struct hex
+{
+    static_assert(std::is_integral_v<T> && ! std::is_same_v<T, bool>, "cli::hex<T> takes an integer type");
+
+    T value; /*!< Typed value */
+};
+
+/** @brief An argument typed as one of the '|' separated 'Choices' (any case) */
+template <fixed_string Choices>
+struct choice
+{
+    std::size_t      index; /*!< Index of the typed choice */
+    std::string_view text;  /*!< The choice, as typed */
+};
+
+/**
+  * @}
+  */
+
+/** @defgroup CLI_CPP_Private CLI C++ Private
+  * @{
+  */
+
+namespace detail
+{
+
+/**
+ * @brief
+ *  Per type argument declaration and conversion from the validated value.
+ */
+
+template <typename T>
+struct arg_traits;
+
+template <typename T>
+    requires(std::is_integral_v<T> && ! std::is_same_v<T, bool>)
+struct arg_traits<T>
+{
+    static constexpr bool wide = std::numeric_limits<T>::digits >= 63;
+
+    /* 64 bits types are only bounded by the parser, unsigned ones by int64_t. */
+    static constexpr CLI_ArgTypeDef decl(CLI_ArgTypeTypeDef type = CLI_ARG_INT)
+    {
+        if constexpr ( wide && std::is_signed_v<T> )
+            return {"int", type, false, 0, 0, nullptr, nullptr};
+        else
+            return {std::is_signed_v<T> ? "int" : "uint", type, false, static_cast<int64_t>(std::numeric_limits<T>::min()),
+                    wide ? std::numeric_limits<int64_t>::max() : static_cast<int64_t>(std::numeric_limits<T>::max()), nullptr, nullptr};
+    }
+
+    static T get(const CLI_ArgValueTypeDef &value) { return static_cast<T>(value.num); }
+};
+
+template <>
+struct arg_traits<bool>
+{
+    static constexpr CLI_ArgTypeDef decl() { return {"bool", CLI_ARG_ENUM, false, 0, 0, "false|true|off|on", nullptr}; }
+    static bool                     get(const CLI_ArgValueTypeDef &value) { return (value.num % 2) != 0; }
+};
+
+template <>
+struct arg_traits<std::string_view>
+{
+    static constexpr CLI_ArgTypeDef decl() { return {"text", CLI_ARG_STRING, false, 0, 0, nullptr, nullptr}; }
+    static std::string_view         get(const CLI_ArgValueTypeDef &value) { return {value.str, static_cast<std::size_t>(value.num)}; }
+};
+
+template <typename T>
+struct arg_traits<hex<T>>
+{
+    static constexpr CLI_ArgTypeDef decl()
+    {
+        CLI_ArgTypeDef arg = arg_traits<T>::decl(CLI_ARG_HEX);
+
+        arg.name = "hex";
+        return arg;
+    }
+
+    static hex<T> get(const CLI_ArgValueTypeDef &value) { return {static_cast<T>(value.num)}; }
+};
+
+template <fixed_string Choices>
+struct arg_traits<choice<Choices>>
+{
+    static constexpr CLI_ArgTypeDef decl() { return {"choice", CLI_ARG_ENUM, false, 0, 0, Choices.value, nullptr}; }
+
+    static choice<Choices> get(const CLI_ArgValueTypeDef &value)
+    {
+        return {static_cast<std::size_t>(value.num), std::string_view(value.str)};
+    }
+};
+
+template <typename T>
+struct arg_traits<std::optional<T>>
+{
+    static constexpr CLI_ArgTypeDef decl()
+    {
+        CLI_ArgTypeDef arg = arg_traits<T>::decl();
+
+        arg.optional = true;
+        return arg;
+    }
+
+    static std::optional<T> get(const CLI_ArgValueTypeDef &value)
+    {
+        if ( value.present == false )
+            return std::nullopt;
+        return arg_traits<T>::get(value);
+    }
+};
+
+template <typename T>
+inline constexpr bool is_optional = false;
+
+template <typename T>
+inline constexpr bool is_optional<std::optional<T>> = true;
+
+/**
+ * @brief
+ *  Optional arguments may only be followed by optional ones.
+ */
+
+template <typename... Args>
+constexpr bool optionals_trail()
+{
+    constexpr bool optional[] = {is_optional<Args>..., true};
+    bool           seen       = false;
+
+    for ( std::size_t i = 0; i < sizeof...(Args); i++ )
+    {
+        if ( seen && ! optional[i] )
+            return false;
+        seen = seen || optional[i];
+    }
+
+    return true;
+}
+
+/**
+ * @brief
+ *  A command path the engine would keep as is: lower case words separated by
+ *  single spaces.
+ */
+
+constexpr bool path_is_normal(std::string_view path)
+{
+    if ( path.empty() || path.front() == ' ' || path.back() == ' ' )
+        return false;
+
+    for ( std::size_t i = 0; i < path.size(); i++ )
+    {
+        const char c = path[i];
+
+        if ( (c >= 'A' && c <= 'Z') || c == '\t' || c == '\r' || c == '\n' || (c == ' ' && path[i + 1] == ' ') )
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief
+ *  Handler storage and the C handler calling it, one per command.
+ */
+
+template <fixed_string Name, typename... Args>
+struct slot
+{
+    using handler_type = std::function<int(std::string_view, Args...)>;
+
+    static inline handler_type fn;             /* Typed handler */
+    static inline const char  *help = nullptr; /* Help text */
+
+    /* The schema the engine validates the arguments against. */
+    static constexpr std::array<CLI_ArgTypeDef, sizeof...(Args)> argList = {arg_traits<Args>::decl()...};
+    static constexpr CLI_ArgsSchemaTypeDef                        schema  = {argList.data(), sizeof...(Args)};
+
+    template <std::size_t... I>
+    static int invoke(std::string_view path, const CLI_ArgsTypeDef *args, std::index_sequence<I...>)
+    {
+        return fn(path, arg_traits<Args>::get(args->values[I])...);
+    }
+
+    static int handler(int argc, char **argv)
+    {
+        const CLI_ArgsTypeDef *args = CLI_GetArgs();
+
+        /* Dump help and exit, see CLI_SHOW_HELP(). */
+        if ( argc == 2 && *argv[0] == '@' )
+        {
+            CLI_Printf("%s", (help != nullptr) ? help : "");
+            return EXIT_SUCCESS;
+        }
+
+        /* Not called by the engine, or the command object is gone. */
+        if ( args == nullptr || ! fn )
+            return EXIT_FAILURE;
+
+        return invoke(argv[0], args, std::index_sequence_for<Args...>{});
+    }
+};
+
+/**
+ * @brief
+ *  Commands ordered the way CLI_BuildTable() sorts them, so that injecting
+ *  them costs a single pass.
+ */
+
+template <typename... Commands>
+constexpr std::array<CLI_CmdTypeDef, sizeof...(Commands)> sorted_table()
+{
+    std::array<CLI_CmdTypeDef, sizeof...(Commands)> table = {Commands::entry()...};
+
+    std::sort(table.begin(), table.end(),
+              [](const CLI_CmdTypeDef &a, const CLI_CmdTypeDef &b) { return std::string_view(a.Name) < std::string_view(b.Name); });
+    return table;
+}
+
+template <std::size_t N>
+constexpr bool names_unique(const std::array<CLI_CmdTypeDef, N> &table)
+{
+    for ( std::size_t i = 1; i < N; i++ )
+    {
+        if ( std::string_view(table[i - 1].Name) == std::string_view(table[i].Name) )
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace detail
+
+/**
+  * @}
+  */
+
+/** @addtogroup CLI_CPP_Exported_Types
+  * @{
+  */
+
+/**
+  * @brief  A typed command. Constructing it sets its handler, injecting it
+  *         (cli::inject()) registers it. The handler takes the typed
+  *         arguments, optionally preceded by the command path.
+  */
+
+template <fixed_string Name, uint32_t Flags, typename... Args>
+class basic_command
+{
+    static_assert(detail::path_is_normal(Name.view()), "command names are lower case words separated by single spaces");
+    static_assert(sizeof...(Args) <= CLI_MAX_NUM_PARAMS - 1, "more arguments than CLI_MAX_NUM_PARAMS allows");
+    static_assert(detail::optionals_trail<Args...>(), "only optional arguments may follow an optional one");
+
+    using slot = detail::slot<Name, Args...>;
+
+public:
+    template <typename F>
+        requires std::is_invocable_r_v<int, F, std::string_view, Args...> || std::is_invocable_r_v<int, F, Args...>
+    explicit basic_command(F fn, const char *help = nullptr)
+    {
+        if constexpr ( std::is_invocable_r_v<int, F, std::string_view, Args...> )
+            slot::fn = std::move(fn);
+        else
+            slot::fn = [fn = std::move(fn)](std::string_view, Args... args) { return fn(std::move(args)...); };
+        slot::help = help;
+    }
+
+    /** @brief The table entry, constant: handler, name and schema are static. */
+    static constexpr CLI_CmdTypeDef entry() { return {&slot::handler, Name.value, Flags, &slot::schema, nullptr}; }
+};
+
+/** @brief A command running right in the session */
+template <fixed_string Name, typename... Args>
+using command = basic_command<Name, 0, Args...>;
+
+/** @brief A command running on the jobs worker pool, see cli_jobs.h */
+template <fixed_string Name, typename... Args>
+using async_command = basic_command<Name, CLI_CMD_FLAG_ASYNC, Args...>;
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup CLI_CPP_Exported_Functions CLI C++ Exported Functions
+  * @{
+  */
+
+/**
+  * @brief  Register typed commands. The table is sorted and its names checked
+  *         at compile time, it lives as long as the program.
+  * @param commands: The commands, their handlers are set.
+  * @retval See CLI_InjectCommands().
+  */
+
+template <typename... Commands>
+int inject(const Commands &...commands)
+{
+    static constexpr auto table = detail::sorted_table<Commands...>();
+    static_assert(detail::names_unique(table), "a command name is declared twice");
+
+    (static_cast<void>(commands), ...);
+    return CLI_InjectCommands(table.data(), static_cast<int>(table.size()));
+}
+
+/**
+  * @}
+  */
+
+} // namespace cli
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_HPP__ */
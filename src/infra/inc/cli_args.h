@@ -0,0 +1,101 @@
+/**
+ ******************************************************************************
+ * @file    cli_args.h
+ * @brief   Typed command arguments. A command may declare the arguments it
+ *          takes (count, types, ranges, defaults) in its table entry, the
+ *          engine then validates them once before calling the handler, which
+ *          reads them back typed through CLI_GetArgs(). The same schema
+ *          provides the usage text and the arguments completion.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_ARGS_H__
+#define __CLI_ARGS_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cli.h"
+
+/** @addtogroup CLI_ARGS
+ * @{
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_ARGS_Exported_Types CLI Args Exported Types
+  * @{
+  */
+
+/** @brief Argument types */
+typedef enum
+{
+    CLI_ARG_INT = 0, /*!< Integer: decimal, '0x' hexadecimal, '0b' binary or sized (4k, 1M), 'num' holds it */
+    CLI_ARG_HEX,     /*!< Hexadecimal integer, '0x' prefix optional, 'num' holds it */
+    CLI_ARG_ENUM,    /*!< One of 'choices' (any case), 'num' holds its index */
+    CLI_ARG_STRING,  /*!< Any text, 'num' holds its length */
+} CLI_ArgTypeTypeDef;
+
+/** @brief A declared argument */
+typedef struct
+{
+    const char        *name;     /*!< Shown in the usage text */
+    CLI_ArgTypeTypeDef type;     /*!< Argument type */
+    bool               optional; /*!< May be left out, every argument following it as well */
+    int64_t            min;      /*!< INT, HEX: lowest value, STRING: shortest length */
+    int64_t            max;      /*!< INT, HEX: highest value, STRING: longest length, min == max == 0 for no bounds */
+    const char        *choices;  /*!< ENUM: choices separated by '|' */
+    const char        *def;      /*!< Value of a left out optional argument, as it would be typed, NULL for none */
+} CLI_ArgTypeDef;
+
+/** @brief Arguments a command takes, following its name */
+struct __CLI_ArgsSchemaTypeDef
+{
+    const CLI_ArgTypeDef *args;  /*!< Arguments, in order */
+    uint32_t              count; /*!< Count of arguments */
+};
+
+/** @brief A validated argument */
+typedef struct
+{
+    bool        present; /*!< Typed or defaulted */
+    int64_t     num;     /*!< Typed value, see CLI_ArgTypeTypeDef */
+    const char *str;     /*!< Text as typed (quotes resolved), or the default */
+} CLI_ArgValueTypeDef;
+
+/** @brief Validated arguments of the running command */
+typedef struct
+{
+    uint32_t            count;                      /*!< Count of arguments typed */
+    CLI_ArgValueTypeDef values[CLI_MAX_NUM_PARAMS]; /*!< Values, in the schema order */
+} CLI_ArgsTypeDef;
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_ARGS_Exported_Functions CLI Args Exported Functions
+ * @{
+ */
+
+/* Command handlers interface */
+const CLI_ArgsTypeDef *CLI_GetArgs(void);
+
+/* Engine interface */
+bool                   CLI_ArgsParse(const CLI_ArgsSchemaTypeDef *schema, int argc, char **argv, CLI_ArgsTypeDef *args, char *error, size_t size);
+const CLI_ArgsTypeDef *CLI_ArgsSwap(const CLI_ArgsTypeDef *args);
+size_t                 CLI_ArgsUsage(const CLI_ArgsSchemaTypeDef *schema, char *buf, size_t size);
+uint32_t               CLI_ArgsComplete(const CLI_ArgTypeDef *arg, const char *prefix, size_t len, const char **choices, size_t *lengths, uint32_t max);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_ARGS_H__ */
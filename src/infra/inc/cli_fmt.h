@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @file    cli_fmt.h
+ * @brief   Formatted output for the console, free of stdio: no FILE lock, no
+ *          locale, no allocation. The text is handed to a sink as it is
+ *          formatted, in pieces (literal runs, padding, numbers), so that it
+ *          lands straight in the session output ring rather than being
+ *          staged and truncated in an intermediate buffer.
+ *
+ *          Conversions:
+ *           - %d %i          signed integers.
+ *           - %u %o %x %X    unsigned integers, decimal, octal, hexadecimal.
+ *           - %f %F          double in fixed point, up to 9 fractional digits
+ *                            computed (further ones are zeros) and 17
+ *                            significant ones.
+ *           - %c %s          character, string ('(null)' for NULL).
+ *           - %p             pointer, '0x' hexadecimal ('(nil)' for NULL).
+ *           - %%             a '%'.
+ *          With the '-', '0', '+', ' ' and '#' flags, width and precision
+ *          (numbers or '*') and the hh, h, l, ll, z, j and t length
+ *          modifiers. %e, %g, %a, %n and the L modifier are not supported,
+ *          unknown conversions are written as is: the printf format attribute
+ *          of the callers does not catch them.
+ *
+ *          A '%s' width counts terminal columns rather than bytes: ANSI
+ *          escape sequences (the ansi.h styles) take none and a UTF-8
+ *          character takes one, so that styled text lines up.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_FMT_H__
+#define __CLI_FMT_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <stddef.h>
+
+/** @addtogroup CLI_FMT
+ * @{
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_FMT_Exported_Types CLI Fmt Exported Types
+  * @{
+  */
+
+/** @brief Receives the formatted text, piece by piece */
+typedef void (*CLI_FmtSinkTypeDef)(void *arg, const char *buf, size_t len);
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_FMT_Exported_Functions CLI Fmt Exported Functions
+ * @{
+ */
+
+size_t CLI_FmtVPrint(CLI_FmtSinkTypeDef sink, void *arg, const char *format, va_list args);
+size_t CLI_FmtString(char *buf, size_t size, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_FMT_H__ */
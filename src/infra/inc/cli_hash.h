@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @file    cli_hash.h
+ * @brief   Minimal perfect hash over the merged commands table. Built at
+ *          runtime by CLI_BuildTable() or at build time by the table
+ *          generator (tools/cli_tablegen.c), both produce the same layout.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_HASH_H__
+#define __CLI_HASH_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cli.h"
+
+/** @addtogroup CLI_HASH
+ * @{
+ */
+
+/* Exported macro ------------------------------------------------------------*/
+/** @defgroup CLI_HASH_Exported_Macros CLI Hash Exported Macros
+ * @{
+ */
+
+/* Seeds tried per bucket before giving up on the hash. */
+#define CLI_HASH_MAX_SEED (1U << 16)
+
+/**
+ * @}
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_HASH_Exported_Types CLI Hash Exported Types
+  * @{
+  */
+
+/** @brief Perfect hash slot, everything a lookup reads once the slot is known */
+struct __CLI_HashSlotTypeDef
+{
+    uint32_t key;     /*!< Seed 0 hash of the name, a mismatch rules the looked up name out */
+    uint32_t nameOff; /*!< Offset of the name in the names pool */
+    uint32_t index;   /*!< Name (command) index */
+};
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_HASH_Exported_Functions CLI Hash Exported Functions
+ * @{
+ */
+
+uint32_t                   CLI_HashName(const char *name, uint32_t seed);
+bool                       CLI_HashBuild(const char *names, const uint32_t *nameOffs, uint32_t count, int32_t *disp, CLI_HashSlotTypeDef *slots,
+                                         __cli_malloc pMalloc, __cli_free pFree);
+const CLI_HashSlotTypeDef *CLI_HashLookup(const int32_t *disp, const CLI_HashSlotTypeDef *slots, uint32_t count, const char *name);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_HASH_H__ */
@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ * @file    cli_io.h
+ * @brief   CLI I/O backends: block oriented read / write callbacks the CLI
+ *          engine and task use to talk to whatever transport carries the
+ *          console. Built-in backends are provided for terminals, pipes,
+ *          connected sockets and an in-memory loopback.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_IO_H__
+#define __CLI_IO_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/** @addtogroup CLI_IO
+ * @{
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_IO_Exported_Types CLI I/O Exported Types
+  * @{
+  */
+
+struct __CLI_IoTypeDef;
+
+/** @brief Backend callbacks, the semantic follows read(2) / writev(2):
+ *         'read' must not block and fails with EAGAIN when there is nothing to
+ *         read, it returns 0 at end of input. 'writev' may write partially or
+ *         fail with EAGAIN, the engine then waits for 'outFd' to become writable.
+ *         Without 'outFd' the unsent output is kept, the owner of the context
+ *         resumes it with CLI_ContextFlush() once the backend has room. */
+typedef struct
+{
+    ssize_t (*read)(struct __CLI_IoTypeDef *io, void *buf, size_t len);                 /*!< Non blocking block read */
+    ssize_t (*writev)(struct __CLI_IoTypeDef *io, const struct iovec *iov, int iovcnt); /*!< Block write */
+    void (*close)(struct __CLI_IoTypeDef *io);                                          /*!< Release the backend, optional */
+} CLI_IoOpsTypeDef;
+
+/** @brief I/O backend instance */
+typedef struct __CLI_IoTypeDef
+{
+    const CLI_IoOpsTypeDef *ops;   /*!< Backend callbacks */
+    int                     inFd;  /*!< Descriptor to wait on for input, -1 if the backend has none */
+    int                     outFd; /*!< Descriptor to wait on for output room, -1 if writes never block or the owner resumes them */
+    void                   *priv;  /*!< Backend private data */
+} CLI_IoTypeDef;
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_IO_Exported_Functions CLI I/O Exported Functions
+ * @{
+ */
+
+bool    CLI_IoOpenTty(CLI_IoTypeDef *io, int inFd, int outFd);
+bool    CLI_IoOpenPipe(CLI_IoTypeDef *io, int inFd, int outFd);
+bool    CLI_IoOpenSocket(CLI_IoTypeDef *io, int sockFd);
+bool    CLI_IoOpenLoopback(CLI_IoTypeDef *io, size_t size);
+size_t  CLI_IoLoopbackPush(CLI_IoTypeDef *io, const void *buf, size_t len);
+size_t  CLI_IoLoopbackPull(CLI_IoTypeDef *io, void *buf, size_t len);
+ssize_t CLI_IoRead(CLI_IoTypeDef *io, void *buf, size_t len);
+ssize_t CLI_IoWritev(CLI_IoTypeDef *io, const struct iovec *iov, int iovcnt);
+void    CLI_IoClose(CLI_IoTypeDef *io);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_IO_H__ */
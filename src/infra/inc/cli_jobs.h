@@ -0,0 +1,69 @@
+/**
+ ******************************************************************************
+ * @file    cli_jobs.h
+ * @brief   CLI jobs: commands flagged CLI_CMD_FLAG_ASYNC run on a work stealing
+ *          worker pool instead of the CLI thread, so the console stays
+ *          responsive. A trailing '&' runs the command in the background,
+ *          'jobs', 'fg' and 'wait' are built in. Job output is buffered and
+ *          reported, tagged with the job id, once the job is done.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_JOBS_H__
+#define __CLI_JOBS_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cli.h"
+
+/** @addtogroup CLI_JOBS
+ * @{
+ */
+
+/* Exported macro ------------------------------------------------------------*/
+/** @defgroup CLI_JOBS_Exported_Macros CLI Jobs Exported Macros
+ * @{
+ */
+
+/* Count of worker threads, spawned when the first job is submitted. */
+#ifndef CLI_JOBS_WORKERS
+#define CLI_JOBS_WORKERS 4
+#endif
+
+/* Max output buffered per job, the rest is dropped. */
+#define CLI_JOB_OUTPUT_SIZE 4096
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_JOBS_Exported_Functions CLI Jobs Exported Functions
+ * @{
+ */
+
+/* Command handlers interface */
+bool CLI_JobIsCancelled(void);
+
+/* Engine interface */
+void     CLI_JobsInit(void);
+uint32_t CLI_JobSubmit(CLI_Context *ctx, int (*pHandler)(int, char **), const CLI_ArgsSchemaTypeDef *schema, int argc, char **argv,
+                       bool background);
+bool     CLI_JobsWait(CLI_Context *ctx, uint32_t jobId, bool interrupted);
+bool     CLI_JobsReport(CLI_Context *ctx);
+void     CLI_JobsDetach(CLI_Context *ctx);
+bool     CLI_JobsWrite(const char *buf, size_t len);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_JOBS_H__ */
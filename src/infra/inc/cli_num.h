@@ -0,0 +1,83 @@
+/**
+ ******************************************************************************
+ * @file    cli_num.h
+ * @brief   Integer formatting and parsing for the console. Formatting writes
+ *          two digits at a time from a lookup table, straight to their final
+ *          place. Parsing reads decimal, hexadecimal ('0x') and binary ('0b')
+ *          numbers eight digits at a time (SWAR), optionally followed by a
+ *          binary size suffix (4k, 1M), and tells malformed numbers from the
+ *          ones not fitting in 64 bits.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_NUM_H__
+#define __CLI_NUM_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @addtogroup CLI_NUM
+ * @{
+ */
+
+/* Exported constants --------------------------------------------------------*/
+/** @defgroup CLI_NUM_Exported_Constants CLI Num Exported Constants
+ * @{
+ */
+
+#define CLI_NUM_DEC_SIZE 21 /* Room for any 64 bits integer in decimal, sign and NULL included */
+#define CLI_NUM_HEX_SIZE 17 /* Room for any 64 bits integer in hexadecimal, NULL included */
+
+/* Notations CLI_NumParseU64() and CLI_NumParseI64() accept. */
+#define CLI_NUM_DEC      0x01 /* 123 */
+#define CLI_NUM_HEX      0x02 /* 0x7b, any case */
+#define CLI_NUM_BIN      0x04 /* 0b1111011 */
+#define CLI_NUM_SIZE     0x08 /* Decimal followed by k, M, G or T (any case): times 2^10, 2^20, 2^30 or 2^40 */
+#define CLI_NUM_HEX_BARE 0x10 /* Hexadecimal without its '0x' prefix */
+#define CLI_NUM_ANY      (CLI_NUM_DEC | CLI_NUM_HEX | CLI_NUM_BIN | CLI_NUM_SIZE)
+
+/**
+ * @}
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_NUM_Exported_Types CLI Num Exported Types
+  * @{
+  */
+
+/** @brief Parsing outcome */
+typedef enum
+{
+    CLI_NUM_OK = 0,    /*!< The whole text is a number */
+    CLI_NUM_INVALID,   /*!< Not a number in the accepted notations */
+    CLI_NUM_OVERFLOW,  /*!< A well formed number, too large for the result */
+} CLI_NumStatusTypeDef;
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_NUM_Exported_Functions CLI Num Exported Functions
+ * @{
+ */
+
+size_t               CLI_NumFormatU64(uint64_t value, char *buf);
+size_t               CLI_NumFormatI64(int64_t value, char *buf);
+size_t               CLI_NumFormatHex(uint64_t value, char *buf, bool upper);
+CLI_NumStatusTypeDef CLI_NumParseU64(const char *text, uint32_t flags, uint64_t *value);
+CLI_NumStatusTypeDef CLI_NumParseI64(const char *text, uint32_t flags, int64_t *value);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_NUM_H__ */
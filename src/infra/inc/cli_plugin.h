@@ -0,0 +1,63 @@
+/**
+ ******************************************************************************
+ * @file    cli_plugin.h
+ * @brief   CLI plugins: command modules built as shared objects and loaded on
+ *          demand. A plugin 'name.so' comes with a manifest 'name.def' next to
+ *          it, listing its commands the way modules '.def' files do:
+ *          one CLI_COMMAND(handler, "name", flags) per line, 'flags' being 0,
+ *          a number or CLI_CMD_FLAG_xxx names joined with '|'.
+ *          Registering a plugin only reads its manifest and injects stubs,
+ *          the shared object is opened the first time one of its commands is
+ *          invoked or completed and the stubs are then replaced with the real
+ *          handlers.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_PLUGIN_H__
+#define __CLI_PLUGIN_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "cli.h"
+
+/** @addtogroup CLI_PLUGIN
+ * @{
+ */
+
+/* Exported macro ------------------------------------------------------------*/
+/** @defgroup CLI_PLUGIN_Exported_Macros CLI Plugin Exported Macros
+ * @{
+ */
+
+/* Manifest file name extension, the shared object one replaces it. */
+#define CLI_PLUGIN_MANIFEST_EXT ".def"
+#define CLI_PLUGIN_MODULE_EXT   ".so"
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_PLUGIN_Exported_Functions CLI Plugin Exported Functions
+ * @{
+ */
+
+/* Application interface */
+bool     CLI_PluginRegister(const char *manifest);
+uint32_t CLI_PluginScan(const char *dir);
+
+/* Engine interface */
+bool CLI_PluginLoad(const char *name);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_PLUGIN_H__ */
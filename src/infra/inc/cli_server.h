@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @file    cli_server.h
+ * @brief   CLI console server: serves many CLI sessions over a Unix domain
+ *          socket and / or telnet from a single epoll driven thread. Every
+ *          connection gets its own CLI context (line buffer, history, prompt)
+ *          while all of them share the commands table built by
+ *          CLI_BuildTable().
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_SERVER_H__
+#define __CLI_SERVER_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "cli.h"
+
+/** @addtogroup CLI_SERVER
+ * @{
+ */
+
+/* Exported macro ------------------------------------------------------------*/
+/** @defgroup CLI_SERVER_Exported_Macros CLI Server Exported Macros
+ * @{
+ */
+
+/* Default max count of concurrent sessions. */
+#define CLI_SERVER_MAX_SESSIONS 256
+
+/* Telnet listen address when none is configured. */
+#define CLI_SERVER_TCP_ADDRESS "127.0.0.1"
+
+/* Max bytes fetched from a connection by a single read. */
+#define CLI_SERVER_RX_BATCH_SIZE 256
+
+/**
+ * @}
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_SERVER_Exported_Types CLI Server Exported Types
+  * @{
+  */
+
+/** @brief CLI server configuration */
+typedef struct
+{
+    CLI_InitTypeDef sessionInit; /*!< Template every session context is created from, 'io' and 'alert' are overridden */
+    const char     *unixPath;    /*!< Unix domain socket path to listen on, NULL for none */
+    const char     *tcpAddress;  /*!< Telnet IPv4 listen address, NULL for CLI_SERVER_TCP_ADDRESS */
+    uint16_t        tcpPort;     /*!< Telnet port to listen on, 0 for none */
+    uint32_t        maxSessions; /*!< Max concurrent sessions, 0 for CLI_SERVER_MAX_SESSIONS */
+} CLI_ServerConfigTypeDef;
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_SERVER_Exported_Functions CLI Server Exported Functions
+ * @{
+ */
+
+bool     CLI_ServerStart(const CLI_ServerConfigTypeDef *config);
+void     CLI_ServerStop(void);
+uint32_t CLI_ServerGetSessionCount(void);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_SERVER_H__ */
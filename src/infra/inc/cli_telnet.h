@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+ * @file    cli_telnet.h
+ * @brief   Minimal telnet (RFC 854) protocol filter for CLI sessions: IAC
+ *          WILL/WONT/DO/DONT option negotiation, window size (NAWS, RFC 1073)
+ *          and character-at-a-time mode (server side ECHO + SUPPRESS-GO-AHEAD).
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_TELNET_H__
+#define __CLI_TELNET_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @addtogroup CLI_TELNET
+ * @{
+ */
+
+/* Exported macro ------------------------------------------------------------*/
+/** @defgroup CLI_TELNET_Exported_Macros CLI Telnet Exported Macros
+ * @{
+ */
+
+/* Protocol commands */
+#define CLI_TELNET_SE   240 /* End of sub negotiation */
+#define CLI_TELNET_NOP  241 /* No operation */
+#define CLI_TELNET_SB   250 /* Start of sub negotiation */
+#define CLI_TELNET_WILL 251
+#define CLI_TELNET_WONT 252
+#define CLI_TELNET_DO   253
+#define CLI_TELNET_DONT 254
+#define CLI_TELNET_IAC  255 /* Interpret as command */
+
+/* Options */
+#define CLI_TELNET_OPT_ECHO     1
+#define CLI_TELNET_OPT_SGA      3  /* Suppress go ahead */
+#define CLI_TELNET_OPT_NAWS     31 /* Negotiate about window size */
+#define CLI_TELNET_OPT_LINEMODE 34
+
+/* Max length of a sub negotiation payload we keep, longer ones are truncated. */
+#define CLI_TELNET_MAX_SB 32
+
+/* Room for negotiation replies queued by a single CLI_TelnetFilter() call. */
+#define CLI_TELNET_MAX_REPLY 64
+
+/**
+ * @}
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_TELNET_Exported_Types CLI Telnet Exported Types
+  * @{
+  */
+
+/** @brief Telnet connection state */
+typedef struct
+{
+    uint8_t  state;                       /*!< Receive state machine */
+    uint8_t  verb;                        /*!< WILL / WONT / DO / DONT being received */
+    uint8_t  sb[CLI_TELNET_MAX_SB];       /*!< Sub negotiation payload */
+    uint8_t  sbLen;                       /*!< Sub negotiation payload length */
+    uint32_t local[8];                    /*!< Options enabled on our side (bit set) */
+    uint32_t remote[8];                   /*!< Options enabled on the client side (bit set) */
+    uint16_t width;                       /*!< Client window width, 0 if unknown */
+    uint16_t height;                      /*!< Client window height, 0 if unknown */
+    uint8_t  reply[CLI_TELNET_MAX_REPLY]; /*!< Negotiation replies pending transmission */
+    size_t   replyLen;                    /*!< Length of pending replies */
+} CLI_TelnetTypeDef;
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_TELNET_Exported_Functions CLI Telnet Exported Functions
+ * @{
+ */
+
+void   CLI_TelnetInit(CLI_TelnetTypeDef *telnet);
+size_t CLI_TelnetFilter(CLI_TelnetTypeDef *telnet, unsigned char *buf, size_t len);
+bool   CLI_TelnetIsEnabled(const CLI_TelnetTypeDef *telnet, bool local, uint8_t option);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_TELNET_H__ */
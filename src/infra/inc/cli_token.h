@@ -0,0 +1,68 @@
+/**
+ ******************************************************************************
+ * @file    cli_token.h
+ * @brief   Command line tokenizer. A single pass over the line yields views
+ *          (offset, length) of its words without copying nor altering it.
+ *          Words are separated by spaces or tabs, may be quoted ('single'
+ *          quotes keep everything as is, "double" quotes and unquoted text
+ *          take '\' escapes) and quoted parts join adjacent text: a"b c"d is
+ *          the single word 'ab cd'.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_TOKEN_H__
+#define __CLI_TOKEN_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @addtogroup CLI_TOKEN
+ * @{
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_TOKEN_Exported_Types CLI Token Exported Types
+  * @{
+  */
+
+/** @brief A word of the line, as typed (quotes and escapes included) */
+typedef struct
+{
+    uint16_t offset; /*!< First byte in the line */
+    uint16_t length; /*!< Bytes in the line */
+    bool     plain;  /*!< No quotes nor escapes, the bytes are the word itself */
+} CLI_TokenTypeDef;
+
+/** @brief Tokenizer outcome */
+typedef enum
+{
+    CLI_TOKEN_OK = 0,       /*!< Whole line tokenized */
+    CLI_TOKEN_TOO_MANY,     /*!< More words than room for their views */
+    CLI_TOKEN_UNTERMINATED, /*!< A quote is left open */
+} CLI_TokenStatusTypeDef;
+
+/**
+  * @}
+  */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_TOKEN_Exported_Functions CLI Token Exported Functions
+ * @{
+ */
+
+CLI_TokenStatusTypeDef CLI_Tokenize(const char *line, size_t len, CLI_TokenTypeDef *tokens, uint32_t max, uint32_t *count);
+size_t                 CLI_TokenCopy(const char *line, const CLI_TokenTypeDef *token, char *out);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_TOKEN_H__ */
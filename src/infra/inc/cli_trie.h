@@ -0,0 +1,78 @@
+/**
+ ******************************************************************************
+ * @file    cli_trie.h
+ * @brief   Radix trie completion index over the sorted commands table. Every
+ *          node covers a contiguous range of the table, so completing a prefix
+ *          costs O(prefix length) and yields both the candidates and their
+ *          longest common prefix. The children of a node are laid out in
+ *          Eytzinger (BFS) order over their edge labels, so stepping into one
+ *          is a branchless search reading only the nodes. Built at runtime by
+ *          CLI_BuildTable() or at build time by the table generator
+ *          (tools/cli_tablegen.c).
+ *
+ *          This stands for a flat Eytzinger index over the whole names: a
+ *          node is already the answer of a prefix query, its lower bound is
+ *          'first' and its upper bound 'first + count', found in one step per
+ *          typed byte rather than in two searches comparing names, and exact
+ *          lookups go through the perfect hash (cli_hash.h). Nor is there a
+ *          prefetch: a children block spans a few cache lines and the next
+ *          load depends on the label just read. Prefetching the next block,
+ *          or two levels ahead within one, gained nothing in
+ *          'cli_bench search', which times the flat index as well.
+ *
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_TRIE_H__
+#define __CLI_TRIE_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cli.h"
+
+/** @addtogroup CLI_TRIE
+ * @{
+ */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup CLI_TRIE_Exported_Types CLI Trie Exported Types
+  * @{
+  */
+
+/** @brief Trie node, the edge label past its first byte is read from the names (name[parent depth .. depth]) */
+struct __CLI_TrieNodeTypeDef
+{
+    uint32_t first;    /*!< First command below this node (sorted table index) */
+    uint32_t count;    /*!< Count of commands below this node */
+    uint32_t child;    /*!< First child node, children are contiguous in Eytzinger order of their labels */
+    uint16_t depth;    /*!< Length of the prefix shared by all commands below this node */
+    uint8_t  children; /*!< Count of children, at most one per byte value */
+    uint8_t  label;    /*!< First byte of the edge label (name[parent depth]), 0 for the root */
+};
+
+/**
+ * @}
+ */
+
+/* Exported functions --------------------------------------------------------*/
+/** @addtogroup CLI_TRIE_Exported_Functions CLI Trie Exported Functions
+ * @{
+ */
+
+uint32_t CLI_TrieMaxNodes(uint32_t count);
+uint32_t CLI_TrieBuild(const char *names, const uint32_t *nameOffs, uint32_t count, CLI_TrieNodeTypeDef *nodes);
+bool     CLI_TrieFind(const CLI_TrieNodeTypeDef *nodes, const char *names, const uint32_t *nameOffs, uint32_t count, const char *prefix,
+                      uint32_t len, uint32_t *first, uint32_t *matches, uint32_t *common);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+#endif /* __CLI_TRIE_H__ */
@@ -12,6 +12,12 @@
 #include <string.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 /** @defgroup Utilities
   * @brief Utilities module
@@ -64,152 +70,476 @@ void __strrev(char *str)
     }
 }
 
+/**
+ * @brief
+ *  Integer to text in any base from 2 to 36, signed in base 10 only. 'str'
+ *  must hold the text, 33 bytes at most (base 2). The digits are counted
+ *  first, then written straight to their place.
+*/
+
 int __itoa(int num, char *str, int base)
 {
-    int sum = num;
-    int i   = 0;
-    int digit;
-    int len = strlen(str);
+    unsigned int value;
+    unsigned int digit;
+    int          len = 0;
+
+    if ( base < 2 || base > 36 )
+        return -1;
+
+    if ( num < 0 && base == 10 )
+    {
+        *str++ = '-';
+        value  = 0u - (unsigned int) num;
+    }
+    else
+        value = (unsigned int) num;
 
+    for ( digit = value; digit != 0 || len == 0; digit /= (unsigned int) base )
+        len++;
+
+    str[len] = '\0';
     do
     {
-        digit = sum % base;
-        if ( digit < 0xA )
-            str[i++] = '0' + digit;
-        else
-            str[i++] = 'A' + digit - 0xA;
-        sum /= base;
-    } while ( sum && (i < (len - 1)) );
-    if ( i == (len - 1) && sum )
-        return -1;
-    str[i] = '\0';
-    __strrev(str);
+        digit      = value % (unsigned int) base;
+        str[--len] = (char) ((digit < 0xA) ? '0' + digit : 'A' + digit - 0xA);
+        value     /= (unsigned int) base;
+    } while ( len > 0 );
+
     return 0;
 }
 
+/* Kernels -------------------------------------------------------------------*/
+
 /**
  * @brief
- * Remove all leading & trailing white-spaces from input string _inplace_.
+ *  ASCII lower case without a branch, as __tolower().
 */
 
-char *__strtrim(char *in_str)
+static inline unsigned char text_fold(unsigned char c)
 {
-    unsigned char *str = (unsigned char *) in_str, *ptr, *str_begin, *str_end;
-    unsigned int   c;
+    return ((unsigned int) (c - 'A') < 26u) ? (unsigned char) (c + 'a' - 'A') : c;
+}
 
-    if ( ! str )
-        return 0;
+/**
+ * @brief
+ *  Whether 'len' folded bytes of two strings match.
+*/
+
+static inline bool text_match_fold(const unsigned char *a, const unsigned char *b, size_t len)
+{
+    size_t i;
 
-    /* Remove leading spaces */
-    for ( str_begin = str; (c = *str); str++ )
+    for ( i = 0; i < len; i++ )
     {
-        if ( __isspace(c) )
-            continue;
+        if ( text_fold(a[i]) != text_fold(b[i]) )
+            return false;
+    }
 
-        /* Copy from str_begin to end --skipping trailing white
-         * spaces */
-        str_end = str_begin;
-        for ( ptr = str_begin; (c = *ptr = *str); str++, ptr++ )
-        {
-            if ( ! __isspace(c) )
-                str_end = ptr;
-        }
+    return true;
+}
+
+static int text_stricmp_scalar(const unsigned char *pStr1, const unsigned char *pStr2)
+{
+    unsigned char c1, c2;
+
+    do
+    {
+        c1 = text_fold(*pStr1++);
+        c2 = text_fold(*pStr2++);
+    } while ( (c1 == c2) && (c1 != '\0') );
+
+    return (int) c1 - (int) c2;
+}
+
+static char *text_strlwr_scalar(char *str)
+{
+    unsigned char *p = (unsigned char *) str;
+
+    for ( ; *p; p++ )
+        *p = text_fold(*p);
 
-        *(str_end + 1) = 0;
-        return (char *) str_begin;
+    return str;
+}
+
+/**
+ * @brief
+ *  First case insensitive match of 'plen' bytes of 'pattern' in 'len' bytes
+ *  of 'str', only trying the positions starting with the same letter.
+*/
+
+static char *text_stristr_scalar(const char *str, size_t len, const char *pattern, size_t plen)
+{
+    const unsigned char *s     = (const unsigned char *) str;
+    const unsigned char *p     = (const unsigned char *) pattern;
+    const unsigned char  first = text_fold(p[0]);
+    size_t               i;
+
+    for ( i = 0; i + plen <= len; i++ )
+    {
+        if ( text_fold(s[i]) == first && text_match_fold(s + i + 1, p + 1, plen - 1) )
+            return (char *) (s + i);
     }
 
-    *str_begin = 0;
-    return (char *) str_begin;
+    return NULL;
 }
 
+#if defined(__x86_64__) || defined(__i386__)
+
+/* The NULL terminated kernels load whole vectors, reading bytes past the
+ * terminator in the same page: harmless, but not for the address sanitizer. */
+#if defined(__SANITIZE_ADDRESS__)
+#define TEXT_VECTOR_READ __attribute__((no_sanitize_address))
+#else
+#define TEXT_VECTOR_READ
+#endif
+
+/* A 'n' bytes load from 'p' stays in its page. */
+#define TEXT_PAGE_SAFE(p, n) ((((uintptr_t) (p)) & 4095) <= 4096 - (n))
+
 /**
  * @brief
- *  Case insensitive strcmp(). Non-ISO.
+ *  SSE2 kernels, 16 bytes at a time. ASCII upper case letters are moved to
+ *  the bottom of the signed range ('A' to -128) so that a single compare
+ *  spots them.
 */
 
-int __stricmp(const unsigned char *pStr1, const unsigned char *pStr2)
+__attribute__((target("sse2"))) static inline __m128i text_fold_sse2(__m128i v)
+{
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char) (0x80 - 'A')));
+    __m128i upper   = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char) (0x80 - 'A' + 'Z' + 1)));
+
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse2"))) TEXT_VECTOR_READ static int text_stricmp_sse2(const unsigned char *pStr1, const unsigned char *pStr2)
 {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i       v1, v2;
+    uint32_t      mask;
     unsigned char c1, c2;
-    int           v;
 
-    do
+    while ( 1 )
     {
-        c1 = *pStr1++;
-        c2 = *pStr2++;
+        if ( TEXT_PAGE_SAFE(pStr1, 16) && TEXT_PAGE_SAFE(pStr2, 16) )
+        {
+            v1   = _mm_loadu_si128((const __m128i *) pStr1);
+            v2   = _mm_loadu_si128((const __m128i *) pStr2);
+            mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(text_fold_sse2(v1), text_fold_sse2(v2)));
+
+            /* First difference or terminator. */
+            mask = (~mask & 0xFFFF) | (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v1, zero));
+            if ( mask != 0 )
+            {
+                mask = (uint32_t) __builtin_ctz(mask);
+                return (int) text_fold(pStr1[mask]) - (int) text_fold(pStr2[mask]);
+            }
+
+            pStr1 += 16;
+            pStr2 += 16;
+            continue;
+        }
+
+        /* Next to a page end, a byte at a time. */
+        c1 = text_fold(*pStr1++);
+        c2 = text_fold(*pStr2++);
+        if ( c1 != c2 || c1 == '\0' )
+            return (int) c1 - (int) c2;
+    }
+}
 
-        /* The casts are necessary when pStr1 is shorter & char is signed */
-        v = (unsigned int) __tolower(c1) - (unsigned int) __tolower(c2);
+__attribute__((target("sse2"))) TEXT_VECTOR_READ static char *text_strlwr_sse2(char *str)
+{
+    unsigned char *p    = (unsigned char *) str;
+    const __m128i  zero = _mm_setzero_si128();
+    __m128i        v;
+    uint32_t       mask;
 
-    } while ( (v == 0) && (c1 != '\0') && (c2 != '\0') );
+    while ( 1 )
+    {
+        if ( TEXT_PAGE_SAFE(p, 16) )
+        {
+            v    = _mm_loadu_si128((const __m128i *) p);
+            mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+            if ( mask == 0 )
+            {
+                _mm_storeu_si128((__m128i *) p, text_fold_sse2(v));
+                p += 16;
+                continue;
+            }
+
+            /* Only the upper case letters ahead of the terminator are written. */
+            mask = ~(uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(text_fold_sse2(v), v)) & ((1u << __builtin_ctz(mask)) - 1);
+            for ( ; mask != 0; mask &= mask - 1 )
+                p[__builtin_ctz(mask)] += 'a' - 'A';
+            return str;
+        }
 
-    return v;
+        if ( *p == '\0' )
+            return str;
+        *p = text_fold(*p);
+        p++;
+    }
 }
 
 /**
  * @brief
- *   Converts string to lower case. Non-ISO.
+ *  Only the positions where both the first and the last pattern letters
+ *  match are compared, 16 of them tested at once. The last vector overlaps
+ *  the previous one rather than leaving a tail, positions already tested are
+ *  masked out.
 */
 
-char *__strlwr(char *str)
+__attribute__((target("sse2"))) static char *text_stristr_sse2(const char *str, size_t len, const char *pattern, size_t plen)
 {
-    unsigned char *p = (unsigned char *) str;
-
-    while ( *p )
+    const unsigned char *s     = (const unsigned char *) str;
+    const unsigned char *p     = (const unsigned char *) pattern;
+    const __m128i        first = _mm_set1_epi8((char) text_fold(p[0]));
+    const __m128i        last  = _mm_set1_epi8((char) text_fold(p[plen - 1]));
+    const size_t         inner = (plen > 2) ? plen - 2 : 0;
+    const size_t         end   = len - plen + 1; /* Positions to test */
+    size_t               i;
+    size_t               at;
+    uint32_t             mask;
+    uint32_t             k;
+
+    if ( end < 16 )
+        return text_stristr_scalar(str, len, pattern, plen);
+
+    for ( i = 0; i < end; i += 16 )
     {
-        *p = __tolower((unsigned char) *p);
-        p++;
+        at   = (i + 16 <= end) ? i : end - 16;
+        mask = (uint32_t) _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(text_fold_sse2(_mm_loadu_si128((const __m128i *) (s + at))), first),
+                          _mm_cmpeq_epi8(text_fold_sse2(_mm_loadu_si128((const __m128i *) (s + at + plen - 1))), last)));
+        mask &= 0xFFFFu << (i - at);
+
+        for ( ; mask != 0; mask &= mask - 1 )
+        {
+            k = (uint32_t) __builtin_ctz(mask);
+            if ( text_match_fold(s + at + k + 1, p + 1, inner) )
+                return (char *) (s + at + k);
+        }
     }
 
-    return str;
+    return NULL;
 }
 
 /**
  * @brief
- *  This function is an ANSI version of strstr() with
- *     case insensitivity.
+ *  AVX2 kernels, the SSE2 ones 32 bytes at a time.
 */
 
-char *__stristr(const char *String, const char *Pattern)
+__attribute__((target("avx2"))) static inline __m256i text_fold_avx2(__m256i v)
 {
-    char   *pptr, *sptr, *start;
-    int32_t slen, plen;
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char) (0x80 - 'A')));
+    __m256i upper   = _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (0x80 - 'A' + 'Z' + 1)), shifted);
 
-    for ( start = (char *) String, pptr = (char *) Pattern, slen = strlen(String), plen = strlen(Pattern);
+    return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
 
-          /* while string length not shorter than pattern length */
-          slen >= plen;
+__attribute__((target("avx2"))) TEXT_VECTOR_READ static int text_stricmp_avx2(const unsigned char *pStr1, const unsigned char *pStr2)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i       v1, v2;
+    uint32_t      mask;
+    unsigned char c1, c2;
 
-          start++, slen-- )
+    while ( 1 )
     {
-        /* find start of pattern in string */
-        while ( __toupper(*start) != __toupper(*Pattern) )
+        if ( TEXT_PAGE_SAFE(pStr1, 32) && TEXT_PAGE_SAFE(pStr2, 32) )
         {
-            start++;
-            slen--;
+            v1   = _mm256_loadu_si256((const __m256i *) pStr1);
+            v2   = _mm256_loadu_si256((const __m256i *) pStr2);
+            mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(text_fold_avx2(v1), text_fold_avx2(v2)));
+
+            mask = ~mask | (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, zero));
+            if ( mask != 0 )
+            {
+                mask = (uint32_t) __builtin_ctz(mask);
+                return (int) text_fold(pStr1[mask]) - (int) text_fold(pStr2[mask]);
+            }
+
+            pStr1 += 32;
+            pStr2 += 32;
+            continue;
+        }
 
-            /* if pattern longer than string */
+        c1 = text_fold(*pStr1++);
+        c2 = text_fold(*pStr2++);
+        if ( c1 != c2 || c1 == '\0' )
+            return (int) c1 - (int) c2;
+    }
+}
 
-            if ( slen < plen )
-                return (NULL);
+__attribute__((target("avx2"))) TEXT_VECTOR_READ static char *text_strlwr_avx2(char *str)
+{
+    unsigned char *p    = (unsigned char *) str;
+    const __m256i  zero = _mm256_setzero_si256();
+    __m256i        v;
+    uint32_t       mask;
+
+    while ( 1 )
+    {
+        if ( TEXT_PAGE_SAFE(p, 32) )
+        {
+            v    = _mm256_loadu_si256((const __m256i *) p);
+            mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+            if ( mask == 0 )
+            {
+                _mm256_storeu_si256((__m256i *) p, text_fold_avx2(v));
+                p += 32;
+                continue;
+            }
+
+            mask = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(text_fold_avx2(v), v)) & ((1u << __builtin_ctz(mask)) - 1);
+            for ( ; mask != 0; mask &= mask - 1 )
+                p[__builtin_ctz(mask)] += 'a' - 'A';
+            return str;
         }
 
-        sptr = start;
-        pptr = (char *) Pattern;
+        if ( *p == '\0' )
+            return str;
+        *p = text_fold(*p);
+        p++;
+    }
+}
+
+__attribute__((target("avx2"))) static char *text_stristr_avx2(const char *str, size_t len, const char *pattern, size_t plen)
+{
+    const unsigned char *s     = (const unsigned char *) str;
+    const unsigned char *p     = (const unsigned char *) pattern;
+    const __m256i        first = _mm256_set1_epi8((char) text_fold(p[0]));
+    const __m256i        last  = _mm256_set1_epi8((char) text_fold(p[plen - 1]));
+    const size_t         inner = (plen > 2) ? plen - 2 : 0;
+    const size_t         end   = len - plen + 1;
+    size_t               i;
+    size_t               at;
+    uint32_t             mask;
+    uint32_t             k;
+
+    if ( end < 32 )
+        return text_stristr_sse2(str, len, pattern, plen);
+
+    for ( i = 0; i < end; i += 32 )
+    {
+        at   = (i + 32 <= end) ? i : end - 32;
+        mask = (uint32_t) _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(text_fold_avx2(_mm256_loadu_si256((const __m256i *) (s + at))), first),
+                             _mm256_cmpeq_epi8(text_fold_avx2(_mm256_loadu_si256((const __m256i *) (s + at + plen - 1))), last)));
+        mask &= 0xFFFFFFFFu << (i - at);
 
-        while ( __toupper(*sptr) == __toupper(*pptr) )
+        for ( ; mask != 0; mask &= mask - 1 )
         {
-            sptr++;
-            pptr++;
+            k = (uint32_t) __builtin_ctz(mask);
+            if ( text_match_fold(s + at + k + 1, p + 1, inner) )
+                return (char *) (s + at + k);
+        }
+    }
 
-            /* if end of pattern then pattern was found */
+    return NULL;
+}
 
-            if ( '\0' == *pptr )
-                return (start);
-        }
+#endif /* __x86_64__ || __i386__ */
+
+/* Kernels of the running CPU, upgraded once at startup. */
+static struct
+{
+    int (*stricmp)(const unsigned char *pStr1, const unsigned char *pStr2);
+    char *(*strlwr)(char *str);
+    char *(*stristr)(const char *str, size_t len, const char *pattern, size_t plen);
+} gTextKernels = {text_stricmp_scalar, text_strlwr_scalar, text_stristr_scalar};
+
+/**
+ * @brief
+ *  Pick the widest kernels the CPU runs, before main().
+*/
+
+__attribute__((constructor)) static void text_select_kernels(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+    {
+        gTextKernels.stricmp = text_stricmp_avx2;
+        gTextKernels.strlwr  = text_strlwr_avx2;
+        gTextKernels.stristr = text_stristr_avx2;
+    }
+    else if ( __builtin_cpu_supports("sse2") )
+    {
+        gTextKernels.stricmp = text_stricmp_sse2;
+        gTextKernels.strlwr  = text_strlwr_sse2;
+        gTextKernels.stristr = text_stristr_sse2;
     }
+#endif
+}
+
+/**
+ * @brief
+ * Remove all leading & trailing white-spaces from input string _inplace_.
+ * The string itself is scanned and moved by the C library, vectorized.
+*/
+
+char *__strtrim(char *in_str)
+{
+    size_t lead = 0;
+    size_t len;
+
+    if ( ! in_str )
+        return 0;
+
+    while ( __isspace((unsigned char) in_str[lead]) )
+        lead++;
+
+    len = strlen(in_str + lead);
+    while ( len > 0 && __isspace((unsigned char) in_str[lead + len - 1]) )
+        len--;
+
+    if ( lead != 0 )
+        memmove(in_str, in_str + lead, len);
+    in_str[len] = 0;
+
+    return in_str;
+}
+
+/**
+ * @brief
+ *  Case insensitive strcmp(). Non-ISO.
+*/
+
+int __stricmp(const unsigned char *pStr1, const unsigned char *pStr2)
+{
+    return gTextKernels.stricmp(pStr1, pStr2);
+}
+
+/**
+ * @brief
+ *   Converts string to lower case. Non-ISO.
+*/
+
+char *__strlwr(char *str)
+{
+    return gTextKernels.strlwr(str);
+}
+
+/**
+ * @brief
+ *  This function is an ANSI version of strstr() with
+ *     case insensitivity.
+*/
+
+char *__stristr(const char *String, const char *Pattern)
+{
+    size_t slen = strlen(String);
+    size_t plen = strlen(Pattern);
+
+    if ( plen == 0 )
+        return (char *) String;
+
+    if ( plen > slen )
+        return (NULL);
 
-    return (NULL);
+    return gTextKernels.stristr(String, slen, Pattern, plen);
 }
 
 /**
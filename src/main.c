@@ -10,52 +10,126 @@
 
 #include "main.h"
 #include "cli.h"
+#include "cli_num.h"
+#include "cli_plugin.h"
+#include "cli_server.h"
 #include "text_utils.h"
 
+/* Console I/O backend, owned by the CLI task once started. */
+static CLI_IoTypeDef gConsoleIo;
+
 /**
-  * @brief  Initialize and start CLI engine.
-  * @retval bool - true if initialization is successful, false otherwise.
+  * @brief  Fills the configuration shared by the console and remote sessions.
+  * @param cliInit: Configuration to fill.
   */
 
-static bool CLI_Start(void)
+static void CLI_SetupInit(CLI_InitTypeDef *cliInit)
 {
-    CLI_InitTypeDef cliInit = {0};
+    memset(cliInit, 0, sizeof(CLI_InitTypeDef));
 
-    cliInit.autoLowerCase = false;
-    cliInit.echo          = true;
+    cliInit->autoLowerCase = false;
+    cliInit->echo          = true;
 
     /* Set the prompt */
-    strncpy(cliInit.prompt, "Intel", sizeof(cliInit.prompt) - 1);
-    cliInit.printPrompt = true;
+    strncpy(cliInit->prompt, "Intel", sizeof(cliInit->prompt) - 1);
+    cliInit->printPrompt = true;
 
     /* Set the handler functions, some of which may be available
        by your compiler.*/
 
-    cliInit.handlers.itoa    = __itoa;
-    cliInit.handlers.free    = free;
-    cliInit.handlers.malloc  = malloc;
-    cliInit.handlers.putc    = (__cli_putc) putc;
-    cliInit.handlers.stricmp = __stricmp;
-    cliInit.handlers.stristr = __stristr;
-    cliInit.handlers.strlwr  = __strlwr;
-    cliInit.handlers.strtrim = __strtrim;
+    cliInit->handlers.itoa    = __itoa;
+    cliInit->handlers.free    = free;
+    cliInit->handlers.malloc  = malloc;
+    cliInit->handlers.putc    = (__cli_putc) putc;
+    cliInit->handlers.stricmp = __stricmp;
+    cliInit->handlers.stristr = __stristr;
+    cliInit->handlers.strlwr  = __strlwr;
+    cliInit->handlers.strtrim = __strtrim;
+}
+
+/**
+  * @brief  Initialize and start CLI engine.
+  * @retval bool - true if initialization is successful, false otherwise.
+  */
+
+static bool CLI_Start(void)
+{
+    CLI_InitTypeDef cliInit;
+
+    CLI_SetupInit(&cliInit);
+
+    /* Talk to the controlling terminal through the built-in tty backend,
+       without a backend output would go through 'handlers.putc'. */
+    if ( CLI_IoOpenTty(&gConsoleIo, STDIN_FILENO, STDOUT_FILENO) )
+        cliInit.io = &gConsoleIo;
 
     return CLI_Init(&cliInit);
 }
 
+/**
+  * @brief  Serve remote sessions on a Unix domain socket and / or telnet.
+  * @param path: Socket path, NULL for none.
+  * @param port: Telnet port on the loopback interface, 0 for none.
+  * @retval bool - true if the server is listening, false otherwise.
+  */
+
+static bool CLI_StartServer(const char *path, uint16_t port)
+{
+    CLI_ServerConfigTypeDef config = {0};
+
+    CLI_SetupInit(&config.sessionInit);
+    config.unixPath = path;
+    config.tcpPort  = port;
+
+    return CLI_ServerStart(&config);
+}
+
 /**
   * @brief  Main function to start the CLI demo.
   * @retval int - EXIT_SUCCESS on successful execution.
   */
 
-int main(void)
+int main(int argc, char **argv)
 {
+    const char *unixPath   = NULL;
+    const char *pluginsDir = NULL;
+    uint16_t    tcpPort    = 0;
+    uint64_t    port;
+    int         opt;
+
+    while ( (opt = getopt(argc, argv, "u:t:p:")) != -1 )
+    {
+        switch ( opt )
+        {
+            case 'u':
+                unixPath = optarg;
+                break;
+            case 't':
+                if ( CLI_NumParseU64(optarg, CLI_NUM_DEC, &port) != CLI_NUM_OK || port == 0 || port > UINT16_MAX )
+                {
+                    printf("Invalid telnet port: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                tcpPort = (uint16_t) port;
+                break;
+            case 'p':
+                pluginsDir = optarg;
+                break;
+            default:
+                printf("Usage: %s [-u unix_socket_path] [-t telnet_port] [-p plugins_dir]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
 
     printf("\n---------------------------------------\n");
     printf("\nGreetings!, welcome to 'CLI demo'.\n");
     printf("Type 'exit' when you're done.\n");
     printf("\n---------------------------------------\n");
 
+    /* The engine writes to the output descriptor directly, don't let the
+       banner sit in the stdio buffer behind it. */
+    fflush(stdout);
+
     /* Start CLI.
        Note: this will spawn the an auxiliary task which will take care of 
        executing CLI command. 
@@ -63,20 +137,38 @@ int main(void)
     if ( ! CLI_Start() )
     {
         printf("Error: Could not start CLI Demo.\n");
+        fflush(stdout);
         return EXIT_FAILURE;
     }
 
     /* Add few commands and build the CLI table */
     cli_addCommands();
+#ifdef CLI_CPP_COMMANDS
+    cli_addCppCommands();
+#endif
 
     /* 
      * You can 'inject' CLI commands multiple times from various modules. 
-     * However, once you call 'CLI_BuildTable', you will not be able to add more 
-     * commands.
+     * Once you call 'CLI_BuildTable', commands injected or removed later on
+     * are applied on the fly to all sessions.
      */
 
     CLI_BuildTable();
 
+    /* Plugins commands are added on the fly, their modules are loaded on first use */
+    if ( pluginsDir != NULL && CLI_PluginScan(pluginsDir) == 0 )
+    {
+        printf("Error: No plugins found in '%s'.\n", pluginsDir);
+        fflush(stdout);
+    }
+
+    /* Optionally serve more consoles sharing the same commands */
+    if ( (unixPath != NULL || tcpPort != 0) && ! CLI_StartServer(unixPath, tcpPort) )
+    {
+        printf("Error: Could not start the CLI server.\n");
+        fflush(stdout);
+    }
+
     /* Continue with system boot.. */
     while ( 1 )
     {
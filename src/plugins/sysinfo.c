@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  *
+  * @file    sysinfo.c
+  * @brief   Sample plugin, system information commands. Built as a shared
+  *          object and loaded by the engine the first time one of the commands
+  *          listed in sysinfo.def is used.
+  *
+  ******************************************************************************
+  */
+
+#include "cli.h"      /* Command line interface task */
+#include "cli_args.h" /* Typed command arguments */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Arguments of 'loadavg': the period to show, all of them by default. */
+static const CLI_ArgTypeDef gSysinfoLoadavgArgList[] = {
+    { .name = "period", .type = CLI_ARG_ENUM, .optional = true, .choices = "all|1|5|15", .def = "all" },
+};
+
+const CLI_ArgsSchemaTypeDef gSysinfoLoadavgArgs = { gSysinfoLoadavgArgList, SIZEOF_ITEM(gSysinfoLoadavgArgList) };
+
+/**
+ * @brief Dumps out the system uptime.
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return EXIT_SUCCESS on success
+ */
+
+int sysinfo_uptime(int argc, char **argv)
+{
+    FILE  *file;
+    double uptime = 0;
+
+    /* Dump help and exit */
+    CLI_SHOW_HELP("Show the system uptime.");
+
+    file = fopen("/proc/uptime", "r");
+    if ( file == NULL || fscanf(file, "%lf", &uptime) != 1 )
+    {
+        CLI_Printf("uptime: not available\n");
+        if ( file != NULL )
+            fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    fclose(file);
+    CLI_Printf("Up %lu days, %02lu:%02lu:%02lu\n", (unsigned long) uptime / 86400, ((unsigned long) uptime / 3600) % 24,
+               ((unsigned long) uptime / 60) % 60, (unsigned long) uptime % 60);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Dumps out the system load averages.
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return EXIT_SUCCESS on success
+ */
+
+int sysinfo_loadavg(int argc, char **argv)
+{
+    FILE   *file;
+    double  load[3] = {0};
+    int64_t period;
+
+    /* Dump help and exit */
+    CLI_SHOW_HELP("Show the 1, 5 and 15 minutes load averages.");
+
+    /* Index among "all|1|5|15", see gSysinfoLoadavgArgs. */
+    period = CLI_GetArgs()->values[0].num;
+
+    file = fopen("/proc/loadavg", "r");
+    if ( file == NULL || fscanf(file, "%lf %lf %lf", &load[0], &load[1], &load[2]) != 3 )
+    {
+        CLI_Printf("loadavg: not available\n");
+        if ( file != NULL )
+            fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    fclose(file);
+    if ( period == 0 )
+        CLI_Printf("Load average: %.2f %.2f %.2f\n", load[0], load[1], load[2]);
+    else
+        CLI_Printf("Load average (%s min): %.2f\n", CLI_GetArgs()->values[0].str, load[period - 1]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1206 @@
+/**
+  ******************************************************************************
+  *
+  * @file    cli_bench.c
+  * @brief   Microbenchmarks of the engine hot paths, so that the figures
+  *          quoted when they were optimized can be reproduced. Each section
+  *          compares the current code with the code it replaced (kept here as
+  *          reference copies) and with the C library where it has a
+  *          counterpart.
+  *
+  *          Usage: cli_bench [section]...   (all sections by default)
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE /* strcasestr() */
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "cli.h"
+#include "cli_io.h"
+#include "cli_num.h"
+#include "cli_trie.h"
+#include "text_utils.h"
+
+/** @defgroup CLI_BENCH CLI Bench
+  * @brief CLI microbenchmarks
+  * @{
+  */
+
+/* Private define ------------------------------------------------------------*/
+/** @defgroup CLI_BENCH_Private_Define CLI Bench Private Define
+  * @{
+  */
+
+/* Most commands a section injects. */
+#define CLI_BENCH_MAX_COMMANDS 100000
+
+/* Room for a generated command name, 'c' and 8 hexadecimal digits. */
+#define CLI_BENCH_NAME_SIZE 10
+
+/* Command lines of a dispatch script, and times it is replayed. */
+#define CLI_BENCH_SCRIPT_LINES  4096
+#define CLI_BENCH_SCRIPT_ROUNDS 16
+
+/* Commands per module injected by the startup section, the first ones of
+ * each module re-declare the previous module last ones. */
+#define CLI_BENCH_MODULE_COMMANDS 100
+#define CLI_BENCH_MODULE_OVERLAP  10
+
+/* Longest generated name of the search section, and count of its queries. */
+#define CLI_BENCH_SEARCH_NAME_SIZE 25
+#define CLI_BENCH_SEARCH_QUERIES   (1 << 16)
+#define CLI_BENCH_SEARCH_ITERS     1000000
+
+/* Values formatted and parsed in turn by the num section, and times they are. */
+#define CLI_BENCH_NUM_VALUES 4096
+#define CLI_BENCH_NUM_ROUNDS 500
+
+/* Hardware cache counters read around the measured lines, see CLI_BenchCountersOpen(). */
+#define CLI_BENCH_COUNTERS 2
+
+/* Loopback backend capacity, each direction. */
+#define CLI_BENCH_IO_SIZE (1 << 20)
+
+/**
+  * @}
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup CLI_BENCH_Private_Typedef CLI Bench Private Typedef
+  * @{
+  */
+
+/**
+  * @brief
+  *  A benchmark section.
+  */
+
+typedef struct __CLI_BenchSectionTypeDef
+{
+    const char *name;       /* Selects it on the command line */
+    const char *title;      /* Printed above its results */
+    void (*run)(void);      /* Runs it */
+
+} CLI_BenchSectionTypeDef;
+
+/**
+  * @brief
+  *  Flat Eytzinger index entry: the first 4 bytes of a name, big endian so
+  *  that keys order as the names do, and where the name is.
+  */
+
+typedef struct __CLI_BenchEytzTypeDef
+{
+    uint32_t key;     /* Name first bytes, zero padded */
+    uint32_t nameOff; /* Offset of the name in the pool */
+    uint32_t index;   /* Sorted table index of the name */
+    uint32_t pad;     /* Four entries per cache line */
+
+} CLI_BenchEytzTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_BENCH_Private_Variables CLI Bench Private Variables
+  * @{
+  */
+
+/* Results land here so that the measured calls are not optimized out. */
+static volatile uintptr_t gCliBenchSink;
+
+/* Engine driven by the sections, through the loopback backend. */
+static CLI_IoTypeDef gCliBenchIo;
+static bool          gCliBenchEngineUp;
+
+/* Generated commands, their names, and count of handler calls. */
+static CLI_CmdTypeDef gCliBenchCmnds[CLI_BENCH_MAX_COMMANDS];
+static char           gCliBenchNames[CLI_BENCH_MAX_COMMANDS][CLI_BENCH_NAME_SIZE];
+static uint32_t       gCliBenchCalls;
+
+/* Dispatch script, CLI_BENCH_SCRIPT_LINES command lines back to back. */
+static char gCliBenchScript[CLI_BENCH_SCRIPT_LINES * (CLI_BENCH_NAME_SIZE + 1)];
+
+/* Cache counters: L1 data read misses, last level cache misses. */
+static const char *gCliBenchCounterNames[CLI_BENCH_COUNTERS] = {"L1D miss", "LLC miss"};
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_BENCH_Private_Functions CLI Bench Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Monotonic time in nanoseconds.
+ */
+
+static double CLI_BenchNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+/**
+ * @brief
+ *  Keep the compiler from assuming 'p' unchanged across iterations.
+ */
+
+static inline void CLI_BenchClobber(const void *p)
+{
+    __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+/**
+ * @brief
+ *  text_utils as it was before its vector kernels: byte at a time loops.
+ */
+
+static int CLI_BenchOldLower(int c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + 'a' - 'A' : c;
+}
+
+static int CLI_BenchOldUpper(int c)
+{
+    return (c >= 'a' && c <= 'z') ? c - 32 : c;
+}
+
+static int CLI_BenchOldStricmp(const unsigned char *pStr1, const unsigned char *pStr2)
+{
+    unsigned char c1, c2;
+    int           v;
+
+    do
+    {
+        c1 = *pStr1++;
+        c2 = *pStr2++;
+        v  = (int) ((unsigned int) CLI_BenchOldLower(c1) - (unsigned int) CLI_BenchOldLower(c2));
+    } while ( (v == 0) && (c1 != '\0') && (c2 != '\0') );
+
+    return v;
+}
+
+static char *CLI_BenchOldStrlwr(char *str)
+{
+    unsigned char *p = (unsigned char *) str;
+
+    for ( ; *p; p++ )
+        *p = (unsigned char) CLI_BenchOldLower(*p);
+
+    return str;
+}
+
+static char *CLI_BenchOldStristr(const char *String, const char *Pattern)
+{
+    const char *pptr, *sptr, *start;
+    int32_t     slen, plen;
+
+    for ( start = String, slen = (int32_t) strlen(String), plen = (int32_t) strlen(Pattern); slen >= plen; start++, slen-- )
+    {
+        while ( CLI_BenchOldUpper(*start) != CLI_BenchOldUpper(*Pattern) )
+        {
+            start++;
+            slen--;
+            if ( slen < plen )
+                return NULL;
+        }
+
+        for ( sptr = start, pptr = Pattern; CLI_BenchOldUpper(*sptr) == CLI_BenchOldUpper(*pptr); sptr++ )
+        {
+            if ( *++pptr == '\0' )
+                return (char *) start;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief
+ *  The C library has no strlwr(), a tolower() loop stands for it.
+ */
+
+static char *CLI_BenchLibcStrlwr(char *str)
+{
+    unsigned char *p = (unsigned char *) str;
+
+    for ( ; *p; p++ )
+        *p = (unsigned char) tolower(*p);
+
+    return str;
+}
+
+static int CLI_BenchLibcStricmp(const unsigned char *pStr1, const unsigned char *pStr2)
+{
+    return strcasecmp((const char *) pStr1, (const char *) pStr2);
+}
+
+/**
+ * @brief
+ *  text_utils string kernels: the old loops, the C library and the current
+ *  (CPU dispatched) kernels, on equal-ignoring-case strings (stricmp), mixed
+ *  case ones (strlwr) and a needle at the end of a haystack (stristr).
+ */
+
+static void CLI_BenchText(void)
+{
+    static const char *impl[3] = {"old", "libc", "current"};
+    static char        a[4096 + 1];
+    static char        b[4096 + 1];
+    int (*cmp[3])(const unsigned char *, const unsigned char *) = {CLI_BenchOldStricmp, CLI_BenchLibcStricmp, __stricmp};
+    char *(*lwr[3])(char *)                                    = {CLI_BenchOldStrlwr, CLI_BenchLibcStrlwr, __strlwr};
+    char *(*str[3])(const char *, const char *)                = {CLI_BenchOldStristr, strcasestr, __stristr};
+    const size_t lens[4]                                       = {8, 64, 1024, 4096};
+    double       t0;
+    size_t       len;
+    long         iters;
+    long         n;
+    int          i, k;
+
+    printf("  %-16s %10s %10s %10s\n", "ns per call", impl[0], impl[1], impl[2]);
+
+    for ( i = 0; i < 4; i++ )
+    {
+        len   = lens[i];
+        iters = 40000000 / (long) (len + 8);
+
+        for ( k = 0; k < (int) len; k++ )
+        {
+            a[k] = "abcdefghijklmnopqrstuvwxyz_"[k % 27];
+            b[k] = (k & 1) ? (char) toupper(a[k]) : a[k];
+        }
+        a[len] = b[len] = '\0';
+
+        printf("  stricmp %5zu B ", len);
+        for ( k = 0; k < 3; k++ )
+        {
+            t0 = CLI_BenchNow();
+            for ( n = 0; n < iters; n++ )
+            {
+                gCliBenchSink += (uintptr_t) cmp[k]((const unsigned char *) a, (const unsigned char *) b);
+                CLI_BenchClobber(a);
+            }
+            printf(" %10.1f", (CLI_BenchNow() - t0) / (double) iters);
+        }
+
+        printf("\n  strlwr  %5zu B ", len);
+        for ( k = 0; k < 3; k++ )
+        {
+            t0 = CLI_BenchNow();
+            for ( n = 0; n < iters; n++ )
+            {
+                b[0] = (char) ('A' + (n & 1)); /* Something to do on every call */
+                gCliBenchSink += (uintptr_t) lwr[k](b);
+                CLI_BenchClobber(b);
+            }
+            printf(" %10.1f", (CLI_BenchNow() - t0) / (double) iters);
+        }
+
+        for ( k = 0; k < (int) len; k++ )
+            a[k] = "the quick brown fox jumps over a lazy dog, "[k % 43];
+        memcpy(a + len - 6, "NEEDLE", 6);
+
+        printf("\n  stristr %5zu B ", len);
+        for ( k = 0; k < 3; k++ )
+        {
+            t0 = CLI_BenchNow();
+            for ( n = 0; n < iters; n++ )
+            {
+                gCliBenchSink += (uintptr_t) str[k](a, "needle");
+                CLI_BenchClobber(a);
+            }
+            printf(" %10.1f", (CLI_BenchNow() - t0) / (double) iters);
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * @brief
+ *  Handler of the generated commands, counts its calls.
+ */
+
+static int CLI_BenchHandler(int argc, char **argv)
+{
+    (void) argc;
+    (void) argv;
+
+    __atomic_add_fetch(&gCliBenchCalls, 1, __ATOMIC_RELEASE);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief
+ *  Start the engine on a loopback backend, once: no echo, prompt only, so
+ *  that the figures are those of the input path and the dispatch.
+ */
+
+static bool CLI_BenchEngine(void)
+{
+    CLI_InitTypeDef cliInit;
+    uint32_t        i, h;
+
+    if ( gCliBenchEngineUp == true )
+        return true;
+
+    memset(&cliInit, 0, sizeof(CLI_InitTypeDef));
+
+    cliInit.handlers.itoa    = __itoa;
+    cliInit.handlers.free    = free;
+    cliInit.handlers.malloc  = malloc;
+    cliInit.handlers.stricmp = __stricmp;
+    cliInit.handlers.stristr = __stristr;
+    cliInit.handlers.strlwr  = __strlwr;
+    cliInit.handlers.strtrim = __strtrim;
+    cliInit.printPrompt      = true;
+    cliInit.io               = &gCliBenchIo;
+    strcpy(cliInit.prompt, "bench");
+
+    if ( CLI_IoOpenLoopback(&gCliBenchIo, CLI_BENCH_IO_SIZE) == false || CLI_Init(&cliInit) == false )
+        return false;
+
+    /* Unique names spread over the alphabet: odd multipliers permute 32 bits. */
+    for ( i = 0; i < CLI_BENCH_MAX_COMMANDS; i++ )
+    {
+        h = i * 2654435761u;
+        snprintf(gCliBenchNames[i], CLI_BENCH_NAME_SIZE, "c%08x", h);
+        gCliBenchCmnds[i].pHandler = CLI_BenchHandler;
+        gCliBenchCmnds[i].Name     = gCliBenchNames[i];
+    }
+
+    gCliBenchEngineUp = true;
+    return true;
+}
+
+/**
+ * @brief
+ *  Feed 'len' bytes of input holding 'lines' command lines and wait until
+ *  they were all dispatched, discarding the engine output meanwhile.
+ */
+
+static void CLI_BenchFeed(const char *input, size_t len, uint32_t lines)
+{
+    static char out[CLI_BENCH_IO_SIZE];
+    uint32_t    target = __atomic_load_n(&gCliBenchCalls, __ATOMIC_ACQUIRE) + lines;
+    size_t      pushed = 0;
+
+    while ( pushed < len || __atomic_load_n(&gCliBenchCalls, __ATOMIC_ACQUIRE) != target )
+    {
+        if ( pushed < len )
+            pushed += CLI_IoLoopbackPush(&gCliBenchIo, input + pushed, len - pushed);
+        else
+            sched_yield();
+
+        CLI_IoLoopbackPull(&gCliBenchIo, out, sizeof(out));
+    }
+}
+
+/**
+ * @brief
+ *  Startup: 1k, 10k and 100k commands injected as modules of
+ *  CLI_BENCH_MODULE_COMMANDS (overlapping, so that some are dropped as
+ *  duplicates), then CLI_BuildTable(). Each count is measured in a child
+ *  process starting its own engine, the table being built once per process.
+ * @note  Runs before the sections starting the engine in this process.
+ */
+
+static void CLI_BenchStartup(void)
+{
+    const uint32_t counts[3] = {1000, 10000, 100000};
+    double         t0, tInject, tBuild;
+    uint32_t       count;
+    uint32_t       first;
+    pid_t          pid;
+    int            modules;
+    int            status;
+    int            i;
+
+    printf("  %-16s %10s %10s %10s %10s\n", "commands", "modules", "inject ms", "build ms", "merged");
+
+    for ( i = 0; i < 3; i++ )
+    {
+        count = counts[i];
+
+        fflush(stdout);
+        pid = fork();
+        if ( pid < 0 )
+        {
+            printf("  %-16u fork failed\n", count);
+            continue;
+        }
+
+        if ( pid > 0 )
+        {
+            waitpid(pid, &status, 0);
+            continue;
+        }
+
+        if ( CLI_BenchEngine() == false )
+        {
+            printf("  %-16u loopback engine unavailable\n", count);
+            fflush(stdout);
+            _exit(EXIT_FAILURE);
+        }
+
+        t0 = CLI_BenchNow();
+        for ( first = 0, modules = 0; first < count; first += CLI_BENCH_MODULE_COMMANDS, modules++ )
+        {
+            if ( first == 0 )
+                CLI_InjectCommands(gCliBenchCmnds, CLI_BENCH_MODULE_COMMANDS);
+            else
+                CLI_InjectCommands(&gCliBenchCmnds[first - CLI_BENCH_MODULE_OVERLAP], CLI_BENCH_MODULE_COMMANDS + CLI_BENCH_MODULE_OVERLAP);
+        }
+        tInject = CLI_BenchNow() - t0;
+
+        t0 = CLI_BenchNow();
+        CLI_BuildTable();
+        tBuild = CLI_BenchNow() - t0;
+
+        printf("  %-16u %10d %10.2f %10.2f %10d\n", count, modules, tInject / 1e6, tBuild / 1e6, CLI_GetCommandCnt());
+        fflush(stdout);
+        _exit(EXIT_SUCCESS);
+    }
+}
+
+/**
+ * @brief
+ *  Command dispatch: random command lines out of 10 up to 100k injected
+ *  commands, fed through the loopback backend and run by the CLI task. The
+ *  per line cost should not depend on the count of commands.
+ */
+
+static void CLI_BenchDispatch(void)
+{
+    const uint32_t counts[5] = {10, 100, 1000, 10000, 100000};
+    double         t0;
+    size_t         len;
+    uint32_t       seed = 1;
+    uint32_t       count;
+    int            i, k;
+
+    if ( CLI_BenchEngine() == false )
+    {
+        printf("  loopback engine unavailable\n");
+        return;
+    }
+
+    printf("  %-16s %10s\n", "commands", "ns per line");
+
+    for ( i = 0; i < 5; i++ )
+    {
+        count = counts[i];
+
+        CLI_InjectCommands(gCliBenchCmnds, (int) count);
+        CLI_BuildTable();
+
+        for ( k = 0, len = 0; k < CLI_BENCH_SCRIPT_LINES; k++ )
+        {
+            seed = seed * 1103515245u + 12345u;
+            len += (size_t) sprintf(&gCliBenchScript[len], "%s\r", gCliBenchNames[(seed >> 8) % count]);
+        }
+
+        /* Warm up, then measure. */
+        CLI_BenchFeed(gCliBenchScript, len, CLI_BENCH_SCRIPT_LINES);
+
+        t0 = CLI_BenchNow();
+        for ( k = 0; k < CLI_BENCH_SCRIPT_ROUNDS; k++ )
+            CLI_BenchFeed(gCliBenchScript, len, CLI_BENCH_SCRIPT_LINES);
+        printf("  %-16u %10.1f\n", count, (CLI_BenchNow() - t0) / (CLI_BENCH_SCRIPT_LINES * CLI_BENCH_SCRIPT_ROUNDS));
+
+        CLI_RemoveCommands(gCliBenchCmnds);
+    }
+}
+
+/**
+ * @brief
+ *  Open the cache counters of the calling thread, user space only, disabled.
+ *  A counter the kernel or the CPU does not provide (perf_event_paranoid,
+ *  containers, virtual machines) is left at -1 and reported as 'n/a'.
+ */
+
+static void CLI_BenchCountersOpen(int fds[CLI_BENCH_COUNTERS])
+{
+    struct perf_event_attr attr;
+    int                    i;
+
+    for ( i = 0; i < CLI_BENCH_COUNTERS; i++ )
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        if ( i == 0 )
+        {
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+        else
+        {
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        }
+
+        fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+/**
+ * @brief
+ *  Reset and enable (start true) or disable (start false) the counters.
+ */
+
+static void CLI_BenchCountersRun(const int fds[CLI_BENCH_COUNTERS], bool start)
+{
+    int i;
+
+    for ( i = 0; i < CLI_BENCH_COUNTERS; i++ )
+    {
+        if ( fds[i] < 0 )
+            continue;
+
+        if ( start )
+        {
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+        else
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+}
+
+/**
+ * @brief
+ *  Print each counter per 'ops', 'n/a' for those that could not be read.
+ */
+
+static void CLI_BenchCountersPrint(const int fds[CLI_BENCH_COUNTERS], double ops)
+{
+    uint64_t value;
+    int      i;
+
+    for ( i = 0; i < CLI_BENCH_COUNTERS; i++ )
+    {
+        if ( fds[i] >= 0 && read(fds[i], &value, sizeof(value)) == (ssize_t) sizeof(value) )
+            printf(" %10.2f", (double) value / ops);
+        else
+            printf(" %10s", "n/a");
+    }
+}
+
+/**
+ * @brief
+ *  Cache behavior of the dispatch at large table sizes: random command lines
+ *  fed to a context created on this thread and served inline, so that the
+ *  thread's cache counters see the whole input, lookup and handler path.
+ *  Counters are reported per line.
+ */
+
+static void CLI_BenchCache(void)
+{
+    static CLI_IoTypeDef io;
+    static char          out[CLI_BENCH_IO_SIZE];
+    const uint32_t       counts[3] = {1000, 10000, 100000};
+    CLI_InitTypeDef      cliInit;
+    CLI_Context         *ctx;
+    double               t0, t;
+    size_t               len;
+    uint32_t             seed = 1;
+    uint32_t             count;
+    int                  fds[CLI_BENCH_COUNTERS];
+    int                  i, k;
+
+    if ( CLI_BenchEngine() == false || CLI_IoOpenLoopback(&io, CLI_BENCH_IO_SIZE) == false )
+    {
+        printf("  loopback engine unavailable\n");
+        return;
+    }
+
+    memset(&cliInit, 0, sizeof(CLI_InitTypeDef));
+    cliInit.handlers.itoa    = __itoa;
+    cliInit.handlers.free    = free;
+    cliInit.handlers.malloc  = malloc;
+    cliInit.handlers.stricmp = __stricmp;
+    cliInit.handlers.stristr = __stristr;
+    cliInit.handlers.strlwr  = __strlwr;
+    cliInit.handlers.strtrim = __strtrim;
+    cliInit.printPrompt      = true;
+    cliInit.io               = &io;
+    strcpy(cliInit.prompt, "cache");
+
+    ctx = CLI_ContextCreate(&cliInit);
+    if ( ctx == NULL )
+    {
+        printf("  context unavailable\n");
+        return;
+    }
+
+    CLI_BenchCountersOpen(fds);
+
+    printf("  %-16s %10s %10s %10s\n", "commands", "ns per line", gCliBenchCounterNames[0], gCliBenchCounterNames[1]);
+
+    for ( i = 0; i < 3; i++ )
+    {
+        count = counts[i];
+
+        CLI_InjectCommands(gCliBenchCmnds, (int) count);
+        CLI_BuildTable();
+
+        for ( k = 0, len = 0; k < CLI_BENCH_SCRIPT_LINES; k++ )
+        {
+            seed = seed * 1103515245u + 12345u;
+            len += (size_t) sprintf(&gCliBenchScript[len], "%s\r", gCliBenchNames[(seed >> 8) % count]);
+        }
+
+        /* Warm up (the context picks the new table up), then measure. */
+        CLI_ContextProcessBytes(ctx, (const unsigned char *) gCliBenchScript, len);
+        CLI_IoLoopbackPull(&io, out, sizeof(out));
+
+        t = 0;
+        CLI_BenchCountersRun(fds, true);
+        for ( k = 0; k < CLI_BENCH_SCRIPT_ROUNDS; k++ )
+        {
+            t0 = CLI_BenchNow();
+            CLI_ContextProcessBytes(ctx, (const unsigned char *) gCliBenchScript, len);
+            t += CLI_BenchNow() - t0;
+
+            /* Outside of the timing, not of the counters. */
+            CLI_IoLoopbackPull(&io, out, sizeof(out));
+        }
+        CLI_BenchCountersRun(fds, false);
+
+        printf("  %-16u %10.1f", count, t / (CLI_BENCH_SCRIPT_LINES * CLI_BENCH_SCRIPT_ROUNDS));
+        CLI_BenchCountersPrint(fds, CLI_BENCH_SCRIPT_LINES * CLI_BENCH_SCRIPT_ROUNDS);
+        printf("\n");
+
+        CLI_RemoveCommands(gCliBenchCmnds);
+    }
+
+    for ( i = 0; i < CLI_BENCH_COUNTERS; i++ )
+    {
+        if ( fds[i] >= 0 )
+            close(fds[i]);
+    }
+
+    CLI_ContextDestroy(ctx);
+}
+
+/**
+ * @brief
+ *  The trie step as it was before its Eytzinger children: a branchy binary
+ *  search over the children sorted by label, reading the labels from the
+ *  names.
+ */
+
+static bool CLI_BenchOldTrieFind(const CLI_TrieNodeTypeDef *nodes, const char *names, const uint32_t *nameOffs, const char *prefix,
+                                 uint32_t len, uint32_t *first, uint32_t *matches)
+{
+    const CLI_TrieNodeTypeDef *node = &nodes[0];
+    uint32_t                   lo, hi, mid;
+    uint32_t                   p;
+    char                       c;
+
+    for ( p = 0; p < len; p++ )
+    {
+        c = (char) CLI_BenchOldLower(prefix[p]);
+
+        if ( p >= node->depth )
+        {
+            lo = node->child;
+            hi = node->child + node->children;
+            while ( lo < hi )
+            {
+                mid = lo + (hi - lo) / 2;
+                if ( (names + nameOffs[nodes[mid].first])[p] < c )
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            if ( lo == node->child + node->children )
+                return false;
+
+            node = &nodes[lo];
+        }
+
+        if ( (names + nameOffs[node->first])[p] != c )
+            return false;
+    }
+
+    *first   = node->first;
+    *matches = node->count;
+
+    return true;
+}
+
+/**
+ * @brief
+ *  Compare the first 'len' bytes of a name with a prefix (any case).
+ */
+
+static inline int CLI_BenchPrefixCmp(const char *name, const char *prefix, uint32_t len)
+{
+    uint32_t      i;
+    unsigned char a, b;
+
+    for ( i = 0; i < len; i++ )
+    {
+        a = (unsigned char) name[i];
+        b = (unsigned char) CLI_BenchOldLower(prefix[i]);
+        if ( a != b )
+            return (a < b) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief
+ *  Lay the sorted names out in a flat Eytzinger index, 1 based, in order.
+ */
+
+static uint32_t CLI_BenchEytzFill(CLI_BenchEytzTypeDef *ey, uint32_t n, uint32_t k, uint32_t i, const char *names, const uint32_t *nameOffs)
+{
+    const unsigned char *s;
+    int                  b;
+
+    if ( k > n )
+        return i;
+
+    i = CLI_BenchEytzFill(ey, n, 2 * k, i, names, nameOffs);
+
+    s              = (const unsigned char *) names + nameOffs[i];
+    ey[k].nameOff  = nameOffs[i];
+    ey[k].index    = i;
+    for ( ey[k].key = 0, b = 0; b < 4; b++ )
+        ey[k].key = (ey[k].key << 8) | ((*s != 0) ? *s++ : 0);
+
+    return CLI_BenchEytzFill(ey, n, 2 * k + 1, i + 1, names, nameOffs);
+}
+
+/**
+ * @brief
+ *  Full key branchless Eytzinger search with prefetch: the first sorted
+ *  index whose name prefix is not below 'prefix' (upper false) or is above
+ *  it (upper true), 'n' when none is.
+ */
+
+static uint32_t CLI_BenchEytzBound(const CLI_BenchEytzTypeDef *ey, uint32_t n, const char *names, const char *prefix, uint32_t len, bool upper)
+{
+    uint32_t key  = 0;
+    uint32_t mask = (len >= 4) ? ~0u : ~0u << (8 * (4 - len));
+    uint32_t k    = 1;
+    uint32_t ek;
+    uint32_t b;
+    bool     less;
+
+    for ( b = 0; b < 4; b++ )
+        key = (key << 8) | ((b < len) ? (uint8_t) CLI_BenchOldLower(prefix[b]) : 0);
+
+    while ( k <= n )
+    {
+        /* Four levels ahead: sixteen descendants, four cache lines. */
+        __builtin_prefetch(ey + 16 * k);
+
+        ek = ey[k].key & mask;
+        if ( ek != key )
+            less = (ek < key);
+        else if ( len <= 4 )
+            less = upper;
+        else
+        {
+            b    = (uint32_t) CLI_BenchPrefixCmp(names + ey[k].nameOff + 4, prefix + 4, len - 4);
+            less = upper ? ((int) b <= 0) : ((int) b < 0);
+        }
+
+        k = 2 * k + less;
+    }
+
+    k >>= __builtin_ffs((int) ~k);
+    return (k == 0) ? n : ey[k].index;
+}
+
+/**
+ * @brief
+ *  Lower (upper false) or upper bound binary search over the sorted names,
+ *  the way bsearch() halves (bsearch() itself returns any match, no bound).
+ */
+
+static uint32_t CLI_BenchBsearchBound(const char *names, const uint32_t *nameOffs, uint32_t n, const char *prefix, uint32_t len, bool upper)
+{
+    uint32_t lo = 0;
+    uint32_t hi = n;
+    uint32_t mid;
+    int      cmp;
+
+    while ( lo < hi )
+    {
+        mid = lo + (hi - lo) / 2;
+        cmp = CLI_BenchPrefixCmp(names + nameOffs[mid], prefix, len);
+        if ( cmp < 0 || (upper && cmp == 0) )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/**
+ * @brief
+ *  qsort() order of the generated names.
+ */
+
+static int CLI_BenchNameCmp(const void *a, const void *b)
+{
+    return strcmp((const char *) a, (const char *) b);
+}
+
+/**
+ * @brief
+ *  qsort() order of trie siblings, by label.
+ */
+
+static int CLI_BenchLabelCmp(const void *a, const void *b)
+{
+    return (int) ((const CLI_TrieNodeTypeDef *) a)->label - (int) ((const CLI_TrieNodeTypeDef *) b)->label;
+}
+
+/**
+ * @brief
+ *  Prefix search over 1k to 100k random names (3 to 24 characters) with 2
+ *  and 5 characters prefixes of existing names and full names: the trie
+ *  (Eytzinger ordered children), the trie as it was (sorted children), a
+ *  flat full key Eytzinger index with prefetch, and bound binary searches.
+ *  Every method yields the first match and the count of matches, checked
+ *  against the trie.
+ */
+
+static void CLI_BenchSearch(void)
+{
+    const uint32_t        counts[3] = {1000, 10000, 100000};
+    const uint32_t        lens[3]   = {2, 5, CLI_BENCH_SEARCH_NAME_SIZE};
+    char                 (*sorted)[CLI_BENCH_SEARCH_NAME_SIZE];
+    char                 (*queries)[CLI_BENCH_SEARCH_NAME_SIZE];
+    char                 *names;
+    uint32_t             *nameOffs;
+    CLI_TrieNodeTypeDef  *nodes;
+    CLI_TrieNodeTypeDef  *oldNodes;
+    CLI_BenchEytzTypeDef *ey;
+    uint32_t              qlens[CLI_BENCH_SEARCH_QUERIES];
+    uint32_t              seed = 7;
+    uint32_t              n, used, pool;
+    uint32_t              first, matches, common;
+    uint32_t              f, m;
+    uint32_t              q, l;
+    double                t0;
+    long                  it;
+    long                  mismatches;
+    int                   i, j, k;
+
+    printf("  %-16s %10s %10s %10s %10s\n", "ns per query", "trie", "old trie", "eytzinger", "bsearch");
+
+    for ( i = 0; i < 3; i++ )
+    {
+        sorted   = malloc((size_t) counts[i] * sizeof(*sorted));
+        queries  = malloc((size_t) CLI_BENCH_SEARCH_QUERIES * sizeof(*queries));
+        names    = malloc((size_t) counts[i] * CLI_BENCH_SEARCH_NAME_SIZE);
+        nameOffs = malloc((size_t) counts[i] * sizeof(uint32_t));
+        nodes    = malloc((size_t) CLI_TrieMaxNodes(counts[i]) * sizeof(CLI_TrieNodeTypeDef));
+        oldNodes = malloc((size_t) CLI_TrieMaxNodes(counts[i]) * sizeof(CLI_TrieNodeTypeDef));
+        ey       = malloc((size_t) (counts[i] + 1) * sizeof(CLI_BenchEytzTypeDef));
+
+        if ( sorted == NULL || queries == NULL || names == NULL || nameOffs == NULL || nodes == NULL || oldNodes == NULL || ey == NULL )
+        {
+            printf("  out of memory\n");
+            free(sorted), free(queries), free(names), free(nameOffs), free(nodes), free(oldNodes), free(ey);
+            return;
+        }
+
+        /* Sorted unique names, pooled back to back as the engine has them. */
+        for ( n = 0; n < counts[i]; n++ )
+        {
+            seed = seed * 1103515245u + 12345u;
+            for ( l = 3 + (seed >> 16) % 22, k = 0; k < (int) l; k++ )
+            {
+                seed            = seed * 1103515245u + 12345u;
+                sorted[n][k]    = "abcdefghijklmnopqrstuvwxyz_"[(seed >> 16) % 27];
+            }
+            sorted[n][l] = '\0';
+        }
+        qsort(sorted, counts[i], sizeof(*sorted), CLI_BenchNameCmp);
+
+        for ( n = 0, pool = 0, k = 0; k < (int) counts[i]; k++ )
+        {
+            if ( k > 0 && strcmp(sorted[k], sorted[k - 1]) == 0 )
+                continue;
+            nameOffs[n++] = pool;
+            strcpy(names + pool, sorted[k]);
+            pool += (uint32_t) strlen(sorted[k]) + 1;
+        }
+
+        used = CLI_TrieBuild(names, nameOffs, n, nodes);
+        CLI_BenchEytzFill(ey, n, 1, 0, names, nameOffs);
+
+        /* The old layout: each children block sorted by label. */
+        memcpy(oldNodes, nodes, used * sizeof(CLI_TrieNodeTypeDef));
+        for ( k = 0; k < (int) used; k++ )
+            qsort(&oldNodes[oldNodes[k].child], oldNodes[k].children, sizeof(CLI_TrieNodeTypeDef), CLI_BenchLabelCmp);
+
+        for ( j = 0; j < 3; j++ )
+        {
+            for ( q = 0; q < CLI_BENCH_SEARCH_QUERIES; q++ )
+            {
+                seed = seed * 1103515245u + 12345u;
+                strcpy(queries[q], names + nameOffs[(seed >> 8) % n]);
+                queries[q][0] = (char) toupper(queries[q][0]); /* Typed input may be any case */
+                qlens[q]      = (uint32_t) strnlen(queries[q], lens[j]);
+            }
+
+            /* Same answers from every method. */
+            for ( mismatches = 0, q = 0; q < CLI_BENCH_SEARCH_QUERIES; q++ )
+            {
+                CLI_TrieFind(nodes, names, nameOffs, n, queries[q], qlens[q], &first, &matches, &common);
+                if ( CLI_BenchOldTrieFind(oldNodes, names, nameOffs, queries[q], qlens[q], &f, &m) == false || f != first || m != matches )
+                    mismatches++;
+                f = CLI_BenchEytzBound(ey, n, names, queries[q], qlens[q], false);
+                if ( f != first || CLI_BenchEytzBound(ey, n, names, queries[q], qlens[q], true) - f != matches )
+                    mismatches++;
+                f = CLI_BenchBsearchBound(names, nameOffs, n, queries[q], qlens[q], false);
+                if ( f != first || CLI_BenchBsearchBound(names, nameOffs, n, queries[q], qlens[q], true) - f != matches )
+                    mismatches++;
+            }
+
+            if ( j < 2 )
+                printf("  %6u, %2u chars", n, lens[j]);
+            else
+                printf("  %6u, names  ", n);
+
+            t0 = CLI_BenchNow();
+            for ( it = 0; it < CLI_BENCH_SEARCH_ITERS; it++ )
+            {
+                q = (uint32_t) (it * 2654435761u) & (CLI_BENCH_SEARCH_QUERIES - 1);
+                CLI_TrieFind(nodes, names, nameOffs, n, queries[q], qlens[q], &first, &matches, &common);
+                gCliBenchSink += first + matches;
+            }
+            printf(" %10.1f", (CLI_BenchNow() - t0) / CLI_BENCH_SEARCH_ITERS);
+
+            t0 = CLI_BenchNow();
+            for ( it = 0; it < CLI_BENCH_SEARCH_ITERS; it++ )
+            {
+                q = (uint32_t) (it * 2654435761u) & (CLI_BENCH_SEARCH_QUERIES - 1);
+                CLI_BenchOldTrieFind(oldNodes, names, nameOffs, queries[q], qlens[q], &first, &matches);
+                gCliBenchSink += first + matches;
+            }
+            printf(" %10.1f", (CLI_BenchNow() - t0) / CLI_BENCH_SEARCH_ITERS);
+
+            t0 = CLI_BenchNow();
+            for ( it = 0; it < CLI_BENCH_SEARCH_ITERS; it++ )
+            {
+                q     = (uint32_t) (it * 2654435761u) & (CLI_BENCH_SEARCH_QUERIES - 1);
+                first = CLI_BenchEytzBound(ey, n, names, queries[q], qlens[q], false);
+                gCliBenchSink += first + CLI_BenchEytzBound(ey, n, names, queries[q], qlens[q], true);
+            }
+            printf(" %10.1f", (CLI_BenchNow() - t0) / CLI_BENCH_SEARCH_ITERS);
+
+            t0 = CLI_BenchNow();
+            for ( it = 0; it < CLI_BENCH_SEARCH_ITERS; it++ )
+            {
+                q     = (uint32_t) (it * 2654435761u) & (CLI_BENCH_SEARCH_QUERIES - 1);
+                first = CLI_BenchBsearchBound(names, nameOffs, n, queries[q], qlens[q], false);
+                gCliBenchSink += first + CLI_BenchBsearchBound(names, nameOffs, n, queries[q], qlens[q], true);
+            }
+            printf(" %10.1f", (CLI_BenchNow() - t0) / CLI_BENCH_SEARCH_ITERS);
+
+            if ( mismatches > 0 )
+                printf("   %ld mismatches", mismatches);
+            printf("\n");
+        }
+
+        free(sorted), free(queries), free(names), free(nameOffs), free(nodes), free(oldNodes), free(ey);
+    }
+}
+
+/**
+ * @brief
+ *  Integer formatting and parsing: cli_num against snprintf() and
+ *  strtoull(), on full 64 bits random values and on values of any bit length.
+ */
+
+static void CLI_BenchNum(void)
+{
+    static const char *sets[2] = {"64 bits", "any length"};
+    static uint64_t    values[CLI_BENCH_NUM_VALUES];
+    static char        dec[CLI_BENCH_NUM_VALUES][CLI_NUM_DEC_SIZE];
+    static char        hex[CLI_BENCH_NUM_VALUES][CLI_NUM_HEX_SIZE + 2];
+    char               buf[CLI_NUM_DEC_SIZE];
+    uint64_t           r = 0x9E3779B97F4A7C15ULL;
+    uint64_t           v;
+    double             t[2];
+    double             t0;
+    int                set, k, n;
+    uint32_t           i;
+
+    printf("  %-24s %10s %10s\n", "ns per call", "libc", "current");
+
+    for ( set = 0; set < 2; set++ )
+    {
+        for ( i = 0; i < CLI_BENCH_NUM_VALUES; i++ )
+        {
+            r ^= r << 13;
+            r ^= r >> 7;
+            r ^= r << 17;
+            values[i] = (set == 0) ? r : r >> (r % 64);
+            snprintf(dec[i], sizeof(dec[i]), "%" PRIu64, values[i]);
+            snprintf(hex[i], sizeof(hex[i]), "0x%" PRIx64, values[i]);
+        }
+
+        printf("  format dec %-13s", sets[set]);
+        for ( k = 0; k < 2; k++ )
+        {
+            t0 = CLI_BenchNow();
+            for ( n = 0; n < CLI_BENCH_NUM_ROUNDS; n++ )
+            {
+                for ( i = 0; i < CLI_BENCH_NUM_VALUES; i++ )
+                {
+                    gCliBenchSink += (k == 0) ? (uintptr_t) snprintf(buf, sizeof(buf), "%" PRIu64, values[i]) : CLI_NumFormatU64(values[i], buf);
+                    CLI_BenchClobber(buf);
+                }
+            }
+            t[k] = (CLI_BenchNow() - t0) / ((double) CLI_BENCH_NUM_ROUNDS * CLI_BENCH_NUM_VALUES);
+        }
+        printf(" %10.1f %10.1f\n", t[0], t[1]);
+
+        printf("  format hex %-13s", sets[set]);
+        for ( k = 0; k < 2; k++ )
+        {
+            t0 = CLI_BenchNow();
+            for ( n = 0; n < CLI_BENCH_NUM_ROUNDS; n++ )
+            {
+                for ( i = 0; i < CLI_BENCH_NUM_VALUES; i++ )
+                {
+                    gCliBenchSink += (k == 0) ? (uintptr_t) snprintf(buf, sizeof(buf), "%" PRIx64, values[i]) : CLI_NumFormatHex(values[i], buf, false);
+                    CLI_BenchClobber(buf);
+                }
+            }
+            t[k] = (CLI_BenchNow() - t0) / ((double) CLI_BENCH_NUM_ROUNDS * CLI_BENCH_NUM_VALUES);
+        }
+        printf(" %10.1f %10.1f\n", t[0], t[1]);
+
+        printf("  parse dec  %-13s", sets[set]);
+        for ( k = 0; k < 2; k++ )
+        {
+            t0 = CLI_BenchNow();
+            for ( n = 0; n < CLI_BENCH_NUM_ROUNDS; n++ )
+            {
+                for ( i = 0; i < CLI_BENCH_NUM_VALUES; i++ )
+                {
+                    if ( k == 0 )
+                        v = strtoull(dec[i], NULL, 10);
+                    else
+                        CLI_NumParseU64(dec[i], CLI_NUM_DEC, &v);
+                    gCliBenchSink += (uintptr_t) v;
+                }
+                CLI_BenchClobber(dec);
+            }
+            t[k] = (CLI_BenchNow() - t0) / ((double) CLI_BENCH_NUM_ROUNDS * CLI_BENCH_NUM_VALUES);
+        }
+        printf(" %10.1f %10.1f\n", t[0], t[1]);
+
+        printf("  parse hex  %-13s", sets[set]);
+        for ( k = 0; k < 2; k++ )
+        {
+            t0 = CLI_BenchNow();
+            for ( n = 0; n < CLI_BENCH_NUM_ROUNDS; n++ )
+            {
+                for ( i = 0; i < CLI_BENCH_NUM_VALUES; i++ )
+                {
+                    if ( k == 0 )
+                        v = strtoull(hex[i], NULL, 16);
+                    else
+                        CLI_NumParseU64(hex[i], CLI_NUM_HEX, &v);
+                    gCliBenchSink += (uintptr_t) v;
+                }
+                CLI_BenchClobber(hex);
+            }
+            t[k] = (CLI_BenchNow() - t0) / ((double) CLI_BENCH_NUM_ROUNDS * CLI_BENCH_NUM_VALUES);
+        }
+        printf(" %10.1f %10.1f\n", t[0], t[1]);
+    }
+}
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @addtogroup CLI_BENCH_Private_Variables
+  * @{
+  */
+
+static const CLI_BenchSectionTypeDef gCliBenchSections[] = {
+    {"text", "text_utils string kernels", CLI_BenchText},
+    {"startup", "commands table build at startup", CLI_BenchStartup},
+    {"dispatch", "command lines dispatch through the loopback backend", CLI_BenchDispatch},
+    {"cache", "dispatch cache misses at large table sizes", CLI_BenchCache},
+    {"search", "completion prefix search", CLI_BenchSearch},
+    {"num", "integer formatting and parsing", CLI_BenchNum},
+};
+
+/**
+  * @}
+  */
+
+/**
+ * @brief
+ *  Run the sections named on the command line, all of them by default.
+ */
+
+int main(int argc, char **argv)
+{
+    size_t i;
+    int    j;
+    bool   run;
+
+    for ( i = 0; i < sizeof(gCliBenchSections) / sizeof(gCliBenchSections[0]); i++ )
+    {
+        for ( run = (argc < 2), j = 1; j < argc && ! run; j++ )
+            run = (strcmp(argv[j], gCliBenchSections[i].name) == 0);
+
+        if ( ! run )
+            continue;
+
+        printf("%s (%s)\n", gCliBenchSections[i].title, gCliBenchSections[i].name);
+        gCliBenchSections[i].run();
+        printf("\n");
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+  * @}
+  */
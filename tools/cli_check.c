@@ -0,0 +1,814 @@
+/**
+  ******************************************************************************
+  *
+  * @file    cli_check.c
+  * @brief   Differential checks of the engine kernels: each section runs
+  *          random inputs through the current code and a straightforward
+  *          reference, and reports the first input they disagree on. Built
+  *          with ASAN and UBSAN by 'make check', which also runs the
+  *          tokenizer section built without SSE2 (its SWAR path).
+  *          text_utils.c is built in here, its per CPU kernels are static.
+  *
+  *          Usage: cli_check [section]...   (all sections by default)
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "cli_num.h"
+#include "cli_token.h"
+
+/* Reach the kernels of every CPU level, not just the dispatched ones. */
+#include "../src/infra/text_utils.c"
+
+/** @defgroup CLI_CHECK CLI Check
+  * @brief CLI differential checks
+  * @{
+  */
+
+/* Private define ------------------------------------------------------------*/
+/** @defgroup CLI_CHECK_Private_Define CLI Check Private Define
+  * @{
+  */
+
+/* Random command lines of the token section, longest one and word views room. */
+#define CLI_CHECK_TOKEN_LINES    2000000
+#define CLI_CHECK_TOKEN_LINE_MAX 200
+#define CLI_CHECK_TOKEN_WORDS    32
+
+/* Random cases of the text section per kernel, longest string and largest
+ * gap left between a terminator and the following page. */
+#define CLI_CHECK_TEXT_CASES   100000
+#define CLI_CHECK_TEXT_LEN_MAX 200
+#define CLI_CHECK_TEXT_GAP_MAX 96
+
+/* Random values formatted, and random texts parsed, by the num section. */
+#define CLI_CHECK_NUM_VALUES 1000000
+#define CLI_CHECK_NUM_TEXTS  1000000
+#define CLI_CHECK_NUM_TEXT   200
+
+/**
+  * @}
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup CLI_CHECK_Private_Typedef CLI Check Private Typedef
+  * @{
+  */
+
+/**
+  * @brief
+  *  A check section, returns the count of mismatches.
+  */
+
+typedef struct __CLI_CheckSectionTypeDef
+{
+    const char *name;     /* Selects it on the command line */
+    const char *title;    /* Printed above its results */
+    uint32_t (*run)(void); /* Runs it */
+
+} CLI_CheckSectionTypeDef;
+
+/**
+  * @brief
+  *  text_utils kernels of a CPU level.
+  */
+
+typedef struct __CLI_CheckTextKernelsTypeDef
+{
+    const char *name; /* CPU level */
+    int (*stricmp)(const unsigned char *pStr1, const unsigned char *pStr2);
+    char *(*strlwr)(char *str);
+    char *(*stristr)(const char *str, size_t len, const char *pattern, size_t plen);
+
+} CLI_CheckTextKernelsTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_CHECK_Private_Variables CLI Check Private Variables
+  * @{
+  */
+
+/* Random generator state, fixed seed so that a failure can be replayed. */
+static uint64_t gCliCheckRand = 0x9E3779B97F4A7C15ULL;
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_CHECK_Private_Functions CLI Check Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  64 bits pseudo random number (xorshift64*).
+ */
+
+static uint64_t CLI_CheckRand(void)
+{
+    gCliCheckRand ^= gCliCheckRand >> 12;
+    gCliCheckRand ^= gCliCheckRand << 25;
+    gCliCheckRand ^= gCliCheckRand >> 27;
+
+    return gCliCheckRand * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief
+ *  Print a line escaped, so that blanks and quotes of a failing input show.
+ */
+
+static void CLI_CheckPrintLine(const char *line, size_t len)
+{
+    size_t i;
+
+    printf("  line   \"");
+    for ( i = 0; i < len; i++ )
+    {
+        if ( line[i] == '\t' )
+            printf("\\t");
+        else if ( line[i] == '"' || line[i] == '\\' )
+            printf("\\%c", line[i]);
+        else
+            printf("%c", line[i]);
+    }
+    printf("\" (%zu bytes)\n", len);
+}
+
+/**
+ * @brief
+ *  Reference tokenizer: a byte at a time, as the syntax reads in cli_token.h.
+ *  Writes the words resolved, NULL terminated, back to back in 'out'.
+ */
+
+static CLI_TokenStatusTypeDef CLI_CheckRefTokenize(const char *line, size_t len, char *out, bool *plain, uint32_t max, uint32_t *count)
+{
+    size_t i     = 0;
+    bool   word  = false;
+    char   quote = 0;
+    char   c;
+
+    *count = 0;
+
+    for ( i = 0; i < len; i++ )
+    {
+        c = line[i];
+
+        if ( quote == 0 && (c == ' ' || c == '\t') )
+        {
+            if ( word )
+            {
+                *out++ = '\0';
+                word   = false;
+            }
+            continue;
+        }
+
+        if ( word == false )
+        {
+            if ( *count == max )
+                return CLI_TOKEN_TOO_MANY;
+
+            plain[(*count)++] = true;
+            word              = true;
+        }
+
+        if ( quote == '\'' )
+        {
+            if ( c == '\'' )
+                quote = 0;
+            else
+                *out++ = c;
+        }
+        else if ( c == '\\' )
+        {
+            plain[*count - 1] = false;
+
+            if ( i + 1 < len )
+                *out++ = line[++i];
+            else if ( quote == 0 )
+                *out++ = c; /* A trailing '\' is kept as is */
+        }
+        else if ( quote == '"' )
+        {
+            if ( c == '"' )
+                quote = 0;
+            else
+                *out++ = c;
+        }
+        else if ( c == '"' || c == '\'' )
+        {
+            plain[*count - 1] = false;
+            quote             = c;
+        }
+        else
+            *out++ = c;
+    }
+
+    if ( quote != 0 )
+        return CLI_TOKEN_UNTERMINATED;
+
+    if ( word )
+        *out = '\0';
+
+    return CLI_TOKEN_OK;
+}
+
+/**
+ * @brief
+ *  CLI_Tokenize() and CLI_TokenCopy() against the reference tokenizer, on
+ *  random lines of blanks, quotes, escapes and text. Each line sits at the
+ *  very end of its own allocation, not NULL terminated, so that the address
+ *  sanitizer catches any read past it, in the vector loops and their tails.
+ */
+
+static uint32_t CLI_CheckToken(void)
+{
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789-=&_  \t\"'\\";
+    CLI_TokenTypeDef       tokens[CLI_CHECK_TOKEN_WORDS];
+    bool                   plain[CLI_CHECK_TOKEN_WORDS];
+    char                   words[CLI_CHECK_TOKEN_LINE_MAX * 2];
+    char                   copy[CLI_CHECK_TOKEN_LINE_MAX + 1];
+    CLI_TokenStatusTypeDef status;
+    CLI_TokenStatusTypeDef expected;
+    uint32_t               count;
+    uint32_t               expectedCount;
+    uint32_t               mismatches = 0;
+    uint32_t               max;
+    uint32_t               n;
+    uint32_t               k;
+    uint64_t               r;
+    size_t                 len;
+    size_t                 i;
+    const char            *word;
+    char                  *line;
+    bool                   same;
+
+    for ( n = 0; n < CLI_CHECK_TOKEN_LINES && mismatches < 10; n++ )
+    {
+        r   = CLI_CheckRand();
+        len = (size_t) (r % (CLI_CHECK_TOKEN_LINE_MAX + 1));
+        max = (uint32_t) ((r >> 16) % (CLI_CHECK_TOKEN_WORDS + 1));
+
+        /* Mostly text with a few special bytes, or special bytes all over. */
+        line = malloc(len != 0 ? len : 1);
+        for ( i = 0; i < len; i++ )
+        {
+            r       = CLI_CheckRand();
+            line[i] = (n & 1) ? alphabet[(r >> 8) % (sizeof(alphabet) - 1)]
+                              : (((r & 15) != 0) ? alphabet[(r >> 8) % 40] : alphabet[40 + (r >> 8) % 6]);
+        }
+
+        status   = CLI_Tokenize(line, len, tokens, max, &count);
+        expected = CLI_CheckRefTokenize(line, len, words, plain, max, &expectedCount);
+        same     = (status == expected);
+
+        if ( same && status == CLI_TOKEN_OK )
+        {
+            same = (count == expectedCount);
+
+            for ( k = 0, word = words; same && k < count; k++, word += strlen(word) + 1 )
+            {
+                same = (CLI_TokenCopy(line, &tokens[k], copy) == strlen(word) && strcmp(copy, word) == 0 &&
+                        tokens[k].plain == plain[k]);
+            }
+        }
+
+        if ( ! same )
+        {
+            if ( mismatches++ == 0 )
+            {
+                CLI_CheckPrintLine(line, len);
+                printf("  status %d, expected %d, words %u, expected %u (room %u)\n", (int) status, (int) expected, count,
+                       expectedCount, max);
+            }
+        }
+
+        free(line);
+    }
+
+    printf("  %u lines, %u mismatches\n", n, mismatches);
+    return mismatches;
+}
+
+/**
+ * @brief
+ *  Reference text kernels, a byte at a time.
+ */
+
+static unsigned char CLI_CheckRefFold(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char) (c - 'A' + 'a') : c;
+}
+
+static int CLI_CheckRefStricmp(const unsigned char *a, const unsigned char *b)
+{
+    while ( *a != '\0' && CLI_CheckRefFold(*a) == CLI_CheckRefFold(*b) )
+    {
+        a++;
+        b++;
+    }
+
+    return (int) CLI_CheckRefFold(*a) - (int) CLI_CheckRefFold(*b);
+}
+
+static void CLI_CheckRefStrlwr(unsigned char *str)
+{
+    for ( ; *str != '\0'; str++ )
+        *str = CLI_CheckRefFold(*str);
+}
+
+static const char *CLI_CheckRefStristr(const char *str, size_t len, const char *pattern, size_t plen)
+{
+    size_t i, k;
+
+    for ( i = 0; i + plen <= len; i++ )
+    {
+        for ( k = 0; k < plen && CLI_CheckRefFold((unsigned char) str[i + k]) == CLI_CheckRefFold((unsigned char) pattern[k]); k++ )
+            ;
+        if ( k == plen )
+            return str + i;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief
+ *  Map two pages followed by an unmapped one.
+ * @retval The first unmapped byte, NULL on error.
+ */
+
+static unsigned char *CLI_CheckGuardedPages(void)
+{
+    unsigned char *base = mmap(NULL, 3 * 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if ( base == MAP_FAILED )
+        return NULL;
+
+    if ( mprotect(base + 2 * 4096, 4096, PROT_NONE) != 0 )
+        return NULL;
+
+    return base + 2 * 4096;
+}
+
+/**
+ * @brief
+ *  Random text of 'len' non NULL bytes, letters of both cases mostly, with
+ *  the bytes around them ('@', '[', '`', '{') and 8 bits ones. Terminated,
+ *  then followed by 'gap' bytes of more text that must not be looked at.
+ */
+
+static void CLI_CheckTextFill(unsigned char *s, size_t len, size_t gap)
+{
+    static const char other[] = "@[`{09 _";
+    uint64_t          r;
+    size_t            i;
+
+    for ( i = 0; i < len + 1 + gap; i++ )
+    {
+        r = CLI_CheckRand();
+
+        if ( (r & 7) < 5 )
+            s[i] = (unsigned char) ('a' + (r >> 8) % 26 - ((r & 8) ? 'a' - 'A' : 0));
+        else if ( (r & 7) < 7 )
+            s[i] = (unsigned char) other[(r >> 8) % (sizeof(other) - 1)];
+        else
+            s[i] = (unsigned char) (0x80 + (r >> 8) % 0x80);
+    }
+
+    s[len] = '\0';
+}
+
+/**
+ * @brief
+ *  Flip the case of some letters.
+ */
+
+static void CLI_CheckTextFlipCase(unsigned char *s, size_t len)
+{
+    size_t i;
+
+    for ( i = 0; i < len; i++ )
+    {
+        if ( ((s[i] | 0x20) >= 'a' && (s[i] | 0x20) <= 'z') && (CLI_CheckRand() & 1) )
+            s[i] ^= 0x20;
+    }
+}
+
+/**
+ * @brief
+ *  One CPU level kernels against the references. The strings end right
+ *  before an unmapped page, or 'gap' bytes before it with more text in
+ *  between, so that a load crossing into the next page faults and the
+ *  bytes past a terminator are seen but must not matter.
+ * @param k: Kernels.
+ * @param end1: First unmapped byte of a guarded region.
+ * @param end2: Same, another region.
+ * @retval Count of mismatches.
+ */
+
+static uint32_t CLI_CheckTextKernels(const CLI_CheckTextKernelsTypeDef *k, unsigned char *end1, unsigned char *end2)
+{
+    unsigned char  ref[CLI_CHECK_TEXT_LEN_MAX + 1 + CLI_CHECK_TEXT_GAP_MAX];
+    unsigned char *a;
+    unsigned char *b;
+    const char    *expected;
+    const char    *found;
+    uint32_t       mismatches = 0;
+    uint32_t       n;
+    uint64_t       r;
+    size_t         len, lenB, plen;
+    size_t         gap, gapB;
+    size_t         at;
+    int            v, w;
+
+    for ( n = 0; n < CLI_CHECK_TEXT_CASES; n++ )
+    {
+        r    = CLI_CheckRand();
+        len  = (size_t) (r % (CLI_CHECK_TEXT_LEN_MAX + 1));
+        gap  = (r & (1ULL << 20)) ? 0 : (size_t) ((r >> 24) % (CLI_CHECK_TEXT_GAP_MAX + 1));
+        gapB = (r & (1ULL << 21)) ? 0 : (size_t) ((r >> 32) % (CLI_CHECK_TEXT_GAP_MAX + 1));
+        a    = end1 - gap - len - 1;
+
+        /* stricmp: a case flipped copy, then maybe one byte changed or cut short. */
+        CLI_CheckTextFill(a, len, gap);
+        lenB = len;
+        if ( len > 0 && (r & (3ULL << 40)) != 0 )
+        {
+            at   = (size_t) ((r >> 44) % len);
+            lenB = ((r >> 40) & 3) == 1 ? at : len;
+        }
+
+        b = end2 - gapB - lenB - 1;
+        CLI_CheckTextFill(b, lenB, gapB);
+        memcpy(b, a, lenB);
+        CLI_CheckTextFlipCase(b, lenB);
+        if ( len > 0 && ((r >> 40) & 3) == 2 )
+            b[(r >> 44) % len] = (unsigned char) (1 + (r >> 52) % 255);
+
+        v = k->stricmp(a, b);
+        w = k->stricmp(b, a);
+        if ( v != CLI_CheckRefStricmp(a, b) || w != CLI_CheckRefStricmp(b, a) )
+        {
+            if ( mismatches++ == 0 )
+                printf("  %s stricmp: %zu / %zu bytes, %zu / %zu before the page end, got %d / %d\n", k->name, len, lenB, gap, gapB, v, w);
+        }
+
+        /* strlwr: the bytes past the terminator are left alone. */
+        memcpy(ref, a, len + 1 + gap);
+        CLI_CheckRefStrlwr(ref);
+        if ( k->strlwr((char *) a) != (char *) a || memcmp(ref, a, len + 1 + gap) != 0 )
+        {
+            if ( mismatches++ == 0 )
+                printf("  %s strlwr: %zu bytes, %zu before the page end\n", k->name, len, gap);
+        }
+
+        /* stristr: a pattern from the string, case flipped, or random. */
+        if ( len == 0 )
+            continue;
+
+        plen = 1 + (size_t) ((r >> 48) % (len < 40 ? len : 40));
+        at   = (size_t) ((r >> 56) % (len - plen + 1));
+        b    = end2 - plen - 1;
+        CLI_CheckTextFill(b, plen, 0);
+        if ( r & (1ULL << 22) )
+        {
+            memcpy(b, a + at, plen);
+            CLI_CheckTextFlipCase(b, plen);
+        }
+
+        CLI_CheckTextFill(a, len, gap);
+        found    = k->stristr((const char *) a, len, (const char *) b, plen);
+        expected = CLI_CheckRefStristr((const char *) a, len, (const char *) b, plen);
+        if ( found != expected )
+        {
+            if ( mismatches++ == 0 )
+                printf("  %s stristr: %zu bytes, pattern of %zu, %zu before the page end\n", k->name, len, plen, gap);
+        }
+    }
+
+    printf("  %-8s %u cases, %u mismatches\n", k->name, 3 * n, mismatches);
+    return mismatches;
+}
+
+/**
+ * @brief
+ *  text_utils string kernels of every level the CPU runs against byte at a
+ *  time references, on strings next to unmapped pages: the NULL terminated
+ *  kernels (TEXT_PAGE_SAFE, not seen by the address sanitizer) must not
+ *  read across a page end.
+ */
+
+static uint32_t CLI_CheckText(void)
+{
+    CLI_CheckTextKernelsTypeDef kernels[3] = {{"scalar", text_stricmp_scalar, text_strlwr_scalar, text_stristr_scalar}};
+    uint32_t                    count      = 1;
+    uint32_t                    mismatches = 0;
+    unsigned char              *end1       = CLI_CheckGuardedPages();
+    unsigned char              *end2       = CLI_CheckGuardedPages();
+    uint32_t                    i;
+
+    if ( end1 == NULL || end2 == NULL )
+    {
+        printf("  could not map the guarded pages\n");
+        return 1;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    if ( __builtin_cpu_supports("sse2") )
+        kernels[count++] = (CLI_CheckTextKernelsTypeDef) {"sse2", text_stricmp_sse2, text_strlwr_sse2, text_stristr_sse2};
+    if ( __builtin_cpu_supports("avx2") )
+        kernels[count++] = (CLI_CheckTextKernelsTypeDef) {"avx2", text_stricmp_avx2, text_strlwr_avx2, text_stristr_avx2};
+#endif
+
+    for ( i = 0; i < count; i++ )
+        mismatches += CLI_CheckTextKernels(&kernels[i], end1, end2);
+
+    return mismatches;
+}
+
+/**
+ * @brief
+ *  Reference parser, as cli_num.h reads: the notation is told by its prefix
+ *  or suffix, the digits are checked with strspn() and converted by
+ *  strtoull().
+ */
+
+static CLI_NumStatusTypeDef CLI_CheckRefParseU64(const char *text, uint32_t flags, uint64_t *value)
+{
+    char        digits[CLI_CHECK_NUM_TEXT + 1];
+    const char *set   = "0123456789";
+    const char *start = text;
+    size_t      len   = strlen(text);
+    uint32_t    shift = 0;
+    int         base  = 10;
+    uint64_t    v;
+
+    if ( text[0] == '0' && (text[1] == 'x' || text[1] == 'X') && (flags & (CLI_NUM_HEX | CLI_NUM_HEX_BARE)) )
+    {
+        base = 16;
+        start += 2;
+    }
+    else if ( flags & CLI_NUM_HEX_BARE )
+        base = 16;
+    else if ( text[0] == '0' && (text[1] == 'b' || text[1] == 'B') && (flags & CLI_NUM_BIN) )
+    {
+        base = 2;
+        start += 2;
+    }
+    else if ( (flags & (CLI_NUM_DEC | CLI_NUM_SIZE)) == 0 )
+        return CLI_NUM_INVALID;
+    else if ( (flags & CLI_NUM_SIZE) && len > 1 && strchr("kKmMgGtT", text[len - 1]) != NULL )
+    {
+        shift = 10 * (uint32_t) (1 + (strchr("kmgt", text[len - 1] | 0x20) - "kmgt"));
+        len--;
+    }
+
+    if ( base == 16 )
+        set = "0123456789abcdefABCDEF";
+    else if ( base == 2 )
+        set = "01";
+
+    len -= (size_t) (start - text);
+    if ( len == 0 || strspn(start, set) < len )
+        return CLI_NUM_INVALID;
+
+    memcpy(digits, start, len);
+    digits[len] = '\0';
+
+    errno = 0;
+    v     = strtoull(digits, NULL, base);
+    if ( errno == ERANGE || (shift != 0 && v > (UINT64_MAX >> shift)) )
+        return CLI_NUM_OVERFLOW;
+
+    *value = v << shift;
+    return CLI_NUM_OK;
+}
+
+/**
+ * @brief
+ *  Random number text: decimal, optionally with a size suffix, hexadecimal
+ *  with or without its prefix, or binary. Either random digits, counts on
+ *  both sides of 64 bits, or a value of any bit length, maybe one digit too
+ *  long, so that the texts around the overflow boundary show up. Leading
+ *  zeros, maybe a sign and maybe a stray byte.
+ */
+
+static void CLI_CheckNumText(char *text, uint64_t r)
+{
+    static const char hex[] = "0123456789abcdefABCDEF";
+    const uint32_t    kind  = (uint32_t) (r % 5);
+    const uint32_t    base  = (kind == 3) ? 2 : (kind == 1 || kind == 2) ? 16 : 10;
+    char              digits[64];
+    uint64_t          value;
+    uint32_t          count;
+    uint32_t          zeros;
+    uint32_t          i;
+    char             *p = text;
+
+    if ( (r >> 8) % 4 == 0 )
+        *p++ = ((r >> 10) & 1) ? '-' : '+';
+
+    if ( kind == 1 )
+        p += sprintf(p, "0%c", ((r >> 11) & 1) ? 'x' : 'X');
+    else if ( kind == 3 )
+        p += sprintf(p, "0%c", ((r >> 11) & 1) ? 'b' : 'B');
+
+    zeros = ((r >> 12) % 4 == 0) ? (uint32_t) ((r >> 56) % 64) : 0;
+    for ( i = 0; i < zeros; i++ )
+        *p++ = '0';
+
+    if ( (r >> 13) & 1 )
+    {
+        value = CLI_CheckRand() >> ((r >> 16) % 64);
+        for ( count = 0; count == 0 || value != 0; value /= base )
+            digits[count++] = hex[value % base];
+        while ( count > 0 )
+            *p++ = digits[--count];
+
+        if ( (r >> 14) & 1 )
+            *p++ = hex[CLI_CheckRand() % base];
+    }
+    else
+    {
+        /* Up to twice the digits of 64 bits. */
+        count = (uint32_t) ((r >> 16) % ((kind == 3) ? 128 : (kind == 0 || kind == 4) ? 40 : 32));
+        for ( i = 0; i < count; i++ )
+        {
+            if ( kind == 3 )
+                *p++ = (char) ('0' + (CLI_CheckRand() & 1));
+            else if ( kind == 1 || kind == 2 )
+                *p++ = hex[CLI_CheckRand() % (sizeof(hex) - 1)];
+            else
+                *p++ = (char) ('0' + CLI_CheckRand() % 10);
+        }
+    }
+
+    if ( kind == 4 )
+        *p++ = "kKmMgGtT"[(r >> 24) % 8];
+    *p = '\0';
+
+    /* A stray byte, sometimes a digit of another base or a blank. */
+    if ( (r >> 28) % 8 == 0 && p != text )
+        text[(r >> 32) % (size_t) (p - text)] = "xX09aAfFgG -+."[(r >> 40) % 14];
+}
+
+/**
+ * @brief
+ *  cli_num against the C library: formatting against snprintf() on random
+ *  values of every bit length, parsing against strtoull() on random texts in
+ *  every notation, accepted in random combinations.
+ */
+
+static uint32_t CLI_CheckNum(void)
+{
+    static const uint32_t flagsPick[] = {CLI_NUM_ANY, CLI_NUM_DEC, CLI_NUM_HEX, CLI_NUM_BIN, CLI_NUM_SIZE, CLI_NUM_HEX_BARE, CLI_NUM_DEC | CLI_NUM_HEX, 0};
+    char                  text[CLI_CHECK_NUM_TEXT + 1];
+    char                  buf[CLI_NUM_DEC_SIZE];
+    char                  ref[CLI_NUM_DEC_SIZE];
+    CLI_NumStatusTypeDef  status;
+    CLI_NumStatusTypeDef  expected;
+    const char           *magnitude;
+    uint32_t              mismatches = 0;
+    uint32_t              flags;
+    uint32_t              n;
+    uint64_t              r;
+    uint64_t              value;
+    uint64_t              u, uRef;
+    int64_t               s, sRef;
+    size_t                len;
+    bool                  negative;
+
+    for ( n = 0; n < CLI_CHECK_NUM_VALUES; n++ )
+    {
+        /* Every bit length, and the extremes. */
+        r     = CLI_CheckRand();
+        value = (n < 4) ? (uint64_t[]){0, UINT64_MAX, (uint64_t) INT64_MIN, (uint64_t) INT64_MAX}[n] : CLI_CheckRand() >> (r % 64);
+
+        len = CLI_NumFormatU64(value, buf);
+        if ( len != (size_t) snprintf(ref, sizeof(ref), "%" PRIu64, value) || strcmp(buf, ref) != 0 )
+        {
+            if ( mismatches++ == 0 )
+                printf("  format u64 %" PRIu64 ": \"%s\"\n", value, buf);
+        }
+
+        len = CLI_NumFormatI64((int64_t) value, buf);
+        if ( len != (size_t) snprintf(ref, sizeof(ref), "%" PRId64, (int64_t) value) || strcmp(buf, ref) != 0 )
+        {
+            if ( mismatches++ == 0 )
+                printf("  format i64 %" PRId64 ": \"%s\"\n", (int64_t) value, buf);
+        }
+
+        len = CLI_NumFormatHex(value, buf, (r >> 8) & 1);
+        if ( len != (size_t) snprintf(ref, sizeof(ref), ((r >> 8) & 1) ? "%" PRIX64 : "%" PRIx64, value) || strcmp(buf, ref) != 0 )
+        {
+            if ( mismatches++ == 0 )
+                printf("  format hex %" PRIx64 ": \"%s\"\n", value, buf);
+        }
+    }
+
+    printf("  %u values formatted 3 ways, %u mismatches\n", n, mismatches);
+
+    for ( n = 0; n < CLI_CHECK_NUM_TEXTS; n++ )
+    {
+        r     = CLI_CheckRand();
+        flags = flagsPick[(r >> 48) % (sizeof(flagsPick) / sizeof(flagsPick[0]))];
+        CLI_CheckNumText(text, r);
+
+        /* Unsigned: the whole text, a sign is a stray byte. */
+        u = uRef = 0;
+        status   = CLI_NumParseU64(text, flags, &u);
+        expected = (text[0] == '-' || text[0] == '+') ? CLI_NUM_INVALID : CLI_CheckRefParseU64(text, flags, &uRef);
+        if ( status != expected || u != uRef )
+        {
+            if ( mismatches++ == 0 )
+                printf("  parse u64 \"%s\" flags 0x%02x: status %d, expected %d\n", text, flags, (int) status, (int) expected);
+        }
+
+        /* Signed: the magnitude must fit, one more when negative. */
+        negative  = (text[0] == '-');
+        magnitude = text + (text[0] == '-' || text[0] == '+');
+        s = sRef  = 0;
+        status    = CLI_NumParseI64(text, flags, &s);
+        expected  = CLI_CheckRefParseU64(magnitude, flags, &uRef);
+        if ( expected == CLI_NUM_OK && uRef > (uint64_t) INT64_MAX + negative )
+            expected = CLI_NUM_OVERFLOW;
+        else if ( expected == CLI_NUM_OK )
+            sRef = negative ? (int64_t) (0 - uRef) : (int64_t) uRef;
+
+        if ( status != expected || s != sRef )
+        {
+            if ( mismatches++ == 0 )
+                printf("  parse i64 \"%s\" flags 0x%02x: status %d, expected %d\n", text, flags, (int) status, (int) expected);
+        }
+    }
+
+    printf("  %u texts parsed signed and unsigned, %u mismatches\n", n, mismatches);
+    return mismatches;
+}
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @addtogroup CLI_CHECK_Private_Variables
+  * @{
+  */
+
+static const CLI_CheckSectionTypeDef gCliCheckSections[] = {
+    {"token", "command line tokenizer against a byte at a time splitter", CLI_CheckToken},
+    {"text", "text_utils kernels against byte at a time ones, next to unmapped pages", CLI_CheckText},
+    {"num", "integer formatting and parsing against snprintf() and strtoull()", CLI_CheckNum},
+};
+
+/**
+  * @}
+  */
+
+/**
+ * @brief
+ *  Run the sections named on the command line, all of them by default.
+ * @retval EXIT_FAILURE if any section found a mismatch.
+ */
+
+int main(int argc, char **argv)
+{
+    uint32_t mismatches = 0;
+    size_t   i;
+    int      j;
+    bool     run;
+
+    for ( i = 0; i < sizeof(gCliCheckSections) / sizeof(gCliCheckSections[0]); i++ )
+    {
+        for ( run = (argc < 2), j = 1; j < argc && ! run; j++ )
+            run = (strcmp(argv[j], gCliCheckSections[i].name) == 0);
+
+        if ( ! run )
+            continue;
+
+        printf("%s (%s)\n", gCliCheckSections[i].title, gCliCheckSections[i].name);
+        mismatches += gCliCheckSections[i].run();
+        printf("\n");
+    }
+
+    return (mismatches == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+  * @}
+  */
@@ -0,0 +1,560 @@
+
+/**
+  ******************************************************************************
+  *
+  * @file    cli_tablegen.c
+  * @brief   Build time commands table generator (host tool).
+  *          Reads the modules '.def' files, in injection order, and emits one
+  *          C file holding the merged table the way CLI_BuildTable() would
+  *          build it (trimmed, lower cased, first declaration wins, sorted,
+  *          split into subcommands levels) together with each level names
+  *          pool, perfect hash and completion trie, all as const data. Linked
+  *          into CLI_STATIC_TABLE builds so startup neither allocates nor
+  *          sorts.
+  *
+  *          Usage: cli_tablegen <output.c> <module.def>...
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cli.h"
+#include "cli_hash.h"
+#include "cli_trie.h"
+
+/** @defgroup CLI_TABLEGEN CLI Table Generator
+  * @brief CLI commands table generator
+  * @{
+  */
+
+/* Private define ------------------------------------------------------------*/
+/** @defgroup CLI_TABLEGEN_Private_Define CLI Table Generator Private Define
+  * @{
+  */
+
+#define CLI_TABLEGEN_MAX_LINE   512
+#define CLI_TABLEGEN_MAX_SYMBOL 128
+
+/**
+  * @}
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup CLI_TABLEGEN_Private_Typedef CLI Table Generator Private Typedef
+  * @{
+  */
+
+/**
+  * @brief
+  *  A command as declared in a '.def' file.
+  */
+
+typedef struct __CLI_GenCmdTypeDef
+{
+    char handler[CLI_TABLEGEN_MAX_SYMBOL];  /* Handler symbol */
+    char name[CLI_TABLEGEN_MAX_SYMBOL];     /* Trimmed, lower cased path */
+    char flags[CLI_TABLEGEN_MAX_SYMBOL];    /* Flags expression, emitted as is */
+    char schema[CLI_TABLEGEN_MAX_SYMBOL];   /* Arguments schema symbol, empty for none */
+
+} CLI_GenCmdTypeDef;
+
+/**
+  * @}
+  */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup CLI_TABLEGEN_Private_Variables CLI Table Generator Private Variables
+  * @{
+  */
+
+static CLI_GenCmdTypeDef *gGenCmnds     = NULL;
+static uint32_t           gGenCount     = 0;
+static uint32_t           gGenAllocated = 0;
+static uint32_t           gGenLevels    = 0; /* Levels emitted so far */
+
+/**
+  * @}
+  */
+
+/* Private functions ---------------------------------------------------------*/
+/** @defgroup CLI_TABLEGEN_Private_Functions CLI Table Generator Private Functions
+  * @{
+  */
+
+/**
+ * @brief
+ *  Skip white spaces.
+ */
+
+static const char *CLI_GenSkip(const char *p)
+{
+    while ( *p == ' ' || *p == '\t' )
+        p++;
+
+    return p;
+}
+
+/**
+ * @brief
+ *  Copy 'len' bytes into a NULL terminated, bounded buffer, trimming white
+ *  spaces on both ends. Return false if it did not fit.
+ */
+
+static bool CLI_GenCopy(char *dst, size_t size, const char *src, size_t len)
+{
+    while ( len > 0 && isspace((unsigned char) *src) )
+    {
+        src++;
+        len--;
+    }
+
+    while ( len > 0 && isspace((unsigned char) src[len - 1]) )
+        len--;
+
+    if ( len >= size )
+        return false;
+
+    memcpy(dst, src, len);
+    dst[len] = 0;
+    return true;
+}
+
+/**
+ * @brief
+ *  Lower case a command path and separate its words with single spaces.
+ */
+
+static void CLI_GenNormalize(char *path)
+{
+    const char *src = path;
+    size_t      len = 0;
+
+    while ( *src )
+    {
+        if ( isspace((unsigned char) *src) )
+        {
+            while ( isspace((unsigned char) *src) )
+                src++;
+            path[len++] = ' ';
+            continue;
+        }
+
+        path[len++] = (char) tolower((unsigned char) *src++);
+    }
+
+    path[len] = 0;
+}
+
+/**
+ * @brief
+ *  Parse one 'CLI_COMMAND(handler, "name", flags)' or
+ *  'CLI_COMMAND_ARGS(handler, "name", flags, schema)' line.
+ *  Return 1 when a command was parsed, 0 for a line without one and -1 for a
+ *  malformed declaration.
+ */
+
+static int CLI_GenParseLine(const char *line, CLI_GenCmdTypeDef *cmd)
+{
+    const char *p      = CLI_GenSkip(line);
+    const char *end;
+    const char *comma;
+    bool        schema = false;
+
+    if ( strncmp(p, "CLI_COMMAND_ARGS(", 17) == 0 )
+    {
+        p      = p + 17;
+        schema = true;
+    }
+    else if ( strncmp(p, "CLI_COMMAND(", 12) == 0 )
+        p = p + 12;
+    else
+        return 0;
+
+    /* Handler */
+    end = strchr(p, ',');
+    if ( end == NULL || ! CLI_GenCopy(cmd->handler, sizeof(cmd->handler), p, end - p) || cmd->handler[0] == 0 )
+        return -1;
+
+    /* Quoted name, forced to lower case the way CLI_BuildTable() does. */
+    p = CLI_GenSkip(end + 1);
+    if ( *p++ != '"' || (end = strchr(p, '"')) == NULL )
+        return -1;
+
+    if ( ! CLI_GenCopy(cmd->name, sizeof(cmd->name), p, end - p) || cmd->name[0] == 0 )
+        return -1;
+
+    CLI_GenNormalize(cmd->name);
+
+    /* Flags expression, up to the closing parenthesis. */
+    p = CLI_GenSkip(end + 1);
+    if ( *p++ != ',' || (end = strrchr(p, ')')) == NULL )
+        return -1;
+
+    cmd->schema[0] = 0;
+    if ( schema )
+    {
+        /* The schema symbol follows the last comma. */
+        comma = strrchr(p, ',');
+        if ( comma == NULL || comma > end || ! CLI_GenCopy(cmd->schema, sizeof(cmd->schema), comma + 1, end - comma - 1) ||
+             cmd->schema[0] == 0 )
+            return -1;
+        end = comma;
+    }
+
+    if ( ! CLI_GenCopy(cmd->flags, sizeof(cmd->flags), p, end - p) || cmd->flags[0] == 0 )
+        return -1;
+
+    return 1;
+}
+
+/**
+ * @brief
+ *  Add a command unless its name was already declared, first one wins.
+ */
+
+static bool CLI_GenAdd(const CLI_GenCmdTypeDef *cmd)
+{
+    CLI_GenCmdTypeDef *grown;
+    uint32_t           i;
+
+    for ( i = 0; i < gGenCount; i++ )
+    {
+        if ( strcmp(gGenCmnds[i].name, cmd->name) == 0 )
+            return true;
+    }
+
+    if ( gGenCount == gGenAllocated )
+    {
+        gGenAllocated = gGenAllocated ? gGenAllocated * 2 : 64;
+        grown         = realloc(gGenCmnds, gGenAllocated * sizeof(CLI_GenCmdTypeDef));
+        if ( grown == NULL )
+            return false;
+        gGenCmnds = grown;
+    }
+
+    gGenCmnds[gGenCount++] = *cmd;
+    return true;
+}
+
+/**
+ * @brief
+ *  Read the commands of a '.def' file.
+ */
+
+static bool CLI_GenReadDef(const char *path)
+{
+    FILE             *file;
+    char              line[CLI_TABLEGEN_MAX_LINE];
+    CLI_GenCmdTypeDef cmd;
+    unsigned          lineNum = 0;
+    bool              retVal  = true;
+
+    file = fopen(path, "r");
+    if ( file == NULL )
+    {
+        fprintf(stderr, "%s: can't open\n", path);
+        return false;
+    }
+
+    while ( retVal == true && fgets(line, sizeof(line), file) != NULL )
+    {
+        lineNum++;
+        switch ( CLI_GenParseLine(line, &cmd) )
+        {
+            case 1:
+                retVal = CLI_GenAdd(&cmd);
+                break;
+
+            case -1:
+                fprintf(stderr, "%s:%u: malformed CLI_COMMAND() or name longer than %d\n", path, lineNum, CLI_TABLEGEN_MAX_SYMBOL - 1);
+                retVal = false;
+                break;
+        }
+    }
+
+    fclose(file);
+    return retVal;
+}
+
+/**
+ * @brief
+ *  Same order as the engine CLI_Compare().
+ */
+
+static int CLI_GenCompare(const void *a, const void *b)
+{
+    return strcmp(((const CLI_GenCmdTypeDef *) a)->name, ((const CLI_GenCmdTypeDef *) b)->name);
+}
+
+/**
+ * @brief
+ *  Emit the level of the sorted 'gGenCmnds[lo, hi)' whose words start at
+ *  'offset', along with its indexes, after the levels below it so that it
+ *  can refer to them. Mirrors the engine CLI_NodeBuild().
+ *  Return the emitted level number, -1 on error.
+ */
+
+static int32_t CLI_GenLevel(FILE *file, uint32_t lo, uint32_t hi, uint32_t offset)
+{
+    CLI_CmdTypeDef      *cmnds;
+    int32_t             *decls;
+    int32_t             *subs;
+    int32_t             *disp;
+    CLI_HashSlotTypeDef *slots;
+    uint32_t            *nameOffs;
+    CLI_TrieNodeTypeDef *trie;
+    uint32_t             trieCount;
+    uint32_t             count = 0;
+    uint32_t             used  = 0;
+    uint32_t             len;
+    uint32_t             i, j, k;
+    int32_t              level = -1;
+    const char          *word;
+    char                *names;
+
+    for ( i = lo; i < hi; i = j, count++ )
+    {
+        word = gGenCmnds[i].name + offset;
+        len  = (uint32_t) strcspn(word, " ");
+        for ( j = i + 1; j < hi && strncmp(gGenCmnds[j].name + offset, word, len) == 0 && gGenCmnds[j].name[offset + len] == ' '; j++ )
+            ;
+    }
+
+    cmnds    = calloc(count, sizeof(CLI_CmdTypeDef));
+    decls    = calloc(count, sizeof(int32_t));
+    subs     = calloc(count, sizeof(int32_t));
+    names    = calloc(count, CLI_TABLEGEN_MAX_SYMBOL);
+    nameOffs = calloc(count, sizeof(uint32_t));
+    disp     = calloc(count, sizeof(int32_t));
+    slots    = calloc(count, sizeof(CLI_HashSlotTypeDef));
+    trie     = calloc(CLI_TrieMaxNodes(count), sizeof(CLI_TrieNodeTypeDef));
+
+    do
+    {
+        if ( cmnds == NULL || decls == NULL || subs == NULL || names == NULL || nameOffs == NULL || disp == NULL || slots == NULL || trie == NULL )
+            break;
+
+        /* One command per distinct word, the path ending with it sorts first. */
+        for ( i = lo, k = 0; i < hi; i = j, k++ )
+        {
+            word = gGenCmnds[i].name + offset;
+            len  = (uint32_t) strcspn(word, " ");
+            for ( j = i + 1; j < hi && strncmp(gGenCmnds[j].name + offset, word, len) == 0 && gGenCmnds[j].name[offset + len] == ' '; j++ )
+                ;
+
+            /* The level names back to back, as CLI_NodeBuild() interns them. */
+            nameOffs[k]   = used;
+            cmnds[k].Name = memcpy(names + used, word, len);
+            used         += len + 1;
+            decls[k]      = -1; /* A group, unless a path ends with this word */
+            subs[k]       = -1;
+
+            if ( word[len] == 0 )
+                decls[k] = (int32_t) i++;
+
+            if ( i < j && (subs[k] = CLI_GenLevel(file, i, j, offset + len + 1)) < 0 )
+                break;
+        }
+
+        if ( k < count )
+            break;
+
+        if ( ! CLI_HashBuild(names, nameOffs, count, disp, slots, malloc, free) )
+        {
+            fprintf(stderr, "Could not build the commands perfect hash\n");
+            break;
+        }
+
+        trieCount = CLI_TrieBuild(names, nameOffs, count, trie);
+        level     = (int32_t) gGenLevels++;
+
+        /* Hot names pool, the commands point into it. */
+        fprintf(file, "static const char gCliStaticNames%d[] =", level);
+        for ( k = 0; k < count; k++ )
+            fprintf(file, "%s\"%s\\0\"", (k % 4) ? " " : "\n    ", cmnds[k].Name);
+        fprintf(file, ";\n\n");
+
+        fprintf(file, "static const uint32_t gCliStaticNameOffs%d[%u] = {", level, count);
+        for ( i = 0; i < count; i++ )
+            fprintf(file, "%s%u,", (i % 8) ? " " : "\n    ", nameOffs[i]);
+        fprintf(file, "\n};\n\n");
+
+        /* Terminated by an empty entry, as tables built at runtime are. */
+        fprintf(file, "static const CLI_CmdTypeDef gCliStaticCmnds%d[%u] = {\n", level, count + 1);
+        for ( k = 0; k < count; k++ )
+        {
+            if ( decls[k] >= 0 )
+                fprintf(file, "    { %s, &gCliStaticNames%d[%u], %s, %s%s, ", gGenCmnds[decls[k]].handler, level, nameOffs[k],
+                        gGenCmnds[decls[k]].flags, gGenCmnds[decls[k]].schema[0] ? "&" : "",
+                        gGenCmnds[decls[k]].schema[0] ? gGenCmnds[decls[k]].schema : "NULL");
+            else
+                fprintf(file, "    { NULL, &gCliStaticNames%d[%u], 0, NULL, ", level, nameOffs[k]);
+            if ( subs[k] >= 0 )
+                fprintf(file, "&gCliStaticNode%d },\n", subs[k]);
+            else
+                fprintf(file, "NULL },\n");
+        }
+        fprintf(file, "    { 0 },\n};\n\n");
+
+        fprintf(file, "static const int32_t gCliStaticHashDisp%d[%u] = {", level, count);
+        for ( i = 0; i < count; i++ )
+            fprintf(file, "%s%d,", (i % 8) ? " " : "\n    ", disp[i]);
+        fprintf(file, "\n};\n\n");
+
+        fprintf(file, "static const CLI_HashSlotTypeDef gCliStaticHashSlots%d[%u] = {\n", level, count);
+        for ( i = 0; i < count; i++ )
+            fprintf(file, "    { 0x%08X, %u, %u },\n", slots[i].key, slots[i].nameOff, slots[i].index);
+        fprintf(file, "};\n\n");
+
+        fprintf(file, "static const CLI_TrieNodeTypeDef gCliStaticTrie%d[%u] = {\n", level, trieCount);
+        for ( i = 0; i < trieCount; i++ )
+            fprintf(file, "    { %u, %u, %u, %u, %u, %u },\n", trie[i].first, trie[i].count, trie[i].child, trie[i].depth, trie[i].children,
+                    trie[i].label);
+        fprintf(file, "};\n\n");
+
+        /* The top level is the one the engine knows about. */
+        if ( offset == 0 )
+            fprintf(file, "const CLI_CmdNodeTypeDef gCliStaticTable = {\n");
+        else
+            fprintf(file, "static const CLI_CmdNodeTypeDef gCliStaticNode%d = {\n", level);
+        fprintf(file, "    gCliStaticCmnds%d,\n", level);
+        fprintf(file, "    gCliStaticNames%d,\n", level);
+        fprintf(file, "    gCliStaticNameOffs%d,\n", level);
+        fprintf(file, "    gCliStaticHashDisp%d,\n", level);
+        fprintf(file, "    gCliStaticHashSlots%d,\n", level);
+        fprintf(file, "    gCliStaticTrie%d,\n", level);
+        fprintf(file, "    %u,\n", count);
+        fprintf(file, "};\n\n");
+
+    } while ( 0 );
+
+    free(cmnds);
+    free(decls);
+    free(subs);
+    free(names);
+    free(nameOffs);
+    free(disp);
+    free(slots);
+    free(trie);
+
+    return level;
+}
+
+/**
+ * @brief
+ *  Emit the handler prototypes and schema declarations, then the levels of the table and their indexes.
+ */
+
+static bool CLI_GenWrite(const char *path, int defCount, char **defs)
+{
+    FILE    *file;
+    uint32_t i, j;
+    int      d;
+    bool     retVal;
+
+    file = fopen(path, "w");
+    if ( file == NULL )
+    {
+        fprintf(stderr, "%s: can't create\n", path);
+        return false;
+    }
+
+    fprintf(file, "/* Generated by cli_tablegen from");
+    for ( d = 0; d < defCount; d++ )
+        fprintf(file, " %s", defs[d]);
+    fprintf(file, ", do not edit. */\n\n");
+    fprintf(file, "#include \"cli.h\"\n");
+    fprintf(file, "#include \"cli_args.h\"\n");
+    fprintf(file, "#include \"cli_hash.h\"\n");
+    fprintf(file, "#include \"cli_trie.h\"\n\n");
+
+    /* Prototypes, once per handler. */
+    for ( i = 0; i < gGenCount; i++ )
+    {
+        for ( j = 0; j < i; j++ )
+        {
+            if ( strcmp(gGenCmnds[j].handler, gGenCmnds[i].handler) == 0 )
+                break;
+        }
+
+        if ( j == i )
+            fprintf(file, "int %s(int argc, char **argv);\n", gGenCmnds[i].handler);
+    }
+
+    /* Arguments schemas, once each. */
+    for ( i = 0; i < gGenCount; i++ )
+    {
+        if ( gGenCmnds[i].schema[0] == 0 )
+            continue;
+
+        for ( j = 0; j < i; j++ )
+        {
+            if ( strcmp(gGenCmnds[j].schema, gGenCmnds[i].schema) == 0 )
+                break;
+        }
+
+        if ( j == i )
+            fprintf(file, "extern const CLI_ArgsSchemaTypeDef %s;\n", gGenCmnds[i].schema);
+    }
+    fprintf(file, "\n");
+
+    retVal = CLI_GenLevel(file, 0, gGenCount, 0) >= 0;
+
+    if ( fclose(file) != 0 )
+    {
+        fprintf(stderr, "%s: write failed\n", path);
+        return false;
+    }
+
+    return retVal;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @brief  Generator entry point.
+  * @retval int - EXIT_SUCCESS when the table was written.
+  */
+
+int main(int argc, char **argv)
+{
+    int d;
+
+    if ( argc < 3 )
+    {
+        fprintf(stderr, "Usage: %s <output.c> <module.def>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for ( d = 2; d < argc; d++ )
+    {
+        if ( ! CLI_GenReadDef(argv[d]) )
+            return EXIT_FAILURE;
+    }
+
+    if ( gGenCount == 0 )
+    {
+        fprintf(stderr, "No commands declared\n");
+        return EXIT_FAILURE;
+    }
+
+    qsort(gGenCmnds, gGenCount, sizeof(CLI_GenCmdTypeDef), CLI_GenCompare);
+
+    if ( ! CLI_GenWrite(argv[1], argc - 2, argv + 2) )
+    {
+        remove(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+  * @}
+  */